@@ -120,7 +120,9 @@ public:
         {
             if ( m_model.ao )
             {
-                m_view.screen().scene()->replaceRenderer( "Renderer", m_model.renderer() );
+                auto* scene = m_view.screen().scene();
+                auto* renderer = Model::AORenderer::DownCast( scene->renderer( "Renderer" ) );
+                renderer->setKernelRadius( m_model.radius );
             }
         } );
 
@@ -137,7 +139,9 @@ public:
         {
             if ( m_model.ao )
             {
-                m_view.screen().scene()->replaceRenderer( "Renderer", m_model.renderer() );
+                auto* scene = m_view.screen().scene();
+                auto* renderer = Model::AORenderer::DownCast( scene->renderer( "Renderer" ) );
+                renderer->setKernelSize( m_model.points );
             }
         } );
 
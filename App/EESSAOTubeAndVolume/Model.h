@@ -156,6 +156,7 @@ private:
             renderer->setKernelSize( Input::points );
             renderer->setEdgeFactor( Input::edge );
             renderer->setLODControlEnabled( Input::lod );
+            renderer->setGeometryClippingEnabled( true ); // terminate the rays at the tubes
             renderer->enableShading();
             return renderer;
         }
@@ -122,7 +122,9 @@ public:
         {
             if ( m_model.ao )
             {
-                m_view.screen().scene()->replaceRenderer( "Renderer", m_model.renderer() );
+                auto* scene = m_view.screen().scene();
+                auto* renderer = local::Model::AORenderer::DownCast( scene->renderer( "Renderer" ) );
+                renderer->setKernelRadius( m_model.radius );
             }
         } );
 
@@ -139,7 +141,9 @@ public:
         {
             if ( m_model.ao )
             {
-                m_view.screen().scene()->replaceRenderer( "Renderer", m_model.renderer() );
+                auto* scene = m_view.screen().scene();
+                auto* renderer = local::Model::AORenderer::DownCast( scene->renderer( "Renderer" ) );
+                renderer->setKernelSize( m_model.points );
             }
         } );
 
@@ -3,6 +3,7 @@
 #include <kvs/ValueArray>
 #include <kvs/Xorshift128>
 #include <kvs/MersenneTwister>
+#include <kvs/Math>
 #include <cmath>
 
 
@@ -31,11 +32,127 @@ inline void Draw()
     }
 }
 
+inline void CreateTexture(
+    kvs::Texture2D& texture,
+    const GLint internal_format,
+    const GLenum external_format,
+    const size_t width,
+    const size_t height )
+{
+    texture.setWrapS( GL_CLAMP_TO_EDGE );
+    texture.setWrapT( GL_CLAMP_TO_EDGE );
+    texture.setMagFilter( GL_LINEAR );
+    texture.setMinFilter( GL_LINEAR );
+    texture.setPixelFormat( internal_format, external_format, GL_FLOAT );
+    texture.create( width, height );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Copies the G-buffer (color, position, normal and depth) between
+ *          the framebuffers bound to GL_READ_FRAMEBUFFER and GL_DRAW_FRAMEBUFFER.
+ *  @param  width [in] framebuffer width
+ *  @param  height [in] framebuffer height
+ */
+/*===========================================================================*/
+inline void BlitLayer( const GLint width, const GLint height )
+{
+    for ( GLenum i = 0; i < 3; i++ )
+    {
+        KVS_GL_CALL( glReadBuffer( GL_COLOR_ATTACHMENT0_EXT + i ) );
+        KVS_GL_CALL( glDrawBuffer( GL_COLOR_ATTACHMENT0_EXT + i ) );
+        KVS_GL_CALL( glBlitFramebufferEXT(
+                         0, 0, width, height, 0, 0, width, height,
+                         GL_COLOR_BUFFER_BIT, GL_NEAREST ) );
+    }
+
+    KVS_GL_CALL( glBlitFramebufferEXT(
+                     0, 0, width, height, 0, 0, width, height,
+                     GL_DEPTH_BUFFER_BIT, GL_NEAREST ) );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the scaled size.
+ *  @param  size [in] size in pixels
+ *  @param  scale [in] scale factor
+ *  @return scaled size (at least one pixel)
+ */
+/*===========================================================================*/
+inline size_t ScaledSize( const size_t size, const float scale )
+{
+    const auto scaled = static_cast<size_t>( static_cast<float>( size ) * scale + 0.5f );
+    return kvs::Math::Max( scaled, size_t( 1 ) );
+}
+
 } // end of namespace
 
 namespace AmbientOcclusionRendering
 {
 
+/*===========================================================================*/
+/**
+ *  @brief  Sets the radius of the sampling kernel.
+ *  @param  radius [in] kernel radius
+ *
+ *  The parameters of the occlusion pass are applied in the next draw, so that
+ *  they can be changed without recreating the renderer.
+ */
+/*===========================================================================*/
+void AmbientOcclusionBuffer::setKernelRadius( const kvs::Real32 radius )
+{
+    if ( radius == m_kernel_radius ) { return; }
+    m_kernel_radius = radius;
+    m_parameter_changed = true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the number of the sampling points.
+ *  @param  nsamples [in] number of sampling points
+ */
+/*===========================================================================*/
+void AmbientOcclusionBuffer::setKernelSize( const size_t nsamples )
+{
+    if ( nsamples == m_kernel_size ) { return; }
+    m_kernel_size = nsamples;
+    m_kernel_changed = true;
+    m_parameter_changed = true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the stride of the sampling points used in the occlusion pass.
+ *  @param  stride [in] stride of the sampling points (clamped to [1, kernel size])
+ */
+/*===========================================================================*/
+void AmbientOcclusionBuffer::setKernelStride( const size_t stride )
+{
+    const size_t max_stride = kvs::Math::Max( m_kernel_size, size_t( 1 ) );
+    m_kernel_stride = kvs::Math::Clamp( stride, size_t( 1 ), max_stride );
+}
+
+void AmbientOcclusionBuffer::setKernelBias( const float bias )
+{
+    if ( bias == m_kernel_bias ) { return; }
+    m_kernel_bias = bias;
+    m_parameter_changed = true;
+}
+
+void AmbientOcclusionBuffer::setIntensity( const float intensity )
+{
+    if ( intensity == m_intensity ) { return; }
+    m_intensity = intensity;
+    m_parameter_changed = true;
+}
+
+void AmbientOcclusionBuffer::setDrawingOcclusionFactorEnabled( const bool enabled )
+{
+    if ( enabled == m_drawing_occlusion_factor ) { return; }
+    m_drawing_occlusion_factor = enabled;
+    m_parameter_changed = true;
+}
+
 void AmbientOcclusionBuffer::bind()
 {
     // Gaurded bind.
@@ -51,10 +168,22 @@ void AmbientOcclusionBuffer::bind()
         GL_COLOR_ATTACHMENT1_EXT,
         GL_COLOR_ATTACHMENT2_EXT };
     kvs::OpenGL::SetDrawBuffers( 3, buffers );
+
+    // Render in the scaled resolution.
+    if ( this->isScaled() )
+    {
+        m_viewport = kvs::OpenGL::Viewport();
+        kvs::OpenGL::SetViewport( 0, 0, m_width, m_height );
+    }
 }
 
 void AmbientOcclusionBuffer::unbind()
 {
+    if ( this->isScaled() )
+    {
+        kvs::OpenGL::SetViewport( m_viewport[0], m_viewport[1], m_viewport[2], m_viewport[3] );
+    }
+
     if ( m_bound_id != m_framebuffer.id() )
     {
         KVS_GL_CALL( glBindFramebufferEXT( GL_FRAMEBUFFER, m_bound_id ) );
@@ -62,8 +191,67 @@ void AmbientOcclusionBuffer::unbind()
 }
 
 void AmbientOcclusionBuffer::draw()
+{
+    if ( !this->isScaled() )
+    {
+        this->draw_occlusion_pass();
+        return;
+    }
+
+    // Render the occlusion pass in the scaled resolution, and then upscale it
+    // to the currently bound framebuffer.
+    {
+        kvs::FrameBufferObject::GuardedBinder binder( m_scaled_framebuffer );
+        kvs::OpenGL::WithPushedAttrib attrib( GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT );
+        kvs::OpenGL::SetViewport( 0, 0, m_width, m_height );
+        kvs::OpenGL::SetClearColor( kvs::Vec4::Constant( 0.0f ) );
+        kvs::OpenGL::Clear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+        this->draw_occlusion_pass();
+    }
+    this->draw_upscale_pass();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Applies the changed parameters to the kernel texture and the
+ *          uniform variables of the occlusion pass shader. The occlusion pass
+ *          shader must be bound.
+ */
+/*===========================================================================*/
+void AmbientOcclusionBuffer::update_parameters()
+{
+    // Only the kernel texture is regenerated, since the noise texture does not
+    // depend on the kernel.
+    if ( m_kernel_changed )
+    {
+        m_kernel_texture.release();
+        m_kernel_texture.setWrapS( GL_CLAMP_TO_EDGE );
+        m_kernel_texture.setMagFilter( GL_NEAREST );
+        m_kernel_texture.setMinFilter( GL_NEAREST );
+        m_kernel_texture.setPixelFormat( GL_RGBA32F_ARB, GL_RGB, GL_FLOAT );
+
+        auto samples = this->generatePoints( m_kernel_radius, m_kernel_size );
+        m_kernel_texture.create( m_kernel_size, samples.data() );
+        m_kernel_changed = false;
+    }
+
+    if ( m_parameter_changed )
+    {
+        const bool occlusion_factor = m_drawing_occlusion_factor && m_shading_enabled;
+        m_occl_pass_shader.setUniform( "kernel_size", int( m_kernel_size ) );
+        m_occl_pass_shader.setUniform( "kernel_radius", m_kernel_radius );
+        m_occl_pass_shader.setUniform( "kernel_bias", m_kernel_bias );
+        m_occl_pass_shader.setUniform( "intensity", m_intensity );
+        m_occl_pass_shader.setUniform( "drawing_occlusion_factor", occlusion_factor ? 1 : 0 );
+        m_parameter_changed = false;
+    }
+}
+
+void AmbientOcclusionBuffer::draw_occlusion_pass()
 {
     kvs::ProgramObject::Binder bind1( m_occl_pass_shader );
+    this->update_parameters();
+
     kvs::Texture::Binder unit0( m_color_texture, 0 );
     kvs::Texture::Binder unit1( m_position_texture, 1 );
     kvs::Texture::Binder unit2( m_normal_texture, 2 );
@@ -79,9 +267,33 @@ void AmbientOcclusionBuffer::draw()
 
     const auto noise_scale = 1.0f / static_cast<float>( m_noise_size );
     m_occl_pass_shader.setUniform( "noise_scale", kvs::Vec2( noise_scale, noise_scale ) );
-    m_occl_pass_shader.setUniform( "kernel_radius", m_kernel_radius );
-    m_occl_pass_shader.setUniform( "kernel_bias", m_kernel_bias );
-    m_occl_pass_shader.setUniform( "intensity", m_intensity );
+    const auto max_stride = kvs::Math::Max( m_kernel_size, size_t( 1 ) );
+    const auto kernel_stride = kvs::Math::Clamp( m_kernel_stride, size_t( 1 ), max_stride );
+    m_occl_pass_shader.setUniform( "kernel_stride", int( kernel_stride ) );
+    m_occl_pass_shader.setUniform( "coverage_alpha", m_coverage_alpha ? 1 : 0 );
+
+    kvs::OpenGL::Enable( GL_DEPTH_TEST );
+    kvs::OpenGL::Enable( GL_TEXTURE_2D );
+    ::Draw();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Upscales the shaded color in the scaled resolution to the frame
+ *          resolution with the Catmull-Rom (bicubic) filter.
+ */
+/*===========================================================================*/
+void AmbientOcclusionBuffer::draw_upscale_pass()
+{
+    kvs::ProgramObject::Binder bind( m_upscale_pass_shader );
+    kvs::Texture::Binder unit0( m_scaled_color_texture, 0 );
+    kvs::Texture::Binder unit1( m_scaled_depth_texture, 1 );
+    m_upscale_pass_shader.setUniform( "color_texture", 0 );
+    m_upscale_pass_shader.setUniform( "depth_texture", 1 );
+
+    const auto width = static_cast<float>( m_width );
+    const auto height = static_cast<float>( m_height );
+    m_upscale_pass_shader.setUniform( "texture_size", kvs::Vec2( width, height ) );
 
     kvs::OpenGL::Enable( GL_DEPTH_TEST );
     kvs::OpenGL::Enable( GL_TEXTURE_2D );
@@ -92,6 +304,7 @@ void AmbientOcclusionBuffer::release()
 {
     // Release occl pas shader resources
     m_occl_pass_shader.release();
+    m_upscale_pass_shader.release();
 
     // Release framebuffer resources
     m_framebuffer.release();
@@ -99,6 +312,11 @@ void AmbientOcclusionBuffer::release()
     m_position_texture.release();
     m_normal_texture.release();
     m_depth_texture.release();
+    m_scaled_framebuffer.release();
+    m_scaled_color_texture.release();
+    m_scaled_depth_texture.release();
+    this->releaseLayer();
+    this->releaseDepthCopy();
 
     // Release kernel texture resources
     m_kernel_texture.release();
@@ -127,20 +345,23 @@ void AmbientOcclusionBuffer::createShaderProgram(
             {
                 frag.define("ENABLE_TWO_SIDE_LIGHTING");
             }
-
-            if ( m_drawing_occlusion_factor )
-            {
-                frag.define( "ENABLE_DRAWING_OCCLUSION_FACTOR" );
-            }
         }
 
         m_occl_pass_shader.build( vert, frag );
     }
 
+    // Build shader for upscale-pass.
+    {
+        kvs::ShaderSource vert( m_occl_pass_shader_vert_file );
+        kvs::ShaderSource frag( m_upscale_pass_shader_frag_file );
+        m_upscale_pass_shader.build( vert, frag );
+    }
+
+    // The parameters are applied to the new shader program in the next draw.
+    m_shading_enabled = shading_enabled;
     this->createKernelTexture( m_kernel_radius, m_kernel_size );
-    m_occl_pass_shader.bind();
-    m_occl_pass_shader.setUniform( "kernel_size", int( m_kernel_size ) );
-    m_occl_pass_shader.unbind();
+    m_kernel_changed = false;
+    m_parameter_changed = true;
 }
 
 void AmbientOcclusionBuffer::updateShaderProgram(
@@ -148,6 +369,7 @@ void AmbientOcclusionBuffer::updateShaderProgram(
     const bool shading_enabled )
 {
     m_occl_pass_shader.release();
+    m_upscale_pass_shader.release();
     this->createShaderProgram( shading_model, shading_enabled );
 }
 
@@ -168,9 +390,13 @@ void AmbientOcclusionBuffer::setupShaderProgram(
 }
 
 void AmbientOcclusionBuffer::createFramebuffer(
-    const size_t width,
-    const size_t height )
+    const size_t frame_width,
+    const size_t frame_height )
 {
+    // The G-buffer is allocated in the scaled resolution.
+    const size_t width = ::ScaledSize( frame_width, m_render_scale );
+    const size_t height = ::ScaledSize( frame_height, m_render_scale );
+
     m_color_texture.setWrapS( GL_CLAMP_TO_EDGE );
     m_color_texture.setWrapT( GL_CLAMP_TO_EDGE );
     m_color_texture.setMagFilter( GL_LINEAR );
@@ -204,6 +430,21 @@ void AmbientOcclusionBuffer::createFramebuffer(
     m_framebuffer.attachColorTexture( m_position_texture, 1 );
     m_framebuffer.attachColorTexture( m_normal_texture, 2 );
     m_framebuffer.attachDepthTexture( m_depth_texture );
+
+    m_width = width;
+    m_height = height;
+    m_frame_width = frame_width;
+    m_frame_height = frame_height;
+
+    // Target of the occlusion pass to be upscaled.
+    if ( this->isScaled() )
+    {
+        ::CreateTexture( m_scaled_color_texture, GL_RGBA, GL_RGBA, width, height );
+        ::CreateTexture( m_scaled_depth_texture, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, width, height );
+        m_scaled_framebuffer.create();
+        m_scaled_framebuffer.attachColorTexture( m_scaled_color_texture, 0 );
+        m_scaled_framebuffer.attachDepthTexture( m_scaled_depth_texture );
+    }
 }
 
 void AmbientOcclusionBuffer::updateFramebuffer(
@@ -215,9 +456,110 @@ void AmbientOcclusionBuffer::updateFramebuffer(
     m_normal_texture.release();
     m_depth_texture.release();
     m_framebuffer.release();
+    m_scaled_framebuffer.release();
+    m_scaled_color_texture.release();
+    m_scaled_depth_texture.release();
+    this->releaseLayer();
+    this->releaseDepthCopy();
     this->createFramebuffer( width, height );
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Stores the current contents of the G-buffer into the cached layer.
+ */
+/*===========================================================================*/
+void AmbientOcclusionBuffer::storeLayer()
+{
+    if ( !m_layer_framebuffer.isCreated() )
+    {
+        ::CreateTexture( m_layer_color_texture, GL_RGBA, GL_RGBA, m_width, m_height );
+        ::CreateTexture( m_layer_position_texture, GL_RGBA32F_ARB, GL_RGBA, m_width, m_height );
+        ::CreateTexture( m_layer_normal_texture, GL_RGBA32F_ARB, GL_RGBA, m_width, m_height );
+        ::CreateTexture( m_layer_depth_texture, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, m_width, m_height );
+
+        m_layer_framebuffer.create();
+        m_layer_framebuffer.attachColorTexture( m_layer_color_texture, 0 );
+        m_layer_framebuffer.attachColorTexture( m_layer_position_texture, 1 );
+        m_layer_framebuffer.attachColorTexture( m_layer_normal_texture, 2 );
+        m_layer_framebuffer.attachDepthTexture( m_layer_depth_texture );
+    }
+
+    const GLuint bound_id = kvs::OpenGL::Integer( GL_FRAMEBUFFER_BINDING );
+    KVS_GL_CALL( glBindFramebufferEXT( GL_READ_FRAMEBUFFER_EXT, m_framebuffer.id() ) );
+    KVS_GL_CALL( glBindFramebufferEXT( GL_DRAW_FRAMEBUFFER_EXT, m_layer_framebuffer.id() ) );
+    ::BlitLayer( m_width, m_height );
+    KVS_GL_CALL( glBindFramebufferEXT( GL_FRAMEBUFFER, bound_id ) );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Restores the cached layer into the G-buffer. This method should
+ *          be called after bind() since bind() clears the G-buffer.
+ */
+/*===========================================================================*/
+void AmbientOcclusionBuffer::restoreLayer()
+{
+    if ( !m_layer_framebuffer.isCreated() ) { return; }
+
+    KVS_GL_CALL( glBindFramebufferEXT( GL_READ_FRAMEBUFFER_EXT, m_layer_framebuffer.id() ) );
+    KVS_GL_CALL( glBindFramebufferEXT( GL_DRAW_FRAMEBUFFER_EXT, m_framebuffer.id() ) );
+    ::BlitLayer( m_width, m_height );
+    KVS_GL_CALL( glBindFramebufferEXT( GL_FRAMEBUFFER, m_framebuffer.id() ) );
+
+    // Enable MRT rendering again.
+    const GLenum buffers[3] = {
+        GL_COLOR_ATTACHMENT0_EXT,
+        GL_COLOR_ATTACHMENT1_EXT,
+        GL_COLOR_ATTACHMENT2_EXT };
+    kvs::OpenGL::SetDrawBuffers( 3, buffers );
+}
+
+void AmbientOcclusionBuffer::releaseLayer()
+{
+    m_layer_framebuffer.release();
+    m_layer_color_texture.release();
+    m_layer_position_texture.release();
+    m_layer_normal_texture.release();
+    m_layer_depth_texture.release();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Copies the current depth of the G-buffer into the depth copy
+ *          texture, which can be read by the engines drawn after the copy.
+ *          This method should be called while the G-buffer is bound.
+ */
+/*===========================================================================*/
+void AmbientOcclusionBuffer::copyDepth()
+{
+    if ( !m_depth_copy_framebuffer.isCreated() )
+    {
+        ::CreateTexture( m_depth_copy_texture, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, m_width, m_height );
+
+        m_depth_copy_framebuffer.create();
+        m_depth_copy_framebuffer.attachDepthTexture( m_depth_copy_texture );
+
+        // The framebuffer has no color attachment.
+        kvs::FrameBufferObject::GuardedBinder binder( m_depth_copy_framebuffer );
+        KVS_GL_CALL( glDrawBuffer( GL_NONE ) );
+        KVS_GL_CALL( glReadBuffer( GL_NONE ) );
+    }
+
+    KVS_GL_CALL( glBindFramebufferEXT( GL_READ_FRAMEBUFFER_EXT, m_framebuffer.id() ) );
+    KVS_GL_CALL( glBindFramebufferEXT( GL_DRAW_FRAMEBUFFER_EXT, m_depth_copy_framebuffer.id() ) );
+    KVS_GL_CALL( glBlitFramebufferEXT(
+                     0, 0, m_width, m_height, 0, 0, m_width, m_height,
+                     GL_DEPTH_BUFFER_BIT, GL_NEAREST ) );
+    KVS_GL_CALL( glBindFramebufferEXT( GL_FRAMEBUFFER, m_framebuffer.id() ) );
+}
+
+void AmbientOcclusionBuffer::releaseDepthCopy()
+{
+    m_depth_copy_framebuffer.release();
+    m_depth_copy_texture.release();
+}
+
 void AmbientOcclusionBuffer::createKernelTexture(
     const float radius,
     const size_t nsamples )
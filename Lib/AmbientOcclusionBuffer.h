@@ -3,6 +3,7 @@
 #include <kvs/ProgramObject>
 #include <kvs/FrameBufferObject>
 #include <kvs/Texture2D>
+#include <kvs/Vector4>
 #include <kvs/Shader>
 #include <kvs/Deprecated>
 
@@ -23,6 +24,10 @@ private:
     std::string m_occl_pass_shader_frag_file = "SSAO_occl_pass.frag"; ///< fragment shader file for occlusion pass
     kvs::ProgramObject m_occl_pass_shader{}; ///< shader program for occlusion-pass (2nd pass)
 
+    // Upscale pass shader
+    std::string m_upscale_pass_shader_frag_file = "SSAO_upscale_pass.frag"; ///< fragment shader file for upscale pass
+    kvs::ProgramObject m_upscale_pass_shader{}; ///< shader program for upscale-pass (used if scaled)
+
     // Framebuffer for SSAO
     GLuint m_bound_id = 0; ///< Bound framebuffer ID
     kvs::FrameBufferObject m_framebuffer{}; ///< framebuffer object
@@ -30,10 +35,33 @@ private:
     kvs::Texture2D m_position_texture{}; ///< texture for storing position information
     kvs::Texture2D m_normal_texture{}; ///< texture for storing normal vector
     kvs::Texture2D m_depth_texture{}; ///< depth texture
+    size_t m_width = 0; ///< framebuffer width (scaled)
+    size_t m_height = 0; ///< framebuffer height (scaled)
+
+    // Scaled rendering
+    float m_render_scale = 1.0f; ///< ratio of the framebuffer size to the frame size
+    size_t m_frame_width = 0; ///< frame width (output resolution)
+    size_t m_frame_height = 0; ///< frame height (output resolution)
+    kvs::Vec4i m_viewport{}; ///< viewport saved in bind()
+    kvs::FrameBufferObject m_scaled_framebuffer{}; ///< framebuffer for occlusion pass in the scaled resolution
+    kvs::Texture2D m_scaled_color_texture{}; ///< shaded color texture in the scaled resolution
+    kvs::Texture2D m_scaled_depth_texture{}; ///< depth texture in the scaled resolution
+
+    // Cached layer for opaque objects
+    kvs::FrameBufferObject m_layer_framebuffer{}; ///< framebuffer object for the cached layer
+    kvs::Texture2D m_layer_color_texture{}; ///< cached color texture
+    kvs::Texture2D m_layer_position_texture{}; ///< cached position texture
+    kvs::Texture2D m_layer_normal_texture{}; ///< cached normal texture
+    kvs::Texture2D m_layer_depth_texture{}; ///< cached depth texture
+
+    // Copy of the depth buffer read by the engines
+    kvs::FrameBufferObject m_depth_copy_framebuffer{}; ///< framebuffer object for the depth copy
+    kvs::Texture2D m_depth_copy_texture{}; ///< copied depth texture
 
     // Sampling kernel
     kvs::Real32 m_kernel_radius = 0.5f; ///< radius of kernel sphere used for point sampling
     size_t m_kernel_size = 256; ///< number of sampling points
+    size_t m_kernel_stride = 1; ///< stride of the sampling points used in the occlusion pass
     float m_kernel_bias = 0.0f; ///< tolerance factor for depth comparison
     kvs::Texture1D m_kernel_texture{}; ///< sampling point texture
     float m_intensity = 1.0f; ///< occlusion intensity
@@ -41,6 +69,12 @@ private:
     kvs::Texture2D m_noise_texture{}; ///< noise texture used to rotate the kernel
 
     bool m_drawing_occlusion_factor = false; ///< flag for drawing occlusion factor
+    bool m_coverage_alpha = false; ///< flag for using the color alpha as the pixel coverage
+    bool m_shading_enabled = true; ///< flag for shading in the occlusion pass
+
+    // Dirty flags applied in the next draw
+    bool m_kernel_changed = false; ///< true if the kernel texture needs to be updated
+    bool m_parameter_changed = true; ///< true if the uniform parameters need to be updated
 
 public:
     AmbientOcclusionBuffer() = default;
@@ -54,11 +88,14 @@ public:
         m_occl_pass_shader_frag_file = frag_file;
     }
 
-    void setKernelRadius( const kvs::Real32 radius ) { m_kernel_radius = radius; }
-    void setKernelSize( const size_t nsamples ) { m_kernel_size = nsamples; }
-    void setKernelBias( const float bias ) { m_kernel_bias = bias; }
-    void setIntensity( const float intensity ) { m_intensity = intensity; }
-    void setDrawingOcclusionFactorEnabled( const bool enabled = true ) { m_drawing_occlusion_factor = enabled; }
+    void setKernelRadius( const kvs::Real32 radius );
+    void setKernelSize( const size_t nsamples );
+    void setKernelBias( const float bias );
+    void setKernelStride( const size_t stride );
+    void setIntensity( const float intensity );
+    void setDrawingOcclusionFactorEnabled( const bool enabled = true );
+    void setCoverageAlphaEnabled( const bool enabled = true ) { m_coverage_alpha = enabled; }
+    void setRenderScale( const float scale ) { m_render_scale = scale; }
 
     const std::string& occlusionPassVertexShaderFile() const { return m_occl_pass_shader_vert_file; }
     const std::string& occlusionPassFragmentShaderFile() const { return m_occl_pass_shader_frag_file; }
@@ -69,11 +106,19 @@ public:
     kvs::Texture2D& positionTexture() { return m_position_texture; }
     kvs::Texture2D& normalTexture() { return m_normal_texture; }
     kvs::Texture2D& depthTexture() { return m_depth_texture; }
+    kvs::Texture2D& depthCopyTexture() { return m_depth_copy_texture; }
+
+    float renderScale() const { return m_render_scale; }
+    size_t width() const { return m_width; }
+    size_t height() const { return m_height; }
+    bool isScaled() const { return m_width != m_frame_width || m_height != m_frame_height; }
 
     kvs::Real32 kernelRadius() const { return m_kernel_radius; }
     size_t kernelSize() const { return m_kernel_size; }
     float kernelBias() const { return m_kernel_bias; }
+    size_t kernelStride() const { return m_kernel_stride; }
     float intensity() const { return m_intensity; }
+    bool isDrawingOcclusionFactorEnabled() const { return m_drawing_occlusion_factor; }
 
     void bind();
     void unbind();
@@ -87,6 +132,13 @@ public:
     void updateFramebuffer( const size_t width, const size_t height );
     void renderOcclusionPass() { this->draw(); }
 
+    void storeLayer();
+    void restoreLayer();
+    void releaseLayer();
+
+    void copyDepth();
+    void releaseDepthCopy();
+
     void createKernelTexture( const float radius, const size_t nsamples );
     void updateKernelTexture( const float radius, const size_t nsamples );
     kvs::ValueArray<GLfloat> generatePoints( const float radius, const size_t nsamples );
@@ -96,6 +148,11 @@ public:
     KVS_DEPRECATED( void setNumberOfSamplingPoints( const size_t nsamples ) ) { this->setKernelSize( nsamples ); }
     KVS_DEPRECATED( kvs::Real32 samplingSphereRadius() const ) { return this->kernelRadius(); }
     KVS_DEPRECATED( size_t numberOfSamplingPoints() const ) { return this->kernelSize(); }
+
+private:
+    void update_parameters();
+    void draw_occlusion_pass();
+    void draw_upscale_pass();
 };
 
 } // end of namespace AmbientOcclusionRendering
@@ -0,0 +1,398 @@
+#include "BrickedVolumeBuffer.h"
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <kvs/OpenGL>
+#include <kvs/Math>
+#include <kvs/Message>
+#include <kvs/Assert>
+#include <kvs/Vector4>
+
+
+namespace
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Extracts the normalized values of the brick.
+ *  @param  values [in] values of the volume
+ *  @param  resolution [in] volume resolution
+ *  @param  origin [in] first voxel of the brick
+ *  @param  size [in] number of the voxels along each edge of the brick
+ *  @param  scale [in] scale from the data value to the normalized value
+ *  @param  offset [in] offset from the data value to the normalized value
+ *  @param  data [out] normalized values quantized to 16 bits
+ *
+ *  The voxels outside the volume are clamped to the boundary of the volume.
+ */
+/*===========================================================================*/
+template <typename T>
+inline void ExtractBrick(
+    const kvs::AnyValueArray& values,
+    const kvs::Vec3ui& resolution,
+    const kvs::Vec3ui& origin,
+    const size_t size,
+    const float scale,
+    const float offset,
+    kvs::UInt16* data )
+{
+    const T* v = static_cast<const T*>( values.data() );
+    const size_t line_size = resolution.x();
+    const size_t slice_size = size_t( resolution.x() ) * resolution.y();
+    for ( size_t k = 0; k < size; k++ )
+    {
+        const size_t z = kvs::Math::Min( size_t( origin.z() ) + k, size_t( resolution.z() - 1 ) );
+        for ( size_t j = 0; j < size; j++ )
+        {
+            const size_t y = kvs::Math::Min( size_t( origin.y() ) + j, size_t( resolution.y() - 1 ) );
+            for ( size_t i = 0; i < size; i++ )
+            {
+                const size_t x = kvs::Math::Min( size_t( origin.x() ) + i, size_t( resolution.x() - 1 ) );
+                const float w = static_cast<float>( v[ x + line_size * y + slice_size * z ] ) * scale + offset;
+                *( data++ ) = static_cast<kvs::UInt16>( kvs::Math::Clamp( w, 0.0f, 1.0f ) * 65535.0f + 0.5f );
+            }
+        }
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the clip-space depth of the brick if it is in the view frustum.
+ *  @param  object_to_clip [in] matrix from object coordinate to clip coordinate
+ *  @param  min_coord [in] min. coordinate of the brick
+ *  @param  max_coord [in] max. coordinate of the brick
+ *  @param  depth [out] clip-space depth of the brick center
+ *  @return true if the brick may be visible
+ */
+/*===========================================================================*/
+inline bool IsInFrustum(
+    const kvs::Mat4& object_to_clip,
+    const kvs::Vec3& min_coord,
+    const kvs::Vec3& max_coord,
+    float* depth )
+{
+    // The brick is outside if all of the corners are outside of a plane.
+    int outside[6] = { 0, 0, 0, 0, 0, 0 };
+    for ( int i = 0; i < 8; i++ )
+    {
+        const kvs::Vec4 p = object_to_clip * kvs::Vec4(
+            ( i & 1 ) ? max_coord.x() : min_coord.x(),
+            ( i & 2 ) ? max_coord.y() : min_coord.y(),
+            ( i & 4 ) ? max_coord.z() : min_coord.z(),
+            1.0f );
+        if ( p.x() < -p.w() ) { outside[0]++; }
+        if ( p.x() > p.w() ) { outside[1]++; }
+        if ( p.y() < -p.w() ) { outside[2]++; }
+        if ( p.y() > p.w() ) { outside[3]++; }
+        if ( p.z() < -p.w() ) { outside[4]++; }
+        if ( p.z() > p.w() ) { outside[5]++; }
+    }
+    for ( int i = 0; i < 6; i++ ) { if ( outside[i] == 8 ) { return false; } }
+
+    const kvs::Vec4 center = object_to_clip * kvs::Vec4( ( min_coord + max_coord ) * 0.5f, 1.0f );
+    *depth = center.z();
+    return true;
+}
+
+} // end of namespace
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the number of the bricks resident in the atlas.
+ *  @return number of the resident bricks
+ */
+/*===========================================================================*/
+size_t BrickedVolumeBuffer::numberOfResidentBricks() const
+{
+    return std::count_if( m_slot_bricks.begin(), m_slot_bricks.end(), [] ( int b ) { return b >= 0; } );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates the atlas and the page table for the volume.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @return true if the volume is supported
+ *
+ *  No brick is uploaded here. The bricks are uploaded by update().
+ */
+/*===========================================================================*/
+bool BrickedVolumeBuffer::create( const kvs::StructuredVolumeObject* volume )
+{
+    if ( volume->veclen() != 1 )
+    {
+        kvsMessageWarning( "The bricked volume is not supported for the vector volume." );
+        return false;
+    }
+
+    // The normalized values are mapped to the scalar values by the shader in
+    // the same way as the dense volume texture.
+    const std::type_info& type = volume->values().typeInfo()->type();
+    const float min_value = static_cast<float>( volume->minValue() );
+    const float max_value = static_cast<float>( volume->maxValue() );
+    if ( type == typeid( kvs::UInt8 ) ) { m_scale = 1.0f / 255.0f; m_offset = 0.0f; }
+    else if ( type == typeid( kvs::UInt16 ) ) { m_scale = 1.0f / 65535.0f; m_offset = 0.0f; }
+    else if ( type == typeid( kvs::Int16 ) ) { m_scale = 1.0f / 65535.0f; m_offset = 32768.0f / 65535.0f; }
+    else if ( type == typeid( kvs::UInt32 ) ||
+              type == typeid( kvs::Int32 ) ||
+              type == typeid( kvs::Real32 ) ||
+              type == typeid( kvs::Real64 ) )
+    {
+        m_scale = max_value > min_value ? 1.0f / ( max_value - min_value ) : 1.0f;
+        m_offset = -min_value * m_scale;
+    }
+    else
+    {
+        kvsMessageWarning( "The bricked volume is not supported for '%s'.",
+                           volume->values().typeInfo()->typeName() );
+        return false;
+    }
+
+    m_values = volume->values();
+    m_resolution = volume->resolution();
+
+    const size_t size = m_brick_size;
+    m_grid_resolution = kvs::Vec3ui(
+        static_cast<unsigned int>( ( m_resolution.x() - 1 ) / size + 1 ),
+        static_cast<unsigned int>( ( m_resolution.y() - 1 ) / size + 1 ),
+        static_cast<unsigned int>( ( m_resolution.z() - 1 ) / size + 1 ) );
+    const size_t nbricks = size_t( m_grid_resolution.x() ) * m_grid_resolution.y() * m_grid_resolution.z();
+
+    // Number of the slots within the memory budget. The slot index along each
+    // axis is stored in 8 bits of the page table.
+    const size_t n = size + 1;
+    const size_t brick_bytes = n * n * n * sizeof( kvs::UInt16 );
+    const size_t max_texture_size = static_cast<size_t>( kvs::OpenGL::Integer( GL_MAX_3D_TEXTURE_SIZE ) );
+    const size_t max_slots = kvs::Math::Clamp( max_texture_size / n, size_t( 1 ), size_t( 256 ) );
+    const size_t capacity = kvs::Math::Clamp( m_memory_budget / brick_bytes, size_t( 1 ), nbricks );
+    const size_t a = kvs::Math::Clamp( static_cast<size_t>( std::cbrt( double( capacity ) ) ), size_t( 1 ), max_slots );
+    const size_t c = kvs::Math::Clamp( capacity / ( a * a ), size_t( 1 ), max_slots );
+    m_atlas_resolution = kvs::Vec3ui( a, a, c );
+
+    const size_t nslots = a * a * c;
+    m_brick_slots.assign( nbricks, -1 );
+    m_slot_bricks.assign( nslots, -1 );
+    m_slot_frames.assign( nslots, 0 );
+    m_frame = 0;
+
+    // All of the bricks are regarded as occupied until setOccupancy() is called.
+    m_occupancy.allocate( nbricks );
+    m_occupancy.fill( 255 );
+
+    m_atlas_texture.setWrapS( GL_CLAMP_TO_EDGE );
+    m_atlas_texture.setWrapT( GL_CLAMP_TO_EDGE );
+    m_atlas_texture.setWrapR( GL_CLAMP_TO_EDGE );
+    m_atlas_texture.setMagFilter( GL_LINEAR );
+    m_atlas_texture.setMinFilter( GL_LINEAR );
+    m_atlas_texture.setPixelFormat( GL_ALPHA16, GL_ALPHA, GL_UNSIGNED_SHORT );
+    m_atlas_texture.create( a * n, a * n, c * n );
+
+    m_page_table.allocate( nbricks * 4 );
+    m_page_table.fill( 0 );
+    m_page_table_texture.setWrapS( GL_CLAMP_TO_EDGE );
+    m_page_table_texture.setWrapT( GL_CLAMP_TO_EDGE );
+    m_page_table_texture.setWrapR( GL_CLAMP_TO_EDGE );
+    m_page_table_texture.setMagFilter( GL_NEAREST );
+    m_page_table_texture.setMinFilter( GL_NEAREST );
+    m_page_table_texture.setPixelFormat( GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE );
+    m_page_table_texture.create(
+        m_grid_resolution.x(), m_grid_resolution.y(), m_grid_resolution.z(), m_page_table.data() );
+    m_page_table_changed = false;
+
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Releases the textures and the bricks.
+ */
+/*===========================================================================*/
+void BrickedVolumeBuffer::release()
+{
+    m_atlas_texture.release();
+    m_page_table_texture.release();
+    m_page_table.release();
+    m_occupancy.release();
+    m_values = kvs::AnyValueArray();
+    m_brick_slots.clear();
+    m_slot_bricks.clear();
+    m_slot_frames.clear();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the occupancy of the bricks for the current transfer function.
+ *  @param  occupancy [in] occupancy of the bricks (0 if the brick is empty)
+ *
+ *  The resident bricks that become empty are evicted from the atlas.
+ */
+/*===========================================================================*/
+void BrickedVolumeBuffer::setOccupancy( const kvs::ValueArray<kvs::UInt8>& occupancy )
+{
+    KVS_ASSERT( occupancy.size() == m_brick_slots.size() );
+
+    m_occupancy = occupancy;
+    for ( size_t i = 0; i < m_brick_slots.size(); i++ )
+    {
+        if ( m_occupancy[i] == 0 && m_brick_slots[i] >= 0 ) { this->evict_brick( i ); }
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Streams the visible bricks into the atlas.
+ *  @param  object_to_clip [in] matrix from object coordinate to clip coordinate
+ *  @return number of the uploaded bricks
+ *
+ *  The visible and non-empty bricks that are not resident are uploaded in
+ *  front-to-back order, up to the maximum number of uploads. The slots of the
+ *  bricks that have not been visible for the longest time are reused when the
+ *  atlas is full.
+ */
+/*===========================================================================*/
+size_t BrickedVolumeBuffer::update( const kvs::Mat4& object_to_clip )
+{
+    m_frame++;
+
+    // Collect the visible bricks.
+    const kvs::Vec3 max_coord = kvs::Vec3( m_resolution ) - kvs::Vec3::Constant( 1.0f );
+    const float size = static_cast<float>( m_brick_size );
+    std::vector<std::pair<float,size_t>> requests;
+    size_t index = 0;
+    for ( size_t k = 0; k < m_grid_resolution.z(); k++ )
+    {
+        for ( size_t j = 0; j < m_grid_resolution.y(); j++ )
+        {
+            for ( size_t i = 0; i < m_grid_resolution.x(); i++, index++ )
+            {
+                if ( m_occupancy[ index ] == 0 ) { continue; }
+
+                const kvs::Vec3 min_brick( i * size, j * size, k * size );
+                const kvs::Vec3 max_brick(
+                    kvs::Math::Min( min_brick.x() + size, max_coord.x() ),
+                    kvs::Math::Min( min_brick.y() + size, max_coord.y() ),
+                    kvs::Math::Min( min_brick.z() + size, max_coord.z() ) );
+                float depth = 0.0f;
+                if ( !::IsInFrustum( object_to_clip, min_brick, max_brick, &depth ) ) { continue; }
+
+                const int slot = m_brick_slots[ index ];
+                if ( slot >= 0 ) { m_slot_frames[ slot ] = m_frame; }
+                else { requests.push_back( std::make_pair( depth, index ) ); }
+            }
+        }
+    }
+
+    // Upload the nearest bricks first.
+    std::sort( requests.begin(), requests.end() );
+    const size_t nrequests = kvs::Math::Min( requests.size(), m_max_uploads );
+    size_t nuploads = 0;
+    for ( size_t i = 0; i < nrequests; i++, nuploads++ )
+    {
+        const int slot = this->find_slot();
+        if ( slot < 0 ) { break; } // all of the slots are used by the visible bricks
+
+        const int evicted = m_slot_bricks[ slot ];
+        if ( evicted >= 0 ) { this->evict_brick( evicted ); }
+        this->upload_brick( requests[i].second, slot );
+        m_slot_frames[ slot ] = m_frame;
+    }
+
+    if ( m_page_table_changed )
+    {
+        kvs::Texture::Binder binder( m_page_table_texture );
+        m_page_table_texture.load(
+            m_grid_resolution.x(), m_grid_resolution.y(), m_grid_resolution.z(), m_page_table.data() );
+        m_page_table_changed = false;
+    }
+
+    return nuploads;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns a free slot or the least recently visible slot.
+ *  @return slot index (-1 if all of the slots are visible in this update)
+ */
+/*===========================================================================*/
+int BrickedVolumeBuffer::find_slot() const
+{
+    int lru = -1;
+    for ( size_t i = 0; i < m_slot_bricks.size(); i++ )
+    {
+        if ( m_slot_bricks[i] < 0 ) { return static_cast<int>( i ); }
+        if ( m_slot_frames[i] < m_frame && ( lru < 0 || m_slot_frames[i] < m_slot_frames[ lru ] ) )
+        {
+            lru = static_cast<int>( i );
+        }
+    }
+    return lru;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Uploads the brick to the slot of the atlas.
+ *  @param  brick [in] brick index
+ *  @param  slot [in] slot index
+ */
+/*===========================================================================*/
+void BrickedVolumeBuffer::upload_brick( const size_t brick, const size_t slot )
+{
+    const size_t gx = m_grid_resolution.x();
+    const size_t gy = m_grid_resolution.y();
+    const size_t size = m_brick_size;
+    const kvs::Vec3ui origin(
+        static_cast<unsigned int>( ( brick % gx ) * size ),
+        static_cast<unsigned int>( ( brick / gx % gy ) * size ),
+        static_cast<unsigned int>( ( brick / ( gx * gy ) ) * size ) );
+
+    const size_t n = size + 1;
+    kvs::ValueArray<kvs::UInt16> data( n * n * n );
+    const std::type_info& type = m_values.typeInfo()->type();
+    if ( type == typeid( kvs::UInt8 ) ) { ::ExtractBrick<kvs::UInt8>( m_values, m_resolution, origin, n, m_scale, m_offset, data.data() ); }
+    else if ( type == typeid( kvs::UInt16 ) ) { ::ExtractBrick<kvs::UInt16>( m_values, m_resolution, origin, n, m_scale, m_offset, data.data() ); }
+    else if ( type == typeid( kvs::Int16 ) ) { ::ExtractBrick<kvs::Int16>( m_values, m_resolution, origin, n, m_scale, m_offset, data.data() ); }
+    else if ( type == typeid( kvs::UInt32 ) ) { ::ExtractBrick<kvs::UInt32>( m_values, m_resolution, origin, n, m_scale, m_offset, data.data() ); }
+    else if ( type == typeid( kvs::Int32 ) ) { ::ExtractBrick<kvs::Int32>( m_values, m_resolution, origin, n, m_scale, m_offset, data.data() ); }
+    else if ( type == typeid( kvs::Real32 ) ) { ::ExtractBrick<kvs::Real32>( m_values, m_resolution, origin, n, m_scale, m_offset, data.data() ); }
+    else if ( type == typeid( kvs::Real64 ) ) { ::ExtractBrick<kvs::Real64>( m_values, m_resolution, origin, n, m_scale, m_offset, data.data() ); }
+
+    const size_t ax = m_atlas_resolution.x();
+    const size_t ay = m_atlas_resolution.y();
+    const size_t sx = slot % ax;
+    const size_t sy = slot / ax % ay;
+    const size_t sz = slot / ( ax * ay );
+    {
+        kvs::Texture::Binder binder( m_atlas_texture );
+        m_atlas_texture.load( n, n, n, data.data(), sx * n, sy * n, sz * n );
+    }
+
+    m_brick_slots[ brick ] = static_cast<int>( slot );
+    m_slot_bricks[ slot ] = static_cast<int>( brick );
+    m_page_table[ 4 * brick + 0 ] = static_cast<kvs::UInt8>( sx );
+    m_page_table[ 4 * brick + 1 ] = static_cast<kvs::UInt8>( sy );
+    m_page_table[ 4 * brick + 2 ] = static_cast<kvs::UInt8>( sz );
+    m_page_table[ 4 * brick + 3 ] = 255;
+    m_page_table_changed = true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Evicts the brick from the atlas.
+ *  @param  brick [in] brick index
+ */
+/*===========================================================================*/
+void BrickedVolumeBuffer::evict_brick( const size_t brick )
+{
+    const int slot = m_brick_slots[ brick ];
+    if ( slot < 0 ) { return; }
+
+    m_slot_bricks[ slot ] = -1;
+    m_brick_slots[ brick ] = -1;
+    m_page_table[ 4 * brick + 3 ] = 0;
+    m_page_table_changed = true;
+}
+
+} // end of namespace AmbientOcclusionRendering
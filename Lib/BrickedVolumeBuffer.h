@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <kvs/Type>
+#include <kvs/Vector3>
+#include <kvs/Matrix44>
+#include <kvs/ValueArray>
+#include <kvs/AnyValueArray>
+#include <kvs/Texture3D>
+#include <kvs/StructuredVolumeObject>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Bricked and sparse volume buffer for the uniform grid renderer.
+ *
+ *  The volume is divided into bricks, and the bricks are stored in a 3D
+ *  texture atlas whose size is limited by the memory budget. The page table
+ *  texture gives the slot of each brick in the atlas. The empty bricks, which
+ *  are mapped to zero opacity by the transfer function, are never uploaded,
+ *  and the visible bricks are streamed into the atlas on demand by evicting
+ *  the least recently visible bricks. The adjacent bricks share the voxels on
+ *  their boundary, so that the trilinear interpolation in a brick is exact.
+ */
+/*===========================================================================*/
+class BrickedVolumeBuffer
+{
+private:
+    size_t m_brick_size = 32; ///< brick size in voxels (excluding the shared boundary)
+    size_t m_memory_budget = 512 * 1024 * 1024; ///< memory budget of the atlas in bytes
+    size_t m_max_uploads = 32; ///< maximum number of bricks uploaded in an update
+
+    // Volume data
+    kvs::AnyValueArray m_values{}; ///< values of the volume (shallow copy)
+    kvs::Vec3ui m_resolution{}; ///< volume resolution
+    float m_scale = 1.0f; ///< scale from the data value to the normalized value
+    float m_offset = 0.0f; ///< offset from the data value to the normalized value
+
+    // Bricks
+    kvs::Vec3ui m_grid_resolution{}; ///< number of the bricks
+    kvs::Vec3ui m_atlas_resolution{}; ///< number of the brick slots in the atlas
+    kvs::ValueArray<kvs::UInt8> m_occupancy{}; ///< occupancy of the bricks
+    std::vector<int> m_brick_slots{}; ///< slot of each brick (-1 if not resident)
+    std::vector<int> m_slot_bricks{}; ///< brick in each slot (-1 if free)
+    std::vector<size_t> m_slot_frames{}; ///< last update in which each slot was visible
+    size_t m_frame = 0; ///< update counter
+
+    // Textures
+    bool m_page_table_changed = true; ///< flag for changing page table
+    kvs::ValueArray<kvs::UInt8> m_page_table{}; ///< slot (xyz) and residency (w) of each brick
+    kvs::Texture3D m_atlas_texture{}; ///< brick atlas texture
+    kvs::Texture3D m_page_table_texture{}; ///< page table texture
+
+public:
+    BrickedVolumeBuffer() = default;
+    virtual ~BrickedVolumeBuffer() { this->release(); }
+
+    void setBrickSize( const size_t size ) { m_brick_size = size; }
+    void setMemoryBudget( const size_t bytes ) { m_memory_budget = bytes; }
+    void setMaxUploads( const size_t count ) { m_max_uploads = count; }
+    size_t brickSize() const { return m_brick_size; }
+    size_t memoryBudget() const { return m_memory_budget; }
+    size_t maxUploads() const { return m_max_uploads; }
+
+    const kvs::Vec3ui& gridResolution() const { return m_grid_resolution; }
+    kvs::Vec3 atlasSize() const { return kvs::Vec3( m_atlas_resolution ) * float( m_brick_size + 1 ); }
+    size_t numberOfResidentBricks() const;
+    kvs::Texture3D& atlasTexture() { return m_atlas_texture; }
+    kvs::Texture3D& pageTableTexture() { return m_page_table_texture; }
+    bool isCreated() const { return m_atlas_texture.isCreated(); }
+
+    bool create( const kvs::StructuredVolumeObject* volume );
+    void release();
+
+    void setOccupancy( const kvs::ValueArray<kvs::UInt8>& occupancy );
+    size_t update( const kvs::Mat4& object_to_clip );
+
+private:
+    int find_slot() const;
+    void upload_brick( const size_t brick, const size_t slot );
+    void evict_brick( const size_t brick );
+};
+
+} // end of namespace AmbientOcclusionRendering
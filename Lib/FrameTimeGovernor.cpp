@@ -0,0 +1,121 @@
+#include "FrameTimeGovernor.h"
+#include <kvs/Math>
+#include <cmath>
+
+
+namespace
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the relative cost of the AO pass with the kernel stride.
+ *  @param  stride [in] stride of the kernel samples
+ *  @return relative cost (1 for the full kernel)
+ *
+ *  The occlusion pass is assumed to take about half of the frame time.
+ */
+/*===========================================================================*/
+inline float KernelCost( const size_t stride )
+{
+    return 0.5f + 0.5f / static_cast<float>( stride );
+}
+
+} // end of namespace
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Updates the quality settings for the current frame.
+ *  @param  repetition_level [in] repetitions for the full quality
+ *  @param  modelview [in] modelview matrix of the current frame
+ *  @param  light_position [in] light position of the current frame
+ *  @param  frame_time [in] measured frame time of the previous frame in msec
+ */
+/*===========================================================================*/
+void FrameTimeGovernor::update(
+    const size_t repetition_level,
+    const kvs::Mat4& modelview,
+    const kvs::Vec3& light_position,
+    const float frame_time )
+{
+    // Estimate the frame time with the full quality from the previous frame,
+    // and then move the budget halfway to the ratio of the target to it.
+    if ( frame_time > 0.0f )
+    {
+        const float full_frame_time = frame_time / this->cost();
+        const float budget = m_target_frame_time / full_frame_time;
+        m_budget = kvs::Math::Clamp( 0.5f * ( m_budget + budget ), 0.001f, 1.0f );
+    }
+
+    m_interactive = ( m_modelview != modelview || m_light_position != light_position );
+    m_modelview = modelview;
+    m_light_position = light_position;
+    m_repetition_level = kvs::Math::Max( repetition_level, size_t( 1 ) );
+
+    if ( m_interactive ) { this->allocate(); }
+    else
+    {
+        m_repetitions = m_repetition_level;
+        m_kernel_stride = 1;
+        m_render_scale = 1.0f;
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Resets the governor to the full quality settings.
+ */
+/*===========================================================================*/
+void FrameTimeGovernor::reset()
+{
+    m_budget = 1.0f;
+    m_repetitions = m_repetition_level;
+    m_kernel_stride = 1;
+    m_render_scale = 1.0f;
+    m_interactive = false;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the cost of the current settings relative to the full quality.
+ *  @return relative cost
+ */
+/*===========================================================================*/
+float FrameTimeGovernor::cost() const
+{
+    const float r = static_cast<float>( m_repetitions ) / m_repetition_level;
+    return r * ::KernelCost( m_kernel_stride ) * m_render_scale * m_render_scale;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Allocates the budget to the repetitions, the kernel stride and the
+ *          render scale in this order.
+ */
+/*===========================================================================*/
+void FrameTimeGovernor::allocate()
+{
+    // Repetitions
+    const float level = static_cast<float>( m_repetition_level );
+    const size_t repetitions = static_cast<size_t>( m_budget * level + 0.5f );
+    m_repetitions = kvs::Math::Clamp( repetitions, size_t( 1 ), m_repetition_level );
+
+    // Kernel stride (power of two)
+    const float budget = m_budget * level / m_repetitions; // budget for the repetitions
+    float remain = budget;
+    m_kernel_stride = 1;
+    while ( remain < 1.0f && m_kernel_stride < m_max_kernel_stride )
+    {
+        m_kernel_stride *= 2;
+        remain = budget / ::KernelCost( m_kernel_stride );
+    }
+
+    // Render scale (quantized in steps of 1/8)
+    const float scale = std::floor( std::sqrt( kvs::Math::Min( remain, 1.0f ) ) * 8.0f ) / 8.0f;
+    m_render_scale = kvs::Math::Clamp( scale, m_min_render_scale, 1.0f );
+}
+
+} // end of namespace AmbientOcclusionRendering
@@ -0,0 +1,68 @@
+#pragma once
+#include <kvs/Type>
+#include <kvs/Vector3>
+#include <kvs/Matrix44>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Frame-time governor for the SSAO stochastic rendering.
+ *
+ *  While the camera, the object or the light is moving, the governor lowers
+ *  the number of repetitions, the number of the AO kernel samples (as the
+ *  kernel stride) and the render scale in this order so that the frame time
+ *  approaches the target frame time. The render scale is quantized in steps
+ *  of 1/8 to avoid reallocating the render targets in every frame. The full
+ *  quality settings are restored when the scene becomes idle.
+ */
+/*===========================================================================*/
+class FrameTimeGovernor
+{
+private:
+    float m_target_frame_time = 1000.0f / 30.0f; ///< target frame time in msec
+    size_t m_max_kernel_stride = 8; ///< maximum stride of the kernel samples
+    float m_min_render_scale = 0.5f; ///< minimum render scale
+    float m_budget = 1.0f; ///< ratio of the allowed cost to the full quality cost
+
+    // Quality settings for the current frame
+    size_t m_repetition_level = 1; ///< repetitions for the full quality
+    size_t m_repetitions = 1; ///< number of repetitions
+    size_t m_kernel_stride = 1; ///< stride of the kernel samples
+    float m_render_scale = 1.0f; ///< render scale
+    bool m_interactive = false; ///< true if the scene is moving
+
+    // Scene state of the previous frame
+    kvs::Mat4 m_modelview{}; ///< modelview matrix
+    kvs::Vec3 m_light_position{}; ///< light position
+
+public:
+    FrameTimeGovernor() = default;
+
+    void setTargetFrameTime( const float msec ) { m_target_frame_time = msec; }
+    void setMaxKernelStride( const size_t stride ) { m_max_kernel_stride = stride; }
+    void setMinRenderScale( const float scale ) { m_min_render_scale = scale; }
+    float targetFrameTime() const { return m_target_frame_time; }
+    size_t maxKernelStride() const { return m_max_kernel_stride; }
+    float minRenderScale() const { return m_min_render_scale; }
+
+    size_t repetitions() const { return m_repetitions; }
+    size_t kernelStride() const { return m_kernel_stride; }
+    float renderScale() const { return m_render_scale; }
+    bool isInteractive() const { return m_interactive; }
+
+    void update(
+        const size_t repetition_level,
+        const kvs::Mat4& modelview,
+        const kvs::Vec3& light_position,
+        const float frame_time );
+    void reset();
+
+private:
+    float cost() const;
+    void allocate();
+};
+
+} // end of namespace AmbientOcclusionRendering
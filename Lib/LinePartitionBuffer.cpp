@@ -0,0 +1,154 @@
+#include "LinePartitionBuffer.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <kvs/ValueArray>
+
+
+namespace
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the values of the polylines in the new order.
+ *  @param  values [in] values of the vertices
+ *  @param  connections [in] first and last vertices of each polyline
+ *  @param  lines [in] polylines in the new order
+ *  @param  nvertices [in] number of the vertices of the polylines
+ *  @param  veclen [in] number of the values for each vertex
+ *  @return reordered values
+ */
+/*===========================================================================*/
+template <typename T>
+inline kvs::ValueArray<T> LineValues(
+    const kvs::ValueArray<T>& values,
+    const kvs::ValueArray<kvs::UInt32>& connections,
+    const std::vector<kvs::UInt32>& lines,
+    const size_t nvertices,
+    const size_t veclen )
+{
+    kvs::ValueArray<T> result( nvertices * veclen );
+    T* dst = result.data();
+    for ( const auto l : lines )
+    {
+        const size_t first = connections[ 2 * l + 0 ];
+        const size_t last = connections[ 2 * l + 1 ];
+        dst = std::copy( values.data() + veclen * first, values.data() + veclen * ( last + 1 ), dst );
+    }
+    return result;
+}
+
+} // end of namespace
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if the lines can be divided into the partitions.
+ *  @param  line [in] pointer to the line object
+ *  @return true if the line object has the polylines
+ *
+ *  The colors and the sizes have to be given for each vertex or shared by all
+ *  of the vertices. The other line types are drawn without the subsampling.
+ */
+/*===========================================================================*/
+bool LinePartitionBuffer::IsDivisible( const kvs::LineObject* line )
+{
+    if ( line->lineType() != kvs::LineObject::Polyline ) { return false; }
+    if ( line->numberOfConnections() == 0 ) { return false; }
+
+    const size_t nvertices = line->numberOfVertices();
+    const size_t ncolors = line->colors().size() / 3;
+    const size_t nsizes = line->sizes().size();
+    if ( ncolors > 1 && ncolors != nvertices ) { return false; }
+    if ( nsizes > 1 && nsizes != nvertices ) { return false; }
+
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Divides the polylines into the partitions.
+ *  @param  line [in] pointer to the line object
+ *  @param  npartitions [in] number of partitions
+ *  @return false if the lines cannot be divided
+ *
+ *  The number of partitions is limited to the number of the polylines.
+ *  The buffer object of each partition is created by the engine with its own
+ *  vertex attributes, since they are given to the shader of the engine.
+ */
+/*===========================================================================*/
+bool LinePartitionBuffer::create( const kvs::LineObject* line, const size_t npartitions )
+{
+    this->release();
+    if ( npartitions <= 1 || !IsDivisible( line ) ) { return false; }
+
+    // Every partition has one polyline at least.
+    const size_t nlines = line->numberOfConnections();
+    const size_t n = std::min( npartitions, nlines );
+    if ( n <= 1 ) { return false; }
+
+    std::vector<kvs::UInt32> order( nlines );
+    std::iota( order.begin(), order.end(), 0 );
+    std::shuffle( order.begin(), order.end(), std::mt19937( 12347 ) );
+
+    const auto& connections = line->connections();
+    const size_t nvertices = line->numberOfVertices();
+    const bool vertex_colors = line->colors().size() == 3 * nvertices;
+    const bool vertex_sizes = line->sizes().size() == nvertices;
+    for ( size_t p = 0; p < n; p++ )
+    {
+        // Polylines of the partition in the shuffled order.
+        std::vector<kvs::UInt32> lines;
+        for ( size_t i = p; i < nlines; i += n ) { lines.push_back( order[i] ); }
+
+        size_t nverts = 0;
+        kvs::ValueArray<kvs::UInt32> sub_connections( 2 * lines.size() );
+        for ( size_t i = 0; i < lines.size(); i++ )
+        {
+            const size_t first = connections[ 2 * lines[i] + 0 ];
+            const size_t last = connections[ 2 * lines[i] + 1 ];
+            sub_connections[ 2 * i + 0 ] = static_cast<kvs::UInt32>( nverts );
+            sub_connections[ 2 * i + 1 ] = static_cast<kvs::UInt32>( nverts + last - first );
+            nverts += last - first + 1;
+        }
+
+        auto* sub_line = new kvs::LineObject();
+        sub_line->setLineType( kvs::LineObject::Polyline );
+        sub_line->setColorType( line->colorType() );
+        sub_line->setCoords( ::LineValues( line->coords(), connections, lines, nverts, 3 ) );
+        sub_line->setConnections( sub_connections );
+        sub_line->setColors( vertex_colors ? ::LineValues( line->colors(), connections, lines, nverts, 3 ) : line->colors() );
+        sub_line->setSizes( vertex_sizes ? ::LineValues( line->sizes(), connections, lines, nverts, 1 ) : line->sizes() );
+        m_lines.emplace_back( sub_line );
+        m_buffer_objects.emplace_back( new BufferObject() );
+    }
+
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Releases the line objects and the buffer objects of the partitions.
+ */
+/*===========================================================================*/
+void LinePartitionBuffer::release()
+{
+    m_buffer_objects.clear();
+    m_lines.clear();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Draws the polylines of the partition.
+ *  @param  partition [in] partition
+ */
+/*===========================================================================*/
+void LinePartitionBuffer::draw( const size_t partition )
+{
+    m_buffer_objects[ partition ]->draw( m_lines[ partition ].get() );
+}
+
+} // end of namespace AmbientOcclusionRendering
@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <kvs/LineObject>
+#include <kvs/StylizedLineRenderer>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Buffer objects of the polylines divided into the partitions for the
+ *          stochastic primitive subsampling of the line renderers.
+ *
+ *  The polylines are shuffled and assigned to the partitions evenly, and the
+ *  polylines of each partition are stored in a line object and a buffer object
+ *  of the partition, so that only the vertices of the partition drawn in the
+ *  repetition are processed. The polylines are not divided across partitions.
+ */
+/*===========================================================================*/
+class LinePartitionBuffer
+{
+public:
+    using BufferObject = kvs::StylizedLineRenderer::BufferObject;
+
+private:
+    std::vector<std::unique_ptr<kvs::LineObject>> m_lines{}; ///< polylines of each partition
+    std::vector<std::unique_ptr<BufferObject>> m_buffer_objects{}; ///< buffer object of each partition
+
+public:
+    static bool IsDivisible( const kvs::LineObject* line );
+
+public:
+    LinePartitionBuffer() = default;
+    virtual ~LinePartitionBuffer() { this->release(); }
+
+    size_t numberOfPartitions() const { return m_lines.size(); }
+    const kvs::LineObject* line( const size_t partition ) const { return m_lines[ partition ].get(); }
+    BufferObject& bufferObject( const size_t partition ) { return *m_buffer_objects[ partition ]; }
+    bool isCreated() const { return m_lines.size() > 0; }
+
+    bool create( const kvs::LineObject* line, const size_t npartitions );
+    void release();
+    void draw( const size_t partition );
+};
+
+} // end of namespace AmbientOcclusionRendering
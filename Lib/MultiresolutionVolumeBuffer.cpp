@@ -0,0 +1,219 @@
+#include "MultiresolutionVolumeBuffer.h"
+#include "Parallel.h"
+#include <kvs/OpenGL>
+#include <kvs/Math>
+#include <kvs/Message>
+#include <kvs/ValueArray>
+
+
+namespace
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Downsamples the slices of the volume by a factor of two.
+ *  @param  src [in] values of the previous level
+ *  @param  src_resolution [in] resolution of the previous level
+ *  @param  scale [in] scale from the source value to the normalized value
+ *  @param  offset [in] offset from the source value to the normalized value
+ *  @param  dst [out] normalized values of the next level
+ *  @param  dst_resolution [in] resolution of the next level
+ *  @param  z_begin [in] first slice of the next level
+ *  @param  z_end [in] last slice of the next level (not included)
+ *
+ *  The values are filtered with the tent filter (1/4, 1/2, 1/4) centered at
+ *  the voxel 2i of the previous level.
+ */
+/*===========================================================================*/
+template <typename T>
+inline void DownsampleSlices(
+    const T* src,
+    const kvs::Vec3ui& src_resolution,
+    const float scale,
+    const float offset,
+    kvs::Real32* dst,
+    const kvs::Vec3ui& dst_resolution,
+    const size_t z_begin,
+    const size_t z_end )
+{
+    const float weights[3] = { 0.25f, 0.5f, 0.25f };
+    const int rx = static_cast<int>( src_resolution.x() );
+    const int ry = static_cast<int>( src_resolution.y() );
+    const int rz = static_cast<int>( src_resolution.z() );
+    const size_t line_size = src_resolution.x();
+    const size_t slice_size = size_t( src_resolution.x() ) * src_resolution.y();
+
+    for ( size_t z = z_begin; z < z_end; z++ )
+    {
+        for ( size_t y = 0; y < dst_resolution.y(); y++ )
+        {
+            for ( size_t x = 0; x < dst_resolution.x(); x++ )
+            {
+                float sum = 0.0f;
+                float weight = 0.0f;
+                for ( int k = 0; k < 3; k++ )
+                {
+                    const int sz = 2 * int( z ) + k - 1;
+                    if ( sz < 0 || sz >= rz ) { continue; }
+                    for ( int j = 0; j < 3; j++ )
+                    {
+                        const int sy = 2 * int( y ) + j - 1;
+                        if ( sy < 0 || sy >= ry ) { continue; }
+                        for ( int i = 0; i < 3; i++ )
+                        {
+                            const int sx = 2 * int( x ) + i - 1;
+                            if ( sx < 0 || sx >= rx ) { continue; }
+                            const float w = weights[i] * weights[j] * weights[k];
+                            sum += w * static_cast<float>( src[ sx + line_size * sy + slice_size * sz ] );
+                            weight += w;
+                        }
+                    }
+                }
+
+                const size_t index = x + dst_resolution.x() * ( y + dst_resolution.y() * z );
+                dst[ index ] = ( sum / weight ) * scale + offset;
+            }
+        }
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the volume downsampled by a factor of two.
+ *  @param  src [in] values of the previous level
+ *  @param  src_resolution [in] resolution of the previous level
+ *  @param  scale [in] scale from the source value to the normalized value
+ *  @param  offset [in] offset from the source value to the normalized value
+ *  @param  dst_resolution [in] resolution of the next level
+ *  @return normalized values of the next level
+ *
+ *  The slices of the next level are divided into the hardware threads.
+ */
+/*===========================================================================*/
+template <typename T>
+inline kvs::ValueArray<kvs::Real32> Downsample(
+    const T* src,
+    const kvs::Vec3ui& src_resolution,
+    const float scale,
+    const float offset,
+    const kvs::Vec3ui& dst_resolution )
+{
+    kvs::ValueArray<kvs::Real32> dst( size_t( dst_resolution.x() ) * dst_resolution.y() * dst_resolution.z() );
+
+    const size_t nslices = dst_resolution.z();
+    AmbientOcclusionRendering::ParallelRanges( nslices, [&] ( size_t, size_t begin, size_t end )
+    {
+        DownsampleSlices<T>( src, src_resolution, scale, offset, dst.data(), dst_resolution, begin, end );
+    } );
+
+    return dst;
+}
+
+} // end of namespace
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates the coarse levels of the volume.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @param  nlevels [in] number of the coarse levels
+ *  @return true if the volume is supported
+ */
+/*===========================================================================*/
+bool MultiresolutionVolumeBuffer::create(
+    const kvs::StructuredVolumeObject* volume,
+    const size_t nlevels )
+{
+    if ( volume->veclen() != 1 )
+    {
+        kvsMessageWarning( "The multiresolution volume is not supported for the vector volume." );
+        return false;
+    }
+
+    // The normalized values are mapped to the scalar values by the shader in
+    // the same way as the dense volume texture.
+    const std::type_info& type = volume->values().typeInfo()->type();
+    const float min_value = static_cast<float>( volume->minValue() );
+    const float max_value = static_cast<float>( volume->maxValue() );
+    float scale = 1.0f;
+    float offset = 0.0f;
+    if ( type == typeid( kvs::UInt8 ) ) { scale = 1.0f / 255.0f; }
+    else if ( type == typeid( kvs::UInt16 ) ) { scale = 1.0f / 65535.0f; }
+    else if ( type == typeid( kvs::Int16 ) ) { scale = 1.0f / 65535.0f; offset = 32768.0f / 65535.0f; }
+    else if ( type == typeid( kvs::UInt32 ) ||
+              type == typeid( kvs::Int32 ) ||
+              type == typeid( kvs::Real32 ) ||
+              type == typeid( kvs::Real64 ) )
+    {
+        scale = max_value > min_value ? 1.0f / ( max_value - min_value ) : 1.0f;
+        offset = -min_value * scale;
+    }
+    else
+    {
+        kvsMessageWarning( "The multiresolution volume is not supported for '%s'.",
+                           volume->values().typeInfo()->typeName() );
+        return false;
+    }
+
+    this->release();
+    m_resolutions.push_back( volume->resolution() );
+    m_textures.resize( nlevels );
+
+    kvs::ValueArray<kvs::Real32> values;
+    for ( size_t level = 1; level <= nlevels; level++ )
+    {
+        const kvs::Vec3ui src_resolution = m_resolutions.back();
+        const kvs::Vec3ui dst_resolution(
+            ( src_resolution.x() - 1 ) / 2 + 1,
+            ( src_resolution.y() - 1 ) / 2 + 1,
+            ( src_resolution.z() - 1 ) / 2 + 1 );
+
+        // The level 1 is downsampled from the data values, and the following
+        // levels are downsampled from the normalized values.
+        const void* src = volume->values().data();
+        if ( level > 1 ) { values = ::Downsample( values.data(), src_resolution, 1.0f, 0.0f, dst_resolution ); }
+        else if ( type == typeid( kvs::UInt8 ) ) { values = ::Downsample( static_cast<const kvs::UInt8*>( src ), src_resolution, scale, offset, dst_resolution ); }
+        else if ( type == typeid( kvs::UInt16 ) ) { values = ::Downsample( static_cast<const kvs::UInt16*>( src ), src_resolution, scale, offset, dst_resolution ); }
+        else if ( type == typeid( kvs::Int16 ) ) { values = ::Downsample( static_cast<const kvs::Int16*>( src ), src_resolution, scale, offset, dst_resolution ); }
+        else if ( type == typeid( kvs::UInt32 ) ) { values = ::Downsample( static_cast<const kvs::UInt32*>( src ), src_resolution, scale, offset, dst_resolution ); }
+        else if ( type == typeid( kvs::Int32 ) ) { values = ::Downsample( static_cast<const kvs::Int32*>( src ), src_resolution, scale, offset, dst_resolution ); }
+        else if ( type == typeid( kvs::Real32 ) ) { values = ::Downsample( static_cast<const kvs::Real32*>( src ), src_resolution, scale, offset, dst_resolution ); }
+        else if ( type == typeid( kvs::Real64 ) ) { values = ::Downsample( static_cast<const kvs::Real64*>( src ), src_resolution, scale, offset, dst_resolution ); }
+
+        // Quantize the normalized values to 16 bits.
+        kvs::ValueArray<kvs::UInt16> data( values.size() );
+        for ( size_t i = 0; i < values.size(); i++ )
+        {
+            data[i] = static_cast<kvs::UInt16>( kvs::Math::Clamp( values[i], 0.0f, 1.0f ) * 65535.0f + 0.5f );
+        }
+
+        auto& texture = m_textures[ level - 1 ];
+        texture.setWrapS( GL_CLAMP_TO_EDGE );
+        texture.setWrapT( GL_CLAMP_TO_EDGE );
+        texture.setWrapR( GL_CLAMP_TO_EDGE );
+        texture.setMagFilter( GL_LINEAR );
+        texture.setMinFilter( GL_LINEAR );
+        texture.setPixelFormat( GL_ALPHA16, GL_ALPHA, GL_UNSIGNED_SHORT );
+        texture.create( dst_resolution.x(), dst_resolution.y(), dst_resolution.z(), data.data() );
+        m_resolutions.push_back( dst_resolution );
+    }
+
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Releases the textures of the coarse levels.
+ */
+/*===========================================================================*/
+void MultiresolutionVolumeBuffer::release()
+{
+    for ( auto& texture : m_textures ) { texture.release(); }
+    m_textures.clear();
+    m_resolutions.clear();
+}
+
+} // end of namespace AmbientOcclusionRendering
@@ -0,0 +1,41 @@
+#pragma once
+#include <vector>
+#include <kvs/Type>
+#include <kvs/Vector3>
+#include <kvs/Texture3D>
+#include <kvs/StructuredVolumeObject>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Multiresolution volume buffer for the uniform grid renderer.
+ *
+ *  The coarse levels of the volume are downsampled by a factor of two from
+ *  the previous level on the CPU in parallel, and stored in 3D textures of the
+ *  normalized values. The voxel i of the level l is located at the voxel
+ *  i * 2^l of the full resolution volume (level 0), which is not stored here.
+ */
+/*===========================================================================*/
+class MultiresolutionVolumeBuffer
+{
+private:
+    std::vector<kvs::Vec3ui> m_resolutions{}; ///< resolution of each level (level 0 included)
+    std::vector<kvs::Texture3D> m_textures{}; ///< texture of each coarse level (level 1 and later)
+
+public:
+    MultiresolutionVolumeBuffer() = default;
+    virtual ~MultiresolutionVolumeBuffer() { this->release(); }
+
+    size_t numberOfLevels() const { return m_resolutions.size(); }
+    const kvs::Vec3ui& resolution( const size_t level ) const { return m_resolutions[ level ]; }
+    kvs::Texture3D& texture( const size_t level ) { return m_textures[ level - 1 ]; }
+    bool isCreated() const { return m_textures.size() > 0; }
+
+    bool create( const kvs::StructuredVolumeObject* volume, const size_t nlevels );
+    void release();
+};
+
+} // end of namespace AmbientOcclusionRendering
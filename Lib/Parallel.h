@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <kvs/Math>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the number of the hardware threads.
+ *  @return number of the threads (at least one)
+ */
+/*===========================================================================*/
+inline size_t NumberOfThreads()
+{
+    return kvs::Math::Max( size_t( std::thread::hardware_concurrency() ), size_t( 1 ) );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the size of the index ranges divided by ParallelRanges.
+ *  @param  n [in] number of the indices
+ *  @return size of the ranges (the last range may be smaller)
+ */
+/*===========================================================================*/
+inline size_t ParallelRangeSize( const size_t n )
+{
+    const size_t nthreads = NumberOfThreads();
+    return kvs::Math::Max( ( n + nthreads - 1 ) / nthreads, size_t( 1 ) );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Calls the function for the index ranges divided into the hardware
+ *          threads.
+ *  @param  n [in] number of the indices
+ *  @param  func [in] function called with the thread number and the range
+ *
+ *  The thread number is less than NumberOfThreads(), so that it can be used
+ *  to select the partial result of each thread.
+ */
+/*===========================================================================*/
+template <typename Function>
+inline void ParallelRanges( const size_t n, Function func )
+{
+    if ( n == 0 ) { return; }
+
+    const size_t stride = ParallelRangeSize( n );
+    std::vector<std::thread> threads;
+    for ( size_t begin = 0; begin < n; begin += stride )
+    {
+        const size_t end = kvs::Math::Min( begin + stride, n );
+        threads.emplace_back( func, threads.size(), begin, end );
+    }
+    for ( auto& thread : threads ) { thread.join(); }
+}
+
+} // end of namespace AmbientOcclusionRendering
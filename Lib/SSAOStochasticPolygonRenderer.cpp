@@ -1,4 +1,6 @@
 #include "SSAOStochasticPolygonRenderer.h"
+#include "SpatialOrder.h"
+#include "ValueArrayUtility.h"
 #include <cmath>
 #include <kvs/OpenGL>
 #include <kvs/PolygonObject>
@@ -8,11 +10,17 @@
 #include <kvs/Message>
 #include <kvs/Xorshift128>
 #include <kvs/IgnoreUnusedVariable>
+#include <kvs/VertexBufferObjectManager>
+#include <algorithm>
+#include <numeric>
+#include <random>
 
 
 namespace
 {
 
+using AmbientOcclusionRendering::IsSameArray;
+
 /*===========================================================================*/
 /**
  *  @brief  Returns a random number as integer value.
@@ -46,6 +54,216 @@ inline size_t NumberOfVertices( const kvs::PolygonObject* polygon )
     return polygon->numberOfVertices();
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if the polygon is drawn with the element array.
+ *  @param  polygon [in] pointer to the polygon object
+ *  @return true if the vertices are referred by the connections
+ */
+/*===========================================================================*/
+inline bool HasElementArray( const kvs::PolygonObject* polygon )
+{
+    return polygon->connections().size() > 0 &&
+        polygon->normalType() != kvs::PolygonObject::PolygonNormal &&
+        polygon->colorType() != kvs::PolygonObject::PolygonColor;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the colors of the vertices in the buffer object.
+ *  @param  polygon [in] pointer to the polygon object
+ *  @return RGBA colors of the vertices
+ *
+ *  The colors and the opacities are given for each vertex, for each face or
+ *  shared by all of the vertices, and are expanded to the vertices of the
+ *  buffer object in the same way as the buffer object of the polygon renderer.
+ */
+/*===========================================================================*/
+inline kvs::ValueArray<kvs::UInt8> VertexColors( const kvs::PolygonObject* polygon )
+{
+    const size_t nvertices = ::NumberOfVertices( polygon );
+    const size_t nsources = polygon->numberOfVertices();
+    const bool expanded = polygon->connections().size() > 0 && !::HasElementArray( polygon );
+    const auto& connections = polygon->connections();
+    const auto& colors = polygon->colors();
+    const auto& opacities = polygon->opacities();
+    const size_t ncolors = colors.size() / 3;
+    const size_t nopacities = opacities.size();
+    const kvs::UInt8 white[3] = { 255, 255, 255 };
+    const kvs::UInt8* pcolors = ncolors > 0 ? colors.data() : white;
+
+    kvs::ValueArray<kvs::UInt8> result( nvertices * 4 );
+    for ( size_t i = 0; i < nvertices; i++ )
+    {
+        const size_t face = i / 3;
+        const size_t vertex = expanded ? connections[i] : i;
+        const size_t c = ncolors <= 1 ? 0 : ncolors == nsources ? vertex : face;
+        const size_t a = nopacities == 1 ? 0 : nopacities == nsources ? vertex : face;
+        result[ 4 * i + 0 ] = pcolors[ 3 * c + 0 ];
+        result[ 4 * i + 1 ] = pcolors[ 3 * c + 1 ];
+        result[ 4 * i + 2 ] = pcolors[ 3 * c + 2 ];
+        result[ 4 * i + 3 ] = nopacities > 0 ? opacities[a] : 255;
+    }
+    return result;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the opacity given to the shader as a uniform variable.
+ *  @param  polygon [in] pointer to the polygon object
+ *  @return opacity in [0,1], or negative value for the per-vertex opacities
+ */
+/*===========================================================================*/
+inline float ObjectOpacity( const kvs::PolygonObject* polygon )
+{
+    if ( polygon->opacities().size() != 1 ) { return -1.0f; }
+    return static_cast<float>( polygon->opacity() ) / 255.0f;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns number of triangles of the polygon object.
+ *  @param  polygon [in] pointer to the polygon object
+ *  @return number of triangles
+ */
+/*===========================================================================*/
+inline size_t NumberOfFaces( const kvs::PolygonObject* polygon )
+{
+    const size_t nconnections = polygon->numberOfConnections();
+    return nconnections > 0 ? nconnections : polygon->numberOfVertices() / 3;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the array reordered face by face.
+ *  @param  values [in] values stored for each face
+ *  @param  order [in] new order of the faces
+ *  @param  stride [in] number of values per face
+ *  @return reordered values
+ */
+/*===========================================================================*/
+template <typename T>
+inline kvs::ValueArray<T> Reorder(
+    const kvs::ValueArray<T>& values,
+    const std::vector<kvs::UInt32>& order,
+    const size_t stride )
+{
+    kvs::ValueArray<T> reordered( values.size() );
+    for ( size_t i = 0; i < order.size(); i++ )
+    {
+        const auto* src = values.data() + order[i] * stride;
+        std::copy( src, src + stride, reordered.data() + i * stride );
+    }
+    return reordered;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns a copy of the polygon object whose triangles are shuffled.
+ *  @param  polygon [in] pointer to the polygon object (triangles)
+ *  @return shuffled polygon object
+ *
+ *  Any contiguous range of the shuffled triangles is a random subset of the
+ *  surface, so that each partition can be drawn with a single draw call.
+ */
+/*===========================================================================*/
+inline kvs::PolygonObject* ShuffledPolygon( const kvs::PolygonObject* polygon )
+{
+    const size_t nfaces = ::NumberOfFaces( polygon );
+    std::vector<kvs::UInt32> order( nfaces );
+    std::iota( order.begin(), order.end(), 0 );
+    std::shuffle( order.begin(), order.end(), std::mt19937( 12347 ) );
+
+    auto* shuffled = new kvs::PolygonObject();
+    shuffled->shallowCopy( *polygon );
+
+    const bool per_face_normal = polygon->normalType() == kvs::PolygonObject::PolygonNormal;
+    const bool per_face_color = polygon->colorType() == kvs::PolygonObject::PolygonColor;
+    const auto& normals = polygon->normals();
+    const auto& colors = polygon->colors();
+    const auto& opacities = polygon->opacities();
+    if ( polygon->connections().size() > 0 )
+    {
+        shuffled->setConnections( ::Reorder( polygon->connections(), order, 3 ) );
+        if ( per_face_normal && normals.size() == nfaces * 3 ) { shuffled->setNormals( ::Reorder( normals, order, 3 ) ); }
+        if ( per_face_color && colors.size() == nfaces * 3 ) { shuffled->setColors( ::Reorder( colors, order, 3 ) ); }
+        if ( per_face_color && opacities.size() == nfaces ) { shuffled->setOpacities( ::Reorder( opacities, order, 1 ) ); }
+    }
+    else
+    {
+        shuffled->setCoords( ::Reorder( polygon->coords(), order, 9 ) );
+        if ( normals.size() == nfaces * 9 ) { shuffled->setNormals( ::Reorder( normals, order, 9 ) ); }
+        else if ( normals.size() == nfaces * 3 ) { shuffled->setNormals( ::Reorder( normals, order, 3 ) ); }
+        if ( colors.size() == nfaces * 9 ) { shuffled->setColors( ::Reorder( colors, order, 9 ) ); }
+        else if ( colors.size() == nfaces * 3 ) { shuffled->setColors( ::Reorder( colors, order, 3 ) ); }
+        if ( opacities.size() == nfaces * 3 ) { shuffled->setOpacities( ::Reorder( opacities, order, 3 ) ); }
+        else if ( opacities.size() == nfaces ) { shuffled->setOpacities( ::Reorder( opacities, order, 1 ) ); }
+    }
+
+    return shuffled;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns a copy of the polygon object in the spatial order.
+ *  @param  polygon [in] pointer to the polygon object (triangles)
+ *  @return polygon object whose triangles and vertices are reordered
+ *
+ *  The triangles are sorted along the Morton curve of their centers. The
+ *  vertices of the indexed triangles are renumbered in the order of the
+ *  first reference, and the per-vertex attributes are reordered with them.
+ */
+/*===========================================================================*/
+inline kvs::PolygonObject* OrderedPolygon( const kvs::PolygonObject* polygon )
+{
+    const size_t nfaces = ::NumberOfFaces( polygon );
+    const size_t nvertices = polygon->numberOfVertices();
+    const bool indexed = polygon->connections().size() > 0;
+
+    // The triangle soup is ordered as the triangles of the sequential indices.
+    AmbientOcclusionRendering::SpatialOrder order;
+    if ( indexed ) { order.create( polygon->coords(), polygon->connections(), 3 ); }
+    else
+    {
+        kvs::ValueArray<kvs::UInt32> connections( nvertices );
+        std::iota( connections.begin(), connections.end(), 0 );
+        order.create( polygon->coords(), connections, 3 );
+    }
+
+    auto* ordered = new kvs::PolygonObject();
+    ordered->shallowCopy( *polygon );
+
+    const auto& normals = polygon->normals();
+    const auto& colors = polygon->colors();
+    const auto& opacities = polygon->opacities();
+    if ( indexed )
+    {
+        const bool per_face_normal = polygon->normalType() == kvs::PolygonObject::PolygonNormal;
+        const bool per_face_color = polygon->colorType() == kvs::PolygonObject::PolygonColor;
+        ordered->setCoords( order.reorderVertices( polygon->coords(), 3 ) );
+        ordered->setConnections( order.connections() );
+        if ( per_face_normal && normals.size() == nfaces * 3 ) { ordered->setNormals( order.reorderElements( normals, 3 ) ); }
+        else if ( normals.size() == nvertices * 3 ) { ordered->setNormals( order.reorderVertices( normals, 3 ) ); }
+        if ( per_face_color && colors.size() == nfaces * 3 ) { ordered->setColors( order.reorderElements( colors, 3 ) ); }
+        else if ( colors.size() == nvertices * 3 ) { ordered->setColors( order.reorderVertices( colors, 3 ) ); }
+        if ( per_face_color && opacities.size() == nfaces ) { ordered->setOpacities( order.reorderElements( opacities, 1 ) ); }
+        else if ( opacities.size() == nvertices ) { ordered->setOpacities( order.reorderVertices( opacities, 1 ) ); }
+    }
+    else
+    {
+        const auto& faces = order.elementOrder();
+        ordered->setCoords( ::Reorder( polygon->coords(), faces, 9 ) );
+        if ( normals.size() == nfaces * 9 ) { ordered->setNormals( ::Reorder( normals, faces, 9 ) ); }
+        else if ( normals.size() == nfaces * 3 ) { ordered->setNormals( ::Reorder( normals, faces, 3 ) ); }
+        if ( colors.size() == nfaces * 9 ) { ordered->setColors( ::Reorder( colors, faces, 9 ) ); }
+        else if ( colors.size() == nfaces * 3 ) { ordered->setColors( ::Reorder( colors, faces, 3 ) ); }
+        if ( opacities.size() == nfaces * 3 ) { ordered->setOpacities( ::Reorder( opacities, faces, 3 ) ); }
+        else if ( opacities.size() == nfaces ) { ordered->setOpacities( ::Reorder( opacities, faces, 1 ) ); }
+    }
+
+    return ordered;
+}
+
 } // end of namespace
 
 
@@ -83,6 +301,72 @@ void SSAOStochasticPolygonRenderer::setEdgeFactor( const float factor )
     static_cast<Engine&>( engine() ).setEdgeFactor( factor );
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Sets number of partitions for the stochastic primitive subsampling.
+ *  @param  npartitions [in] number of partitions (1: disabled)
+ *
+ *  The triangles are shuffled and divided into the partitions, and only one
+ *  partition is drawn in each repetition with the opacity multiplied by the
+ *  number of partitions. The ensemble average is unbiased as long as the
+ *  scaled opacity does not exceed 1, and all of the partitions are drawn if
+ *  the repetition level is a multiple of the number of partitions.
+ */
+/*===========================================================================*/
+void SSAOStochasticPolygonRenderer::setNumberOfPartitions( const size_t npartitions )
+{
+    static_cast<Engine&>( engine() ).setNumberOfPartitions( npartitions );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the spatial ordering of the triangles.
+ *  @param  enabled [in] true if the triangles are reordered
+ *
+ *  The triangles are sorted along the Morton curve of their centers, and
+ *  the vertices are renumbered in the order of the first reference. The
+ *  ordering is not applied if the triangles are shuffled for the stochastic
+ *  primitive subsampling.
+ */
+/*===========================================================================*/
+void SSAOStochasticPolygonRenderer::setSpatialOrderingEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setSpatialOrderingEnabled( enabled );
+}
+
+size_t SSAOStochasticPolygonRenderer::numberOfPartitions() const
+{
+    return static_cast<const Engine&>( engine() ).numberOfPartitions();
+}
+
+bool SSAOStochasticPolygonRenderer::isSpatialOrderingEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isSpatialOrderingEnabled();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if all of the polygons are fully opaque.
+ *  @param  object [in] pointer to the polygon object
+ *  @return true if the polygon object is opaque
+ */
+/*===========================================================================*/
+bool SSAOStochasticPolygonRenderer::isOpaque( const kvs::ObjectBase* object ) const
+{
+    const auto* polygon = kvs::PolygonObject::DownCast( object );
+    if ( !polygon ) { return false; }
+    if ( this->numberOfPartitions() > 1 ) { return false; }
+
+    const auto& opacities = polygon->opacities();
+    if ( opacities.size() == 0 ) { return false; }
+    for ( const auto opacity : opacities )
+    {
+        if ( opacity < 255 ) { return false; }
+    }
+
+    return true;
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Constructs a new Engine class.
@@ -149,6 +433,45 @@ void SSAOStochasticPolygonRenderer::Engine::update(
     this->update_buffer_object( kvs::PolygonObject::DownCast( object ) );
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Updates the engine for the replaced polygon object.
+ *  @param  object [in] pointer to the replaced object
+ *  @return true if the engine has been updated without recreating it
+ *
+ *  The engine can be updated only if the geometry (coordinates, normals and
+ *  connections) is unchanged. The opacity given as a single value is passed
+ *  to the shader as a uniform variable, so the replacement with only the
+ *  opacity changed uploads nothing. Otherwise, only the changed range of the
+ *  vertex colors is loaded into the buffer object.
+ */
+/*===========================================================================*/
+bool SSAOStochasticPolygonRenderer::Engine::replaceObject( kvs::ObjectBase* object )
+{
+    auto* polygon = kvs::PolygonObject::DownCast( object );
+    if ( !polygon ) { return false; }
+    if ( polygon->polygonType() != m_polygon_type ||
+         polygon->normalType() != m_normal_type ||
+         polygon->colorType() != m_color_type ) { return false; }
+    if ( !::IsSameArray( m_coords, polygon->coords() ) ||
+         !::IsSameArray( m_normals, polygon->normals() ) ||
+         !::IsSameArray( m_connections, polygon->connections() ) ) { return false; }
+
+    BaseClass::attachObject( object );
+
+    const bool same_colors = ::IsSameArray( m_colors, polygon->colors() );
+    const bool single_opacity = m_opacities.size() == 1 && polygon->opacities().size() == 1;
+    if ( same_colors && ( single_opacity || ::IsSameArray( m_opacities, polygon->opacities() ) ) )
+    {
+        m_opacities = polygon->opacities();
+        m_object_opacity = ::ObjectOpacity( polygon );
+        return true;
+    }
+
+    this->update_colors( polygon );
+    return true;
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Setups shader program.
@@ -162,10 +485,16 @@ void SSAOStochasticPolygonRenderer::Engine::setup(
     kvs::Camera* camera,
     kvs::Light* light )
 {
-    kvs::IgnoreUnusedVariable( object );
     kvs::IgnoreUnusedVariable( camera );
     kvs::IgnoreUnusedVariable( light );
 
+    // Reshuffle or reorder the triangles if the number of partitions or the
+    // spatial ordering has been changed
+    if ( m_partitions_changed || m_spatial_ordering_changed )
+    {
+        this->update_buffer_object( kvs::PolygonObject::DownCast( object ) );
+    }
+
     const auto M = kvs::OpenGL::ModelViewMatrix();
     const auto P = kvs::OpenGL::ProjectionMatrix();
     const auto N = kvs::Mat3( M[0].xyz(), M[1].xyz(), M[2].xyz() );
@@ -176,6 +505,7 @@ void SSAOStochasticPolygonRenderer::Engine::setup(
     geom_pass.setUniform( "ModelViewProjectionMatrix", P * M );
     geom_pass.setUniform( "NormalMatrix", N );
     geom_pass.setUniform( "edge_factor", m_edge_factor );
+    geom_pass.setUniform( "object_opacity", m_object_opacity );
 }
 
 /*===========================================================================*/
@@ -216,12 +546,38 @@ void SSAOStochasticPolygonRenderer::Engine::draw(
 void SSAOStochasticPolygonRenderer::Engine::create_buffer_object(
     const kvs::PolygonObject* polygon )
 {
+    // Keep the attributes for detecting the changed attributes on replacement
+    m_polygon_type = polygon->polygonType();
+    m_normal_type = polygon->normalType();
+    m_color_type = polygon->colorType();
+    m_coords = polygon->coords();
+    m_normals = polygon->normals();
+    m_connections = polygon->connections();
+    m_colors = polygon->colors();
+    m_opacities = polygon->opacities();
+    m_object_opacity = ::ObjectOpacity( polygon );
+
+    // Shuffle the triangles for the stochastic primitive subsampling
+    m_shuffled_polygon.reset( m_npartitions > 1 ? ::ShuffledPolygon( polygon ) : nullptr );
+    m_partitions_changed = false;
+    if ( m_shuffled_polygon ) { polygon = m_shuffled_polygon.get(); }
+
+    // Reorder the triangles along the Morton curve for the locality
+    const bool ordering = m_enable_spatial_ordering && !m_shuffled_polygon;
+    m_ordered_polygon.reset( ordering ? ::OrderedPolygon( polygon ) : nullptr );
+    m_spatial_ordering_changed = false;
+    if ( m_ordered_polygon ) { polygon = m_ordered_polygon.get(); }
+
     // Create buffer object
     const auto nvertices = ::NumberOfVertices( polygon );
-    const auto indices = BaseClass::randomIndices( nvertices );
+    if ( m_random_indices.size() != nvertices * 2 )
+    {
+        m_random_indices = BaseClass::randomIndices( nvertices );
+    }
     auto location = m_render_pass.shaderProgram().attributeLocation( "random_index" );
-    m_buffer_object.manager().setVertexAttribArray( indices, location, 2 );
+    m_buffer_object.manager().setVertexAttribArray( m_random_indices, location, 2 );
     m_buffer_object.create( polygon );
+    m_vertex_colors = ::VertexColors( polygon );
 }
 
 /*===========================================================================*/
@@ -237,6 +593,56 @@ void SSAOStochasticPolygonRenderer::Engine::update_buffer_object(
     this->create_buffer_object( polygon );
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Updates the colors and the opacities of the buffer object.
+ *  @param  polygon [in] pointer to the polygon object with the same geometry
+ *
+ *  The triangles are reordered in the same way as the uploaded triangles, and
+ *  only the range from the first to the last changed vertex color is loaded
+ *  with the sub-data of the vertex buffer object. The colors are stored next
+ *  to the coordinates in the vertex buffer object of the polygon renderer.
+ */
+/*===========================================================================*/
+void SSAOStochasticPolygonRenderer::Engine::update_colors(
+    const kvs::PolygonObject* polygon )
+{
+    const auto* source = polygon;
+    if ( m_shuffled_polygon )
+    {
+        m_shuffled_polygon.reset( ::ShuffledPolygon( polygon ) );
+        polygon = m_shuffled_polygon.get();
+    }
+    if ( m_ordered_polygon )
+    {
+        m_ordered_polygon.reset( ::OrderedPolygon( polygon ) );
+        polygon = m_ordered_polygon.get();
+    }
+
+    const auto colors = ::VertexColors( polygon );
+    if ( colors.size() != m_vertex_colors.size() )
+    {
+        this->update_buffer_object( source );
+        return;
+    }
+
+    m_colors = source->colors();
+    m_opacities = source->opacities();
+    m_object_opacity = ::ObjectOpacity( source );
+
+    // Changed range of the vertex colors
+    size_t first = 0;
+    size_t last = colors.size();
+    while ( first < last && colors[ first ] == m_vertex_colors[ first ] ) { first++; }
+    while ( last > first && colors[ last - 1 ] == m_vertex_colors[ last - 1 ] ) { last--; }
+    m_vertex_colors = colors;
+    if ( first == last ) { return; }
+
+    const size_t offset = ::NumberOfVertices( polygon ) * 3 * sizeof( kvs::Real32 );
+    kvs::VertexBufferObjectManager::Binder bind( m_buffer_object.manager() );
+    KVS_GL_CALL( glBufferSubData( GL_ARRAY_BUFFER, offset + first, last - first, colors.data() + first ) );
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Draws buffer object.
@@ -258,10 +664,38 @@ void SSAOStochasticPolygonRenderer::Engine::draw_buffer_object(
     geom_pass.setUniform( "random_texture", 0 );
     geom_pass.setUniform( "random_offset", random_offset );
     geom_pass.setUniform( "random_texture_size_inv", 1.0f / size );
+    geom_pass.setUniform( "render_mode", static_cast<int>( BaseClass::renderMode() ) );
+
+    // The primitive subsampling is applied only to the stochastic mode
+    const bool subsampling = m_shuffled_polygon && BaseClass::isStochasticMode();
+    const float opacity_scale = subsampling ? static_cast<float>( m_npartitions ) : 1.0f;
+    geom_pass.setUniform( "opacity_scale", opacity_scale );
 
     // Draw buffer object
     kvs::Texture::Binder bind( BaseClass::randomTexture() );
-    m_buffer_object.draw( polygon );
+    if ( !subsampling )
+    {
+        m_buffer_object.draw( polygon );
+        return;
+    }
+
+    // Draw only one partition of the shuffled triangles
+    const size_t nfaces = ::NumberOfFaces( m_shuffled_polygon.get() );
+    const size_t partition = BaseClass::repetitionCount() % m_npartitions;
+    const size_t first = nfaces * partition / m_npartitions;
+    const size_t last = nfaces * ( partition + 1 ) / m_npartitions;
+    const auto nindices = static_cast<GLsizei>( ( last - first ) * 3 );
+
+    auto& manager = m_buffer_object.manager();
+    kvs::VertexBufferObjectManager::Binder bind_manager( manager );
+    if ( ::HasElementArray( m_shuffled_polygon.get() ) )
+    {
+        manager.drawElements( GL_TRIANGLES, nindices, first * 3 * sizeof( kvs::UInt32 ) );
+    }
+    else
+    {
+        manager.drawArrays( GL_TRIANGLES, static_cast<GLint>( first * 3 ), nindices );
+    }
 }
 
 } // end of namespace AmbientOcclusionRendering
@@ -1,4 +1,5 @@
 #pragma once
+#include <memory>
 #include <kvs/Module>
 #include <kvs/PolygonObject>
 #include <kvs/ProgramObject>
@@ -7,6 +8,7 @@
 #include <kvs/Texture2D>
 #include <kvs/StochasticRenderingEngine>
 #include "SSAOStochasticRendererBase.h"
+#include "SSAOStochasticRenderingEngine.h"
 
 
 namespace AmbientOcclusionRendering
@@ -32,6 +34,12 @@ public:
     void setEdgeFactor( const float factor );
     void setDepthOffset( const kvs::Vec2& offset );
     void setDepthOffset( const float factor, const float units = 0.0f );
+    void setNumberOfPartitions( const size_t npartitions );
+    void setSpatialOrderingEnabled( const bool enabled = true );
+    size_t numberOfPartitions() const;
+    bool isSpatialOrderingEnabled() const;
+
+    bool isOpaque( const kvs::ObjectBase* object ) const;
 };
 
 /*===========================================================================*/
@@ -39,9 +47,9 @@ public:
  *  @brief  Engine class for SSAO stochastic polygon renderer.
  */
 /*===========================================================================*/
-class SSAOStochasticPolygonRenderer::Engine : public kvs::StochasticRenderingEngine
+class SSAOStochasticPolygonRenderer::Engine : public SSAOStochasticRenderingEngine
 {
-    using BaseClass = kvs::StochasticRenderingEngine;
+    using BaseClass = SSAOStochasticRenderingEngine;
     using BufferObject = kvs::glsl::PolygonRenderer::BufferObject;
     using RenderPass = kvs::glsl::PolygonRenderer::RenderPass;
 
@@ -49,6 +57,29 @@ private:
     float m_edge_factor = 0.0f; ///< edge enhancement factor
     kvs::Vec2 m_depth_offset{ 0.0f, 0.0f }; ///< depth offset {factor, units}
 
+    // Stochastic primitive subsampling
+    size_t m_npartitions = 1; ///< number of partitions (1: disabled)
+    bool m_partitions_changed = false; ///< flag for changing number of partitions
+    std::unique_ptr<kvs::PolygonObject> m_shuffled_polygon{}; ///< polygon with shuffled faces
+
+    // Spatial ordering (not applied with the primitive subsampling)
+    bool m_enable_spatial_ordering = false; ///< flag for the spatial ordering
+    bool m_spatial_ordering_changed = false; ///< flag for changing the spatial ordering
+    std::unique_ptr<kvs::PolygonObject> m_ordered_polygon{}; ///< polygon with faces and vertices in the Morton order
+
+    // Attributes of the attached object for detecting the changed attributes
+    kvs::PolygonObject::PolygonType m_polygon_type = kvs::PolygonObject::UnknownPolygonType; ///< polygon type
+    kvs::PolygonObject::NormalType m_normal_type = kvs::PolygonObject::UnknownNormalType; ///< normal type
+    kvs::PolygonObject::ColorType m_color_type = kvs::PolygonObject::UnknownColorType; ///< color type
+    kvs::ValueArray<kvs::Real32> m_coords{}; ///< coordinate array
+    kvs::ValueArray<kvs::Real32> m_normals{}; ///< normal vector array
+    kvs::ValueArray<kvs::UInt32> m_connections{}; ///< connection array
+    kvs::ValueArray<kvs::UInt8> m_colors{}; ///< color array
+    kvs::ValueArray<kvs::UInt8> m_opacities{}; ///< opacity array
+    kvs::ValueArray<kvs::UInt16> m_random_indices{}; ///< random index array
+    kvs::ValueArray<kvs::UInt8> m_vertex_colors{}; ///< RGBA colors of the vertices in the buffer object
+    float m_object_opacity = -1.0f; ///< opacity given as a uniform (negative: per-vertex opacity)
+
     BufferObject m_buffer_object{}; ///< geometry buffer object
     RenderPass m_render_pass{ m_buffer_object }; ///< geometry pass
 
@@ -61,6 +92,7 @@ public:
     void update( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
     void setup( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
     void draw( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
+    bool replaceObject( kvs::ObjectBase* object );
 
     void setEdgeFactor( const float factor ) { m_edge_factor = factor; }
     void setDepthOffset( const kvs::Vec2& offset ) { m_depth_offset = offset; }
@@ -68,10 +100,24 @@ public:
     {
         m_depth_offset = kvs::Vec2( factor, units );
     }
+    void setNumberOfPartitions( const size_t npartitions )
+    {
+        const size_t n = kvs::Math::Max( npartitions, size_t( 1 ) );
+        m_partitions_changed = m_partitions_changed || ( n != m_npartitions );
+        m_npartitions = n;
+    }
+    void setSpatialOrderingEnabled( const bool enabled = true )
+    {
+        m_spatial_ordering_changed = m_spatial_ordering_changed || ( enabled != m_enable_spatial_ordering );
+        m_enable_spatial_ordering = enabled;
+    }
+    size_t numberOfPartitions() const { return m_npartitions; }
+    bool isSpatialOrderingEnabled() const { return m_enable_spatial_ordering; }
 
 private:
     void create_buffer_object( const kvs::PolygonObject* polygon );
     void update_buffer_object( const kvs::PolygonObject* polygon );
+    void update_colors( const kvs::PolygonObject* polygon );
     void draw_buffer_object( const kvs::PolygonObject* polygon );
 };
 
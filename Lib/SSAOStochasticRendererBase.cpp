@@ -10,9 +10,21 @@ void SSAOStochasticRendererBase::exec(
     kvs::Camera* camera,
     kvs::Light* light )
 {
+    // Frame time of the previous frame for the frame-time governor
+    const float frame_time = BaseClass::timer().msec();
+
     BaseClass::startTimer();
     kvs::OpenGL::WithPushedAttrib p( GL_ALL_ATTRIB_BITS );
 
+    // Quality settings controlled by the frame-time governor
+    if ( m_enable_governor )
+    {
+        const auto m = kvs::OpenGL::ModelViewMatrix();
+        const auto l = light->position();
+        m_governor.update( BaseClass::repetitionLevel(), m, l, frame_time );
+    }
+    m_ao_buffer.setKernelStride( m_enable_governor ? m_governor.kernelStride() : 1 );
+
     const size_t width = camera->windowWidth();
     const size_t height = camera->windowHeight();
     if ( BaseClass::isWindowCreated() )
@@ -22,6 +34,10 @@ void SSAOStochasticRendererBase::exec(
         BaseClass::setModelView( kvs::OpenGL::ModelViewMatrix() );
         BaseClass::setLightPosition( light->position() );
 
+        const auto scale = this->effective_render_scale();
+        this->ssaoEngine().setRenderScale( scale );
+        m_ao_buffer.setRenderScale( scale );
+
         const auto frame_width = BaseClass::framebufferWidth();
         const auto frame_height = BaseClass::framebufferHeight();
         BaseClass::createEnsembleBuffer( frame_width, frame_height );
@@ -42,31 +58,81 @@ void SSAOStochasticRendererBase::exec(
         const auto frame_height = BaseClass::framebufferHeight();
         BaseClass::createEnsembleBuffer( frame_width, frame_height );
 
-        // Update engine
-        BaseClass::engine().update( object, camera, light );
+        // Resize only the screen-sized render targets of the engine
+        this->ssaoEngine().resize( camera );
 
-        const auto enable_shading = kvs::RendererBase::isShadingEnabled();
         m_ao_buffer.updateFramebuffer( frame_width, frame_height );
-        m_ao_buffer.updateShaderProgram( BaseClass::shader(), enable_shading );
+
+        if ( m_wboit_buffer.isCreated() )
+        {
+            m_wboit_buffer.update( m_ao_buffer.width(), m_ao_buffer.height() );
+        }
     }
 
+    // Resize the internal render targets if the render scale has been changed
+    this->update_render_scale();
+
     if ( BaseClass::isObjectChanged( object ) )
     {
         // Clear ensemble buffer
         BaseClass::ensembleBuffer().clear();
 
-        // Recreate engine
-        BaseClass::engine().release();
-        BaseClass::createEngine( object, camera, light );
+        // Update only the changed attributes if possible, otherwise recreate engine
+        if ( !this->ssaoEngine().replaceObject( object ) )
+        {
+            BaseClass::engine().release();
+            BaseClass::createEngine( object, camera, light );
+        }
     }
 
     BaseClass::setupEngine( object, camera, light );
     m_ao_buffer.setupShaderProgram( BaseClass::shader() );
 
-    // Ensemble rendering.
+    // Discard the ensemble accumulated for the data swapped by the engine.
+    if ( this->ssaoEngine().isEnsembleInvalidated() )
+    {
+        BaseClass::ensembleBuffer().clear();
+        this->ssaoEngine().validateEnsemble();
+    }
+
+    if ( m_enable_wboit )
+    {
+        this->weighted_blended_render_pass( object, camera, light );
+    }
+    else
+    {
+        this->stochastic_render_pass( object, camera, light );
+    }
+
+    // Render to the framebuffer.
+    BaseClass::ensembleBuffer().draw();
+
+    kvs::OpenGL::Finish();
+    BaseClass::stopTimer();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Renders the object with the stochastic ensemble averaging.
+ *  @param  object [in] pointer to the object
+ *  @param  camera [in] pointer to the camera
+ *  @param  light [in] pointer to the light
+ */
+/*===========================================================================*/
+void SSAOStochasticRendererBase::stochastic_render_pass(
+    kvs::ObjectBase* object,
+    kvs::Camera* camera,
+    kvs::Light* light )
+{
     const auto m = kvs::OpenGL::ModelViewMatrix();
     const auto l = light->position();
-    const size_t r = BaseClass::controllledRepetitions( m, l );
+    size_t r = BaseClass::controllledRepetitions( m, l );
+    if ( m_enable_governor ) { r = m_governor.repetitions(); }
+
+    // The engine may draw a coarse level of detail while the scene is moving.
+    const bool interactive = m_enable_governor ? m_governor.isInteractive() : r < BaseClass::repetitionLevel();
+    this->ssaoEngine().setInteractive( interactive );
+
     for ( size_t i = 0; i < r; i++ )
     {
         // Render to the ensemble buffer.
@@ -83,12 +149,90 @@ void SSAOStochasticRendererBase::exec(
         // Progressive averaging.
         BaseClass::ensembleBuffer().add();
     }
+}
 
-    // Render to the framebuffer.
-    BaseClass::ensembleBuffer().draw();
+/*===========================================================================*/
+/**
+ *  @brief  Renders the object with the weighted blended order-independent
+ *          transparency as an approximate preview without any repetitions.
+ *  @param  object [in] pointer to the object
+ *  @param  camera [in] pointer to the camera
+ *  @param  light [in] pointer to the light
+ *
+ *  The ambient occlusion is computed from the nearest visible layer, and the
+ *  layer is shaded with the weighted average color of all of the layers.
+ */
+/*===========================================================================*/
+void SSAOStochasticRendererBase::weighted_blended_render_pass(
+    kvs::ObjectBase* object,
+    kvs::Camera* camera,
+    kvs::Light* light )
+{
+    if ( !m_wboit_buffer.isCreated() )
+    {
+        m_wboit_buffer.create( m_ao_buffer.width(), m_ao_buffer.height() );
+    }
 
-    kvs::OpenGL::Finish();
-    BaseClass::stopTimer();
+    auto& engine = this->ssaoEngine();
+    BaseClass::ensembleBuffer().clear();
+    BaseClass::ensembleBuffer().bind();
+    {
+        // Nearest layer for the ambient occlusion.
+        engine.setRenderMode( SSAOStochasticRenderingEngine::NearestLayer );
+        m_ao_buffer.bind();
+        engine.draw( object, camera, light );
+        m_ao_buffer.unbind();
+
+        // Weighted color and revealage accumulation.
+        engine.setRenderMode( SSAOStochasticRenderingEngine::WeightedBlended );
+        m_wboit_buffer.bind();
+        engine.draw( object, camera, light );
+        m_wboit_buffer.unbind();
+        engine.setRenderMode( SSAOStochasticRenderingEngine::Stochastic );
+
+        // Resolve the color into the G-buffer, and then shade it.
+        m_wboit_buffer.resolve( m_ao_buffer.framebuffer(), m_ao_buffer.positionTexture() );
+        m_ao_buffer.setCoverageAlphaEnabled( true );
+        m_ao_buffer.draw();
+        m_ao_buffer.setCoverageAlphaEnabled( false );
+    }
+    BaseClass::ensembleBuffer().unbind();
+    BaseClass::ensembleBuffer().add();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the render scale applied to the internal render targets.
+ *  @return render scale
+ */
+/*===========================================================================*/
+float SSAOStochasticRendererBase::effective_render_scale() const
+{
+    const float scale = m_enable_governor ? m_governor.renderScale() : 1.0f;
+    return m_render_scale * scale;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Resizes the internal render targets if the render scale has been
+ *          changed. The ensemble buffer is kept in the frame resolution since
+ *          the occlusion pass upscales its output.
+ */
+/*===========================================================================*/
+void SSAOStochasticRendererBase::update_render_scale()
+{
+    const float scale = this->effective_render_scale();
+    if ( scale == m_ao_buffer.renderScale() ) { return; }
+
+    m_ao_buffer.setRenderScale( scale );
+    m_ao_buffer.updateFramebuffer( BaseClass::framebufferWidth(), BaseClass::framebufferHeight() );
+    if ( m_wboit_buffer.isCreated() )
+    {
+        m_wboit_buffer.update( m_ao_buffer.width(), m_ao_buffer.height() );
+    }
+
+    // The engine resizes its own render targets in the setup.
+    this->ssaoEngine().setRenderScale( scale );
 }
 
 } // end of namespace AmbientOcclusionRendering
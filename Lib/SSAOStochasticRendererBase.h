@@ -5,7 +5,11 @@
 #include <kvs/StochasticRendererBase>
 #include <kvs/StochasticRenderingEngine>
 #include <kvs/Deprecated>
+#include <kvs/IgnoreUnusedVariable>
 #include "AmbientOcclusionBuffer.h"
+#include "WeightedBlendedBuffer.h"
+#include "FrameTimeGovernor.h"
+#include "SSAOStochasticRenderingEngine.h"
 #include "SSAOStochasticRenderingCompositor.h"
 
 
@@ -20,25 +24,56 @@ class SSAOStochasticRendererBase : public kvs::StochasticRendererBase
 private:
     using BaseClass = kvs::StochasticRendererBase;
     AmbientOcclusionBuffer m_ao_buffer; /// ambient occlusion buffer
+    WeightedBlendedBuffer m_wboit_buffer; ///< accumulation buffer for weighted blended OIT
+    bool m_enable_wboit = false; ///< flag for weighted blended OIT (preview) mode
+    FrameTimeGovernor m_governor{}; ///< frame-time governor
+    bool m_enable_governor = false; ///< flag for the frame-time governor
+    float m_render_scale = 1.0f; ///< ratio of the internal render targets to the frame size
 
 public:
-    SSAOStochasticRendererBase( kvs::StochasticRenderingEngine* engine ):
+    SSAOStochasticRendererBase( SSAOStochasticRenderingEngine* engine ):
         kvs::StochasticRendererBase( engine ) {}
 
     virtual void exec( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
+    virtual bool isOpaque( const kvs::ObjectBase* object ) const { kvs::IgnoreUnusedVariable( object ); return false; }
     const AmbientOcclusionBuffer& aoBuffer() const { return m_ao_buffer; }
     AmbientOcclusionBuffer& aoBuffer() { return m_ao_buffer; }
 
     void setKernelRadius( const float radius ) { m_ao_buffer.setKernelRadius( radius ); }
     void setKernelSize( const size_t nsamples ) { m_ao_buffer.setKernelSize( nsamples ); }
+    void setKernelBias( const float bias ) { m_ao_buffer.setKernelBias( bias ); }
+    void setIntensity( const float intensity ) { m_ao_buffer.setIntensity( intensity ); }
     void setDrawingOcclusionFactorEnabled( const bool enabled = true ) { m_ao_buffer.setDrawingOcclusionFactorEnabled( enabled ); }
+    void setWeightedBlendedOITEnabled( const bool enabled = true ) { m_enable_wboit = enabled; }
+    void setFrameTimeGovernorEnabled( const bool enabled = true ) { m_enable_governor = enabled; m_governor.reset(); }
+    void setTargetFrameTime( const float msec ) { m_governor.setTargetFrameTime( msec ); }
+    void setRenderScale( const float scale ) { m_render_scale = scale; }
     kvs::Real32 kernelRadius() const { return m_ao_buffer.kernelRadius(); }
     size_t kernelSize() const { return m_ao_buffer.kernelSize(); }
+    float kernelBias() const { return m_ao_buffer.kernelBias(); }
+    float intensity() const { return m_ao_buffer.intensity(); }
+    bool isWeightedBlendedOITEnabled() const { return m_enable_wboit; }
+    float renderScale() const { return m_render_scale; }
+    bool isFrameTimeGovernorEnabled() const { return m_enable_governor; }
+    const FrameTimeGovernor& governor() const { return m_governor; }
+    FrameTimeGovernor& governor() { return m_governor; }
 
     KVS_DEPRECATED( void setSamplingSphereRadius( const float radius ) ) { this->setKernelRadius( radius ); }
     KVS_DEPRECATED( void setNumberOfSamplingPoints( const size_t nsamples ) ) { this->setKernelSize( nsamples ); }
     KVS_DEPRECATED( kvs::Real32 samplingSphereRadius() const ) { return this->kernelRadius(); }
     KVS_DEPRECATED( size_t numberOfSamplingPoints() const ) { return this->kernelSize(); }
+
+protected:
+    SSAOStochasticRenderingEngine& ssaoEngine()
+    {
+        return static_cast<SSAOStochasticRenderingEngine&>( BaseClass::engine() );
+    }
+
+private:
+    void stochastic_render_pass( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
+    void weighted_blended_render_pass( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
+    float effective_render_scale() const;
+    void update_render_scale();
 };
 
 } // end of namespace AmbientOcclusionRendering
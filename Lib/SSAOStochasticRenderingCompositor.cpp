@@ -5,6 +5,14 @@
  */
 /*****************************************************************************/
 #include "SSAOStochasticRenderingCompositor.h"
+#include <kvs/OpenGL>
+#include <kvs/Scene>
+#include <kvs/IDManager>
+#include <kvs/ObjectManager>
+#include <kvs/RendererManager>
+#include <kvs/Camera>
+#include <kvs/Light>
+#include "SSAOStochasticRendererBase.h"
 
 
 namespace
@@ -18,6 +26,28 @@ inline kvs::Vec2ui FrameBufferSize( const kvs::Camera* camera )
     return kvs::Vec2ui( width * dpr, height * dpr );
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Calls the function for each visible object drawn by the SSAO
+ *          stochastic renderer in the scene.
+ *  @param  scene [in] pointer to the scene
+ *  @param  func [in] function called with the object and the renderer
+ */
+/*===========================================================================*/
+template <typename Function>
+inline void ForEachEngine( kvs::Scene* scene, Function func )
+{
+    using Renderer = AmbientOcclusionRendering::SSAOStochasticRendererBase;
+    const int size = scene->IDManager()->size();
+    for ( int i = 0; i < size; i++ )
+    {
+        const auto id = scene->IDManager()->id( i );
+        auto* object = scene->objectManager()->object( id.first );
+        auto* renderer = Renderer::DownCast( scene->rendererManager()->renderer( id.second ) );
+        if ( renderer && object->isVisible() ) { func( object, renderer ); }
+    }
+}
+
 } // end of namespace
 
 
@@ -27,6 +57,7 @@ namespace AmbientOcclusionRendering
 void SSAOStochasticRenderingCompositor::onWindowCreated()
 {
     const auto buf_size = ::FrameBufferSize( BaseClass::scene()->camera() );
+    m_ao_buffer.setRenderScale( this->effective_render_scale() );
     m_ao_buffer.createFramebuffer( buf_size[0], buf_size[1] );
     m_ao_buffer.createShaderProgram( this->shader(), true );
     BaseClass::onWindowCreated();
@@ -35,34 +66,303 @@ void SSAOStochasticRenderingCompositor::onWindowCreated()
 void SSAOStochasticRenderingCompositor::onWindowResized()
 {
     const auto buf_size = ::FrameBufferSize( BaseClass::scene()->camera() );
-    m_ao_buffer.createFramebuffer( buf_size[0], buf_size[1] );
+    m_ao_buffer.updateFramebuffer( buf_size[0], buf_size[1] );
+
+    // Resize only the screen-sized render targets of the engines
+    auto* camera = BaseClass::scene()->camera();
+    ::ForEachEngine( BaseClass::scene(), [&] ( kvs::ObjectBase*, SSAOStochasticRendererBase* renderer )
+    {
+        renderer->ssaoEngine().resize( camera );
+    } );
+
+    m_window_resized = true;
     BaseClass::onWindowResized();
+    m_window_resized = false;
 }
 
 void SSAOStochasticRenderingCompositor::updateEngines()
 {
+    // The engines of the SSAO stochastic renderers have been resized without
+    // re-uploading the objects, and the shaders are independent of the size.
+    if ( m_window_resized && !this->has_other_engines() ) { return; }
+
     m_ao_buffer.updateShaderProgram( this->shader(), true );
     BaseClass::updateEngines();
 }
 
 void SSAOStochasticRenderingCompositor::setupEngines()
 {
+    this->update_governor();
+    this->update_interaction();
+    this->update_render_scale();
     m_ao_buffer.setupShaderProgram( this->shader() );
+    this->replace_objects();
     BaseClass::setupEngines();
+    this->validate_ensembles();
+    this->render_opaque_layer();
 }
 
 void SSAOStochasticRenderingCompositor::ensembleRenderPass( kvs::EnsembleAverageBuffer& buffer )
 {
+    // Skip the remaining repetitions limited by the frame-time governor.
+    if ( m_enable_governor && m_pass_count++ >= m_governor.repetitions() ) { return; }
+
+    // Discard the ensemble accumulated for the objects before the replacement
+    // or for the data before the swap.
+    if ( m_ensemble_invalidated ) { buffer.clear(); m_ensemble_invalidated = false; }
+
     buffer.bind();
     {
         m_ao_buffer.bind();
-        this->drawEngines();
+        if ( m_has_opaque_layer )
+        {
+            // Start from the cached opaque layer and draw the semi-transparent
+            // objects stochastically on top of it.
+            m_ao_buffer.restoreLayer();
+            this->draw_engines( false );
+        }
+        else if ( this->has_other_engines() )
+        {
+            this->drawEngines();
+        }
+        else
+        {
+            // The semi-transparent objects are drawn after the opaque objects,
+            // which are given to the engines reading the geometry depth.
+            this->draw_engines( true );
+            this->draw_engines( false );
+        }
         m_ao_buffer.unbind();
         m_ao_buffer.draw();
     }
     buffer.unbind();
     buffer.add();
 
+    if ( m_enable_governor )
+    {
+        kvs::OpenGL::Finish();
+        m_governor_timer.stop();
+        m_frame_time = m_governor_timer.msec();
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Updates the quality settings with the frame-time governor.
+ */
+/*===========================================================================*/
+void SSAOStochasticRenderingCompositor::update_governor()
+{
+    m_pass_count = 0;
+    if ( !m_enable_governor )
+    {
+        m_ao_buffer.setKernelStride( 1 );
+        return;
+    }
+
+    auto* scene = BaseClass::scene();
+    const auto m = scene->camera()->viewingMatrix() * scene->objectManager()->xform().toMatrix();
+    const auto l = scene->light()->position();
+    m_governor.update( BaseClass::repetitionLevel(), m, l, m_frame_time );
+    m_ao_buffer.setKernelStride( m_governor.kernelStride() );
+
+    m_frame_time = 0.0f;
+    m_governor_timer.start();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Passes the interaction flag to the engines, so that the engines
+ *          can draw a coarse level of detail while the scene is moving.
+ */
+/*===========================================================================*/
+void SSAOStochasticRenderingCompositor::update_interaction()
+{
+    auto* scene = BaseClass::scene();
+    const auto m = scene->camera()->viewingMatrix() * scene->objectManager()->xform().toMatrix();
+    const auto l = scene->light()->position();
+    const bool moving = m != m_modelview || l != m_light_position;
+    m_modelview = m;
+    m_light_position = l;
+
+    const bool interactive = m_enable_governor ? m_governor.isInteractive() : BaseClass::isLODControlEnabled() && moving;
+    ::ForEachEngine( scene, [&] ( kvs::ObjectBase*, SSAOStochasticRendererBase* renderer )
+    {
+        renderer->ssaoEngine().setInteractive( interactive );
+    } );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the render scale applied to the internal render targets.
+ *  @return render scale
+ */
+/*===========================================================================*/
+float SSAOStochasticRenderingCompositor::effective_render_scale() const
+{
+    const float scale = m_enable_governor ? m_governor.renderScale() : 1.0f;
+    return m_render_scale * scale;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Resizes the G-buffer if the render scale has been changed, and
+ *          passes the render scale to the engines.
+ */
+/*===========================================================================*/
+void SSAOStochasticRenderingCompositor::update_render_scale()
+{
+    const float scale = this->effective_render_scale();
+    if ( scale != m_ao_buffer.renderScale() )
+    {
+        const auto buf_size = ::FrameBufferSize( BaseClass::scene()->camera() );
+        m_ao_buffer.setRenderScale( scale );
+        m_ao_buffer.updateFramebuffer( buf_size[0], buf_size[1] );
+    }
+
+    ::ForEachEngine( BaseClass::scene(), [&] ( kvs::ObjectBase*, SSAOStochasticRendererBase* renderer )
+    {
+        renderer->ssaoEngine().setRenderScale( scale );
+    } );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Updates the engines for the replaced objects.
+ *
+ *  The engines whose object has been replaced upload only the changed
+ *  attributes instead of being recreated by the base class, if possible.
+ */
+/*===========================================================================*/
+void SSAOStochasticRenderingCompositor::replace_objects()
+{
+    ::ForEachEngine( BaseClass::scene(), [&] ( kvs::ObjectBase* object, SSAOStochasticRendererBase* renderer )
+    {
+        auto& engine = renderer->ssaoEngine();
+        if ( !engine.object() || engine.object() == object ) { return; }
+        if ( engine.replaceObject( object ) ) { m_ensemble_invalidated = true; }
+    } );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Validates the ensembles invalidated by the engines in the setup.
+ *
+ *  The ensemble buffer is cleared in the next repetition if any of the engines
+ *  has swapped the data drawn by the engine (e.g. the next time step).
+ */
+/*===========================================================================*/
+void SSAOStochasticRenderingCompositor::validate_ensembles()
+{
+    ::ForEachEngine( BaseClass::scene(), [&] ( kvs::ObjectBase*, SSAOStochasticRendererBase* renderer )
+    {
+        auto& engine = renderer->ssaoEngine();
+        if ( !engine.isEnsembleInvalidated() ) { return; }
+        engine.validateEnsemble();
+        m_ensemble_invalidated = true;
+    } );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if the scene includes stochastic renderers other than
+ *          the SSAO stochastic renderers.
+ */
+/*===========================================================================*/
+bool SSAOStochasticRenderingCompositor::has_other_engines()
+{
+    auto* scene = BaseClass::scene();
+    const int size = scene->IDManager()->size();
+    for ( int i = 0; i < size; i++ )
+    {
+        const auto id = scene->IDManager()->id( i );
+        auto* renderer = scene->rendererManager()->renderer( id.second );
+        if ( kvs::StochasticRendererBase::DownCast( renderer ) &&
+             !SSAOStochasticRendererBase::DownCast( renderer ) ) { return true; }
+    }
+    return false;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if the scene includes fully opaque objects.
+ */
+/*===========================================================================*/
+bool SSAOStochasticRenderingCompositor::has_opaque_engines()
+{
+    bool has_opaque = false;
+    ::ForEachEngine( BaseClass::scene(), [&] ( kvs::ObjectBase* object, SSAOStochasticRendererBase* renderer )
+    {
+        if ( renderer->isOpaque( object ) ) { has_opaque = true; }
+    } );
+    return has_opaque;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Renders the fully opaque objects into the cached layer once per frame.
+ *  @note   The layer is not cached if the scene includes the stochastic
+ *          renderers other than the SSAO stochastic renderers.
+ */
+/*===========================================================================*/
+void SSAOStochasticRenderingCompositor::render_opaque_layer()
+{
+    m_has_opaque_layer = false;
+    if ( !m_enable_opaque_caching ) { return; }
+    if ( !this->has_opaque_engines() ) { return; }
+
+    // The other stochastic renderers are drawn only by drawEngines(), which
+    // cannot be split into the opaque and the semi-transparent objects.
+    if ( this->has_other_engines() ) { return; }
+
+    m_ao_buffer.bind();
+    this->draw_engines( true );
+    m_ao_buffer.unbind();
+    m_ao_buffer.storeLayer();
+    m_has_opaque_layer = true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Draws the opaque or the semi-transparent objects.
+ *  @param  opaque [in] if true, only the fully opaque objects are drawn
+ */
+/*===========================================================================*/
+void SSAOStochasticRenderingCompositor::draw_engines( const bool opaque )
+{
+    auto* scene = BaseClass::scene();
+    auto* camera = scene->camera();
+    auto* light = scene->light();
+    auto draw = [&] ( kvs::ObjectBase* object, SSAOStochasticRendererBase* renderer )
+    {
+        kvs::OpenGL::PushMatrix();
+        scene->updateGLModelingMatrix( object );
+        renderer->engine().draw( object, camera, light );
+        renderer->engine().countRepetitions();
+        kvs::OpenGL::PopMatrix();
+    };
+
+    // The engines reading the geometry depth are drawn after the other
+    // engines, so that the depth of the geometry drawn in this repetition
+    // is copied from the G-buffer and given to them.
+    bool has_depth_engines = false;
+    ::ForEachEngine( scene, [&] ( kvs::ObjectBase* object, SSAOStochasticRendererBase* renderer )
+    {
+        if ( renderer->isOpaque( object ) != opaque ) { return; }
+        if ( renderer->ssaoEngine().isGeometryDepthRequired() ) { has_depth_engines = true; return; }
+        draw( object, renderer );
+    } );
+    if ( !has_depth_engines ) { return; }
+
+    m_ao_buffer.copyDepth();
+    ::ForEachEngine( scene, [&] ( kvs::ObjectBase* object, SSAOStochasticRendererBase* renderer )
+    {
+        if ( renderer->isOpaque( object ) != opaque ) { return; }
+        if ( !renderer->ssaoEngine().isGeometryDepthRequired() ) { return; }
+        renderer->ssaoEngine().setGeometryDepthTexture( &m_ao_buffer.depthCopyTexture() );
+        draw( object, renderer );
+        renderer->ssaoEngine().setGeometryDepthTexture( nullptr );
+    } );
 }
 
 } // end of namespace local
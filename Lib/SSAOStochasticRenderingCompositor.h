@@ -7,7 +7,9 @@
 #pragma once
 #include <kvs/Shader>
 #include <kvs/StochasticRenderingCompositor>
+#include <kvs/Timer>
 #include "AmbientOcclusionBuffer.h"
+#include "FrameTimeGovernor.h"
 
 
 namespace AmbientOcclusionRendering
@@ -22,6 +24,18 @@ class SSAOStochasticRenderingCompositor : public kvs::StochasticRenderingComposi
 private:
     kvs::Shader::ShadingModel* m_shader = new kvs::Shader::Lambert(); ///< shader
     AmbientOcclusionBuffer m_ao_buffer{}; ///< ambient occlusion buffer
+    bool m_enable_opaque_caching = true; ///< flag for caching opaque objects
+    bool m_has_opaque_layer = false; ///< true if the opaque layer is cached for this frame
+    FrameTimeGovernor m_governor{}; ///< frame-time governor
+    bool m_enable_governor = false; ///< flag for the frame-time governor
+    kvs::Timer m_governor_timer{}; ///< timer for measuring the ensemble render passes
+    float m_frame_time = 0.0f; ///< measured time of the ensemble render passes in msec
+    size_t m_pass_count = 0; ///< number of the ensemble render passes in this frame
+    float m_render_scale = 1.0f; ///< ratio of the internal render targets to the frame size
+    bool m_window_resized = false; ///< true while handling the window resize event
+    bool m_ensemble_invalidated = false; ///< true if the engines have been updated for the replaced objects or the swapped data
+    kvs::Mat4 m_modelview{}; ///< modelview matrix of the previous frame
+    kvs::Vec3 m_light_position{}; ///< light position of the previous frame
 
 public:
     SSAOStochasticRenderingCompositor( kvs::Scene* scene ): BaseClass( scene ) {}
@@ -40,9 +54,22 @@ public:
 
     void setKernelRadius( const float radius ) { m_ao_buffer.setKernelRadius( radius ); }
     void setKernelSize( const size_t nsamples ) { m_ao_buffer.setKernelSize( nsamples ); }
+    void setKernelBias( const float bias ) { m_ao_buffer.setKernelBias( bias ); }
+    void setIntensity( const float intensity ) { m_ao_buffer.setIntensity( intensity ); }
     void setDrawingOcclusionFactorEnabled( const bool enabled = true ) { m_ao_buffer.setDrawingOcclusionFactorEnabled( enabled ); }
+    void setOpaqueCachingEnabled( const bool enabled = true ) { m_enable_opaque_caching = enabled; }
+    void setFrameTimeGovernorEnabled( const bool enabled = true ) { m_enable_governor = enabled; m_governor.reset(); }
+    void setTargetFrameTime( const float msec ) { m_governor.setTargetFrameTime( msec ); }
+    void setRenderScale( const float scale ) { m_render_scale = scale; }
     kvs::Real32 kernelRadius() const { return m_ao_buffer.kernelRadius(); }
     size_t kernelSize() const { return m_ao_buffer.kernelSize(); }
+    float kernelBias() const { return m_ao_buffer.kernelBias(); }
+    float intensity() const { return m_ao_buffer.intensity(); }
+    bool isOpaqueCachingEnabled() const { return m_enable_opaque_caching; }
+    float renderScale() const { return m_render_scale; }
+    bool isFrameTimeGovernorEnabled() const { return m_enable_governor; }
+    const FrameTimeGovernor& governor() const { return m_governor; }
+    FrameTimeGovernor& governor() { return m_governor; }
 
     KVS_DEPRECATED( void setSamplingSphereRadius( const float radius ) ) { this->setKernelRadius( radius ); }
     KVS_DEPRECATED( void setNumberOfSamplingPoints( const size_t nsamples ) ) { this->setKernelSize( nsamples ); }
@@ -55,6 +82,18 @@ protected:
     virtual void updateEngines();
     virtual void setupEngines();
     virtual void ensembleRenderPass( kvs::EnsembleAverageBuffer& buffer );
+
+private:
+    void update_governor();
+    void update_interaction();
+    float effective_render_scale() const;
+    void update_render_scale();
+    void replace_objects();
+    void validate_ensembles();
+    bool has_other_engines();
+    bool has_opaque_engines();
+    void render_opaque_layer();
+    void draw_engines( const bool opaque );
 };
 
 } // end of namespace AmbientOcclusionRendering
@@ -0,0 +1,85 @@
+#pragma once
+#include <kvs/StochasticRenderingEngine>
+#include <kvs/Camera>
+#include <kvs/ObjectBase>
+#include <kvs/Texture2D>
+#include <kvs/IgnoreUnusedVariable>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Base class of the engines for the SSAO stochastic renderers.
+ */
+/*===========================================================================*/
+class SSAOStochasticRenderingEngine : public kvs::StochasticRenderingEngine
+{
+public:
+    /*  Render mode of the geometry pass. The value is passed to the geometry
+     *  pass shaders as the uniform variable 'render_mode'.
+     */
+    enum RenderMode
+    {
+        Stochastic = 0, ///< stochastic color assignment (default)
+        NearestLayer = 1, ///< nearest visible layer without stochastic test
+        WeightedBlended = 2 ///< weighted color and revealage accumulation
+    };
+
+private:
+    RenderMode m_render_mode = Stochastic; ///< render mode of the geometry pass
+    float m_render_scale = 1.0f; ///< ratio of the internal render targets to the frame size
+    bool m_interactive = false; ///< flag for the interaction (camera, object or light moving)
+    bool m_ensemble_invalidated = false; ///< true if the data drawn by the engine has been swapped
+    const kvs::Texture2D* m_geometry_depth_texture = nullptr; ///< depth of the geometry drawn before the engine (not owned)
+
+public:
+    SSAOStochasticRenderingEngine() = default;
+    virtual ~SSAOStochasticRenderingEngine() {}
+
+    void setRenderMode( const RenderMode mode ) { m_render_mode = mode; }
+    void setRenderScale( const float scale ) { m_render_scale = scale; }
+    RenderMode renderMode() const { return m_render_mode; }
+    float renderScale() const { return m_render_scale; }
+    bool isStochasticMode() const { return m_render_mode == Stochastic; }
+
+    /*  The interaction flag is set by the renderer (or the compositor) before
+     *  the engine is drawn, so that the engine can select a coarse level of
+     *  detail while the scene is moving.
+     */
+    void setInteractive( const bool interactive ) { m_interactive = interactive; }
+    bool isInteractive() const { return m_interactive; }
+
+    /*  The ensemble is invalidated by the engine when the data drawn by the
+     *  engine is swapped in the setup (e.g. the next time step is uploaded),
+     *  so that the repetitions accumulated for the previous data are discarded
+     *  by the renderer (or the compositor), which validates it again after
+     *  clearing the ensemble buffer.
+     */
+    void invalidateEnsemble() { m_ensemble_invalidated = true; }
+    void validateEnsemble() { m_ensemble_invalidated = false; }
+    virtual bool isEnsembleInvalidated() const { return m_ensemble_invalidated; }
+
+    /*  The depth texture of the geometry already drawn in the current
+     *  repetition is set by the compositor before the engine is drawn, if the
+     *  engine requires it. The texture is null if the depth is not available.
+     */
+    void setGeometryDepthTexture( const kvs::Texture2D* texture ) { m_geometry_depth_texture = texture; }
+    const kvs::Texture2D* geometryDepthTexture() const { return m_geometry_depth_texture; }
+    virtual bool isGeometryDepthRequired() const { return false; }
+
+    /*  Resizes the screen-sized render targets of the engine. This method is
+     *  called instead of update() when the window is resized, so that the
+     *  object data uploaded to the GPU is kept as it is.
+     */
+    virtual void resize( kvs::Camera* camera ) { kvs::IgnoreUnusedVariable( camera ); }
+
+    /*  Updates the engine for the replaced object by uploading only the changed
+     *  attributes. If false is returned, the engine is released and recreated
+     *  for the replaced object.
+     */
+    virtual bool replaceObject( kvs::ObjectBase* object ) { kvs::IgnoreUnusedVariable( object ); return false; }
+};
+
+} // end of namespace AmbientOcclusionRendering
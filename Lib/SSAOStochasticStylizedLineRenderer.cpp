@@ -85,6 +85,35 @@ void SSAOStochasticStylizedLineRenderer::setHaloSize( const kvs::Real32 size )
     static_cast<Engine&>( engine() ).setHaloSize( size );
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Sets number of partitions for the stochastic primitive subsampling.
+ *  @param  npartitions [in] number of partitions (1: disabled)
+ *
+ *  The polylines are shuffled and divided into the partitions, and only one
+ *  partition is drawn in each repetition with the opacity multiplied by the
+ *  number of partitions. The scaled opacity is clamped by min( 1, alpha * K )
+ *  for K partitions, so that the lines whose opacity exceeds 1/K are drawn
+ *  more transparent than the given opacity. The subsampling is applied only
+ *  to the polylines, and the other line types are drawn as they are.
+ */
+/*===========================================================================*/
+void SSAOStochasticStylizedLineRenderer::setNumberOfPartitions( const size_t npartitions )
+{
+    static_cast<Engine&>( engine() ).setNumberOfPartitions( npartitions );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns number of partitions for the stochastic primitive subsampling.
+ *  @return number of partitions
+ */
+/*===========================================================================*/
+size_t SSAOStochasticStylizedLineRenderer::numberOfPartitions() const
+{
+    return static_cast<const Engine&>( engine() ).numberOfPartitions();
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Returns line opacity.
@@ -118,6 +147,21 @@ kvs::Real32 SSAOStochasticStylizedLineRenderer::haloSize() const
     return static_cast<const Engine&>( engine() ).haloSize();
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if the lines are drawn as fully opaque.
+ *  @param  object [in] pointer to the line object
+ *  @return true if the line opacity is 255 and the lines are not subsampled
+ */
+/*===========================================================================*/
+bool SSAOStochasticStylizedLineRenderer::isOpaque( const kvs::ObjectBase* object ) const
+{
+    // Only a partition is drawn in each repetition for the polylines.
+    const auto* line = kvs::LineObject::DownCast( object );
+    const bool subsampling = this->numberOfPartitions() > 1 && line && LinePartitionBuffer::IsDivisible( line );
+    return this->opacity() == 255 && !subsampling;
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Creates a new Engine class.
@@ -138,6 +182,7 @@ SSAOStochasticStylizedLineRenderer::Engine::Engine()
 void SSAOStochasticStylizedLineRenderer::Engine::release()
 {
     m_buffer_object.release();
+    m_partition_buffer.release();
     m_render_pass.release();
 }
 
@@ -194,10 +239,12 @@ void SSAOStochasticStylizedLineRenderer::Engine::setup(
     kvs::Camera* camera,
     kvs::Light* light )
 {
-    kvs::IgnoreUnusedVariable( object );
     kvs::IgnoreUnusedVariable( camera );
     kvs::IgnoreUnusedVariable( light );
 
+    // Reassign the partitions if the number of partitions has been changed
+    if ( m_partitions_changed ) { this->update_buffer_object( kvs::LineObject::DownCast( object ) ); }
+
     // Setup shader program
     auto& geom_pass = m_render_pass.shaderProgram();
     kvs::ProgramObject::Binder bind( geom_pass );
@@ -240,6 +287,33 @@ void SSAOStochasticStylizedLineRenderer::Engine::draw(
 /*===========================================================================*/
 void SSAOStochasticStylizedLineRenderer::Engine::create_buffer_object(
     const kvs::LineObject* line )
+{
+    // The polylines are stored in the buffer object of each partition if they
+    // are divided for the primitive subsampling.
+    if ( m_partition_buffer.create( line, m_npartitions ) )
+    {
+        for ( size_t i = 0; i < m_partition_buffer.numberOfPartitions(); i++ )
+        {
+            this->create_line_buffer( m_partition_buffer.line( i ), m_partition_buffer.bufferObject( i ) );
+        }
+    }
+    else
+    {
+        this->create_line_buffer( line, m_buffer_object );
+    }
+    m_partitions_changed = false;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates buffer object of the lines.
+ *  @param  line [in] pointer to the line object
+ *  @param  buffer_object [in] buffer object
+ */
+/*===========================================================================*/
+void SSAOStochasticStylizedLineRenderer::Engine::create_line_buffer(
+    const kvs::LineObject* line,
+    BufferObject& buffer_object )
 {
     auto& geom_pass = m_render_pass.shaderProgram();
 
@@ -247,12 +321,12 @@ void SSAOStochasticStylizedLineRenderer::Engine::create_buffer_object(
     const auto nvertices = line->numberOfVertices() * 2;
     const auto indices = BaseClass::randomIndices( nvertices );
     const auto indices_location = geom_pass.attributeLocation( "random_index" );
-    m_buffer_object.manager().setVertexAttribArray( indices, indices_location, 2 );
+    buffer_object.manager().setVertexAttribArray( indices, indices_location, 2 );
 
     // Create buffer object
     const auto halo_size = m_render_pass.haloSize();
     const auto radius_size = m_render_pass.radiusSize();
-    m_buffer_object.create( line, halo_size, radius_size );
+    buffer_object.create( line, halo_size, radius_size );
 }
 
 /*===========================================================================*/
@@ -265,6 +339,7 @@ void SSAOStochasticStylizedLineRenderer::Engine::update_buffer_object(
     const kvs::LineObject* line )
 {
     m_buffer_object.release();
+    m_partition_buffer.release();
     this->create_buffer_object( line );
 }
 
@@ -292,9 +367,30 @@ void SSAOStochasticStylizedLineRenderer::Engine::draw_buffer_object(
     geom_pass.setUniform( "random_offset", random_offset );
     geom_pass.setUniform( "random_texture_size_inv", 1.0f / size );
 
+    geom_pass.setUniform( "render_mode", static_cast<int>( BaseClass::renderMode() ) );
+
+    // Only one partition is drawn in each repetition. The primitive subsampling
+    // is applied only to the stochastic mode, and all of the partitions are
+    // drawn in the other modes.
+    const size_t npartitions = m_partition_buffer.numberOfPartitions();
+    const bool subsampling = npartitions > 1 && BaseClass::isStochasticMode();
+    const float opacity_scale = subsampling ? static_cast<float>( npartitions ) : 1.0f;
+    geom_pass.setUniform( "opacity_scale", opacity_scale );
+
     // Draw buffer object
     kvs::Texture::Binder unit( BaseClass::randomTexture(), 2 );
-    m_buffer_object.draw( line );
+    if ( subsampling )
+    {
+        m_partition_buffer.draw( BaseClass::repetitionCount() % npartitions );
+    }
+    else if ( m_partition_buffer.isCreated() )
+    {
+        for ( size_t i = 0; i < npartitions; i++ ) { m_partition_buffer.draw( i ); }
+    }
+    else
+    {
+        m_buffer_object.draw( line );
+    }
 }
 
 } // end of namespace AmbientOcclusionRendering
@@ -11,6 +11,8 @@
 #include <kvs/StochasticRendererBase>
 #include <kvs/StylizedLineRenderer>
 #include "SSAOStochasticRendererBase.h"
+#include "SSAOStochasticRenderingEngine.h"
+#include "LinePartitionBuffer.h"
 
 
 namespace AmbientOcclusionRendering
@@ -40,6 +42,10 @@ public:
     /*KVS_DEPRECATED*/ kvs::UInt8 opacity() const;
     kvs::Real32 radiusSize() const;
     kvs::Real32 haloSize() const;
+    void setNumberOfPartitions( const size_t npartitions );
+    size_t numberOfPartitions() const;
+
+    bool isOpaque( const kvs::ObjectBase* object ) const;
 };
 
 /*===========================================================================*/
@@ -47,18 +53,21 @@ public:
  *  @brief  Engine class for SSAO stochastic stylized line renderer.
  */
 /*===========================================================================*/
-class SSAOStochasticStylizedLineRenderer::Engine : public kvs::StochasticRenderingEngine
+class SSAOStochasticStylizedLineRenderer::Engine : public SSAOStochasticRenderingEngine
 {
-    using BaseClass = kvs::StochasticRenderingEngine;
+    using BaseClass = SSAOStochasticRenderingEngine;
     using BufferObject = kvs::StylizedLineRenderer::BufferObject;
     using RenderPass = kvs::StylizedLineRenderer::RenderPass;
 
 private:
     float m_edge_factor = 0.0f; ///< edge enhancement factor
+    size_t m_npartitions = 1; ///< number of partitions for primitive subsampling (1: disabled)
+    bool m_partitions_changed = false; ///< flag for changing number of partitions
     kvs::UInt8 m_line_opacity = 255; ///< line opacity
 
     BufferObject m_buffer_object{}; ///< geometry buffer object
     RenderPass m_render_pass{ m_buffer_object }; ///< geometry pass
+    LinePartitionBuffer m_partition_buffer{}; ///< buffer objects of the partitions for primitive subsampling
 
 public:
     Engine();
@@ -77,9 +86,17 @@ public:
     kvs::UInt8 opacity() const { return m_line_opacity; }
     kvs::Real32 radiusSize() const { return m_render_pass.radiusSize(); }
     kvs::Real32 haloSize() const { return m_render_pass.haloSize(); }
+    void setNumberOfPartitions( const size_t npartitions )
+    {
+        const size_t n = kvs::Math::Max( npartitions, size_t( 1 ) );
+        m_partitions_changed = m_partitions_changed || ( n != m_npartitions );
+        m_npartitions = n;
+    }
+    size_t numberOfPartitions() const { return m_npartitions; }
 
 private:
     void create_buffer_object( const kvs::LineObject* line );
+    void create_line_buffer( const kvs::LineObject* line, BufferObject& buffer_object );
     void update_buffer_object( const kvs::LineObject* line );
     void draw_buffer_object( const kvs::LineObject* line );
 };
@@ -13,22 +13,36 @@
 /*****************************************************************************/
 #include "SSAOStochasticTetrahedraRenderer.h"
 #include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <vector>
 #include <kvs/OpenGL>
+#include <kvs/ShaderSource>
+#include <kvs/VertexShader>
+#include <kvs/GeometryShader>
 #include <kvs/UnstructuredVolumeObject>
+#include <kvs/UnstructuredVolumeImporter>
 #include <kvs/Camera>
 #include <kvs/Light>
 #include <kvs/Assert>
 #include <kvs/Message>
 #include <kvs/Type>
+#include <kvs/Math>
 #include <kvs/Xorshift128>
 #include <kvs/TetrahedralCell>
 #include <kvs/ProjectedTetrahedraTable>
 #include <kvs/PreIntegrationTable2D>
+#include "Parallel.h"
+#include "ValueArrayUtility.h"
 
 
 namespace
 {
 
+using AmbientOcclusionRendering::NumberOfThreads;
+using AmbientOcclusionRendering::ParallelRanges;
+using AmbientOcclusionRendering::IsSameArray;
+
 /*===========================================================================*/
 /**
  *  @brief  Returns a random number as integer value.
@@ -42,6 +56,451 @@ inline int RandomNumber()
     return C * R.randInteger();
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if the two tables have the same values.
+ *  @param  a [in] table
+ *  @param  b [in] table
+ *  @return true if the tables are the same
+ */
+/*===========================================================================*/
+inline bool IsSameTable( const kvs::ValueArray<kvs::Real32>& a, const kvs::ValueArray<kvs::Real32>& b )
+{
+    return a.size() == b.size() && std::equal( a.begin(), a.end(), b.begin() );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the min/max values of the array.
+ *  @param  data [in] pointer to the values
+ *  @param  n [in] number of the values
+ *  @return min/max values
+ */
+/*===========================================================================*/
+template <typename T>
+inline kvs::Vec2 ValueRange( const T* data, const size_t n )
+{
+    if ( n == 0 ) { return kvs::Vec2( 0.0f, 0.0f ); }
+
+    const float init = static_cast<float>( data[0] );
+    std::vector<kvs::Vec2> partials( NumberOfThreads(), kvs::Vec2( init, init ) );
+    ParallelRanges( n, [&] ( size_t thread, size_t begin, size_t end )
+    {
+        auto& range = partials[ thread ];
+        for ( size_t i = begin; i < end; i++ )
+        {
+            const float value = static_cast<float>( data[i] );
+            range[0] = kvs::Math::Min( range[0], value );
+            range[1] = kvs::Math::Max( range[1], value );
+        }
+    } );
+
+    kvs::Vec2 range = partials[0];
+    for ( const auto& partial : partials )
+    {
+        range[0] = kvs::Math::Min( range[0], partial[0] );
+        range[1] = kvs::Math::Max( range[1], partial[1] );
+    }
+    return range;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the min/max values of the volume.
+ *  @param  volume [in] pointer to the volume object
+ *  @return min/max values
+ *
+ *  The min/max values are computed from the values if they have not been
+ *  given to the volume, which is not modified.
+ */
+/*===========================================================================*/
+inline kvs::Vec2 ValueRange( const kvs::UnstructuredVolumeObject* volume )
+{
+    if ( volume->hasMinMaxValues() )
+    {
+        return kvs::Vec2( static_cast<float>( volume->minValue() ), static_cast<float>( volume->maxValue() ) );
+    }
+
+    const void* data = volume->values().data();
+    const size_t n = volume->values().size();
+    const std::type_info& type = volume->values().typeInfo()->type();
+    if ( type == typeid( kvs::Int8 ) ) { return ::ValueRange( static_cast<const kvs::Int8*>( data ), n ); }
+    else if ( type == typeid( kvs::UInt8 ) ) { return ::ValueRange( static_cast<const kvs::UInt8*>( data ), n ); }
+    else if ( type == typeid( kvs::Int16 ) ) { return ::ValueRange( static_cast<const kvs::Int16*>( data ), n ); }
+    else if ( type == typeid( kvs::UInt16 ) ) { return ::ValueRange( static_cast<const kvs::UInt16*>( data ), n ); }
+    else if ( type == typeid( kvs::Int32 ) ) { return ::ValueRange( static_cast<const kvs::Int32*>( data ), n ); }
+    else if ( type == typeid( kvs::UInt32 ) ) { return ::ValueRange( static_cast<const kvs::UInt32*>( data ), n ); }
+    else if ( type == typeid( kvs::Real32 ) ) { return ::ValueRange( static_cast<const kvs::Real32*>( data ), n ); }
+    else if ( type == typeid( kvs::Real64 ) ) { return ::ValueRange( static_cast<const kvs::Real64*>( data ), n ); }
+    return kvs::Vec2( 0.0f, 0.0f );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Computes the normalized values and the normal vectors at the nodes.
+ *  @param  volume [in] pointer to the tetrahedral volume object
+ *  @param  values [out] values normalized by the min/max values of the volume
+ *  @param  normals [out] normal vectors (three components for each node)
+ *
+ *  The normal vector at a node is the average of the negative gradients of
+ *  the cells sharing the node, which are constant in each linear tetrahedron.
+ *  The gradients of the cells are computed by the hardware threads, and they
+ *  are gathered for each node through the cells sharing the node, so that
+ *  the threads do not write to the same node and the sum is deterministic.
+ */
+/*===========================================================================*/
+template <typename T>
+inline void VertexAttributes(
+    const kvs::UnstructuredVolumeObject* volume,
+    kvs::ValueArray<kvs::Real32>& values,
+    kvs::ValueArray<kvs::Real32>& normals )
+{
+    const T* data = static_cast<const T*>( volume->values().data() );
+    const size_t nnodes = volume->numberOfNodes();
+    const size_t ncells = volume->numberOfCells();
+    const kvs::Real32* coords = volume->coords().data();
+    const kvs::UInt32* connections = volume->connections().data();
+
+    const kvs::Vec2 range = ::ValueRange( volume );
+    const float min_value = range[0];
+    const float max_value = range[1];
+    const float scale = max_value > min_value ? 1.0f / ( max_value - min_value ) : 1.0f;
+    values.allocate( nnodes );
+    ParallelRanges( nnodes, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            values[i] = ( static_cast<float>( data[i] ) - min_value ) * scale;
+        }
+    } );
+
+    // Negative gradient of each cell (zero for the degenerate cells).
+    std::vector<kvs::Vec3> gradients( ncells );
+    ParallelRanges( ncells, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            const kvs::UInt32* id = connections + 4 * i;
+            const kvs::Vec3 p0( coords + 3 * id[0] );
+            const kvs::Vec3 e1 = kvs::Vec3( coords + 3 * id[1] ) - p0;
+            const kvs::Vec3 e2 = kvs::Vec3( coords + 3 * id[2] ) - p0;
+            const kvs::Vec3 e3 = kvs::Vec3( coords + 3 * id[3] ) - p0;
+            const float det = e1.dot( e2.cross( e3 ) );
+            if ( det == 0.0f ) { gradients[i] = kvs::Vec3( 0.0f, 0.0f, 0.0f ); continue; }
+
+            const float v0 = values[ id[0] ];
+            gradients[i] = -(
+                ( values[ id[1] ] - v0 ) * e2.cross( e3 ) +
+                ( values[ id[2] ] - v0 ) * e3.cross( e1 ) +
+                ( values[ id[3] ] - v0 ) * e1.cross( e2 ) ) / det;
+        }
+    } );
+
+    // Cells sharing each node in the cell order.
+    std::vector<size_t> offsets( nnodes + 1, 0 );
+    for ( size_t i = 0; i < 4 * ncells; i++ ) { offsets[ connections[i] + 1 ]++; }
+    for ( size_t i = 0; i < nnodes; i++ ) { offsets[ i + 1 ] += offsets[i]; }
+    std::vector<kvs::UInt32> node_cells( offsets[ nnodes ] );
+    {
+        std::vector<size_t> counts( offsets.begin(), offsets.end() - 1 );
+        for ( size_t i = 0; i < 4 * ncells; i++ )
+        {
+            node_cells[ counts[ connections[i] ]++ ] = static_cast<kvs::UInt32>( i / 4 );
+        }
+    }
+
+    normals.allocate( nnodes * 3 );
+    ParallelRanges( nnodes, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            kvs::Vec3 n( 0.0f, 0.0f, 0.0f );
+            for ( size_t j = offsets[i]; j < offsets[ i + 1 ]; j++ ) { n += gradients[ node_cells[j] ]; }
+
+            const float length = n.length();
+            if ( length > 0.0f ) { n /= length; }
+            normals[ 3 * i + 0 ] = n.x();
+            normals[ 3 * i + 1 ] = n.y();
+            normals[ 3 * i + 2 ] = n.z();
+        }
+    } );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Computes the normalized values and the normal vectors for any data type.
+ *  @param  volume [in] pointer to the tetrahedral volume object
+ *  @param  values [out] values normalized by the min/max values of the volume
+ *  @param  normals [out] normal vectors (three components for each node)
+ *  @return false if the volume is not supported
+ */
+/*===========================================================================*/
+inline bool VertexAttributes(
+    const kvs::UnstructuredVolumeObject* volume,
+    kvs::ValueArray<kvs::Real32>& values,
+    kvs::ValueArray<kvs::Real32>& normals )
+{
+    if ( volume->cellType() != kvs::UnstructuredVolumeObject::Tetrahedra ) { return false; }
+    if ( volume->veclen() != 1 ) { return false; }
+
+    const std::type_info& type = volume->values().typeInfo()->type();
+    if ( type == typeid( kvs::Int8 ) ) { ::VertexAttributes<kvs::Int8>( volume, values, normals ); }
+    else if ( type == typeid( kvs::UInt8 ) ) { ::VertexAttributes<kvs::UInt8>( volume, values, normals ); }
+    else if ( type == typeid( kvs::Int16 ) ) { ::VertexAttributes<kvs::Int16>( volume, values, normals ); }
+    else if ( type == typeid( kvs::UInt16 ) ) { ::VertexAttributes<kvs::UInt16>( volume, values, normals ); }
+    else if ( type == typeid( kvs::Int32 ) ) { ::VertexAttributes<kvs::Int32>( volume, values, normals ); }
+    else if ( type == typeid( kvs::UInt32 ) ) { ::VertexAttributes<kvs::UInt32>( volume, values, normals ); }
+    else if ( type == typeid( kvs::Real32 ) ) { ::VertexAttributes<kvs::Real32>( volume, values, normals ); }
+    else if ( type == typeid( kvs::Real64 ) ) { ::VertexAttributes<kvs::Real64>( volume, values, normals ); }
+    else { return false; }
+
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the min/max normalized values of each cell.
+ *  @param  values [in] normalized values at the nodes
+ *  @param  connections [in] connections of the tetrahedral cells
+ *  @return min/max values (two values for each cell)
+ *
+ *  The value in a linear tetrahedron is bounded by the values at the nodes.
+ */
+/*===========================================================================*/
+inline kvs::ValueArray<kvs::Real32> CellRanges(
+    const kvs::ValueArray<kvs::Real32>& values,
+    const kvs::ValueArray<kvs::UInt32>& connections )
+{
+    const size_t ncells = connections.size() / 4;
+    kvs::ValueArray<kvs::Real32> ranges( 2 * ncells );
+    ParallelRanges( ncells, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            const kvs::UInt32* id = connections.data() + 4 * i;
+            float min_value = values[ id[0] ];
+            float max_value = values[ id[0] ];
+            for ( size_t j = 1; j < 4; j++ )
+            {
+                min_value = kvs::Math::Min( min_value, values[ id[j] ] );
+                max_value = kvs::Math::Max( max_value, values[ id[j] ] );
+            }
+            ranges[ 2 * i + 0 ] = min_value;
+            ranges[ 2 * i + 1 ] = max_value;
+        }
+    } );
+
+    return ranges;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the connections of the cells which can contribute to the image.
+ *  @param  ranges [in] min/max normalized values of each cell
+ *  @param  connections [in] connections of the tetrahedral cells
+ *  @param  table [in] transfer function table (RGBA for each entry)
+ *  @return connections of the visible cells
+ *
+ *  A cell is visible if any entry of the transfer function in its value range
+ *  has non-zero opacity. The range is widened by one entry on both sides to
+ *  be conservative for the linear interpolation of the tables. The visible
+ *  cells are compacted by each thread and concatenated in the cell order.
+ */
+/*===========================================================================*/
+inline kvs::ValueArray<kvs::UInt32> VisibleCells(
+    const kvs::ValueArray<kvs::Real32>& ranges,
+    const kvs::ValueArray<kvs::UInt32>& connections,
+    const kvs::ValueArray<kvs::Real32>& table )
+{
+    // Prefix count of the entries with non-zero opacity, which gives the
+    // number of the opaque entries in any range with two lookups.
+    const int resolution = static_cast<int>( table.size() / 4 );
+    std::vector<size_t> counts( resolution + 1, 0 );
+    for ( int i = 0; i < resolution; i++ )
+    {
+        counts[ i + 1 ] = counts[i] + ( table[ 4 * i + 3 ] > 0.0f ? 1 : 0 );
+    }
+
+    const size_t ncells = connections.size() / 4;
+    const size_t nthreads = NumberOfThreads();
+    std::vector<std::vector<kvs::UInt32>> partials( nthreads );
+    ParallelRanges( ncells, [&] ( size_t thread, size_t begin, size_t end )
+    {
+        auto& visible = partials[ thread ];
+        for ( size_t i = begin; i < end; i++ )
+        {
+            const int i0 = kvs::Math::Clamp( int( std::floor( ranges[ 2 * i + 0 ] * resolution ) ) - 1, 0, resolution - 1 );
+            const int i1 = kvs::Math::Clamp( int( std::ceil( ranges[ 2 * i + 1 ] * resolution ) ), 0, resolution - 1 );
+            if ( counts[ i1 + 1 ] == counts[ i0 ] ) { continue; }
+            visible.insert( visible.end(), connections.data() + 4 * i, connections.data() + 4 * i + 4 );
+        }
+    } );
+
+    size_t size = 0;
+    for ( const auto& visible : partials ) { size += visible.size(); }
+
+    kvs::ValueArray<kvs::UInt32> visible_connections( size );
+    size_t offset = 0;
+    for ( const auto& visible : partials )
+    {
+        std::copy( visible.begin(), visible.end(), visible_connections.data() + offset );
+        offset += visible.size();
+    }
+
+    return visible_connections;
+}
+
+/*  Faces of the cells given by the local vertices in the cyclic order. The
+ *  fourth vertex of the triangle face is -1. Only the corner vertices, which
+ *  precede the mid-edge vertices of the quadratic cells, are referred.
+ */
+const int TetrahedronFaces[][4] = {
+    { 1, 2, 3, -1 }, { 0, 3, 2, -1 }, { 0, 1, 3, -1 }, { 0, 2, 1, -1 } };
+const int HexahedronFaces[][4] = {
+    { 0, 3, 2, 1 }, { 4, 5, 6, 7 }, { 0, 1, 5, 4 },
+    { 1, 2, 6, 5 }, { 2, 3, 7, 6 }, { 3, 0, 4, 7 } };
+const int PrismFaces[][4] = { // triangles 0-1-2 and 3-4-5
+    { 0, 2, 1, -1 }, { 3, 4, 5, -1 }, { 0, 1, 4, 3 }, { 1, 2, 5, 4 }, { 2, 0, 3, 5 } };
+const int PyramidFaces[][4] = { // apex 0 and base 1-2-3-4
+    { 1, 4, 3, 2 }, { 0, 1, 2, -1 }, { 0, 2, 3, -1 }, { 0, 3, 4, -1 }, { 0, 4, 1, -1 } };
+
+/*===========================================================================*/
+/**
+ *  @brief  Decomposes the cell into the tetrahedra.
+ *  @param  id [in] node indices of the cell
+ *  @param  faces [in] faces of the cell
+ *  @param  nfaces [in] number of the faces
+ *  @param  ncorners [in] number of the corner vertices
+ *  @param  tetrahedra [out] node indices of the tetrahedra
+ *
+ *  The cell is decomposed into the cones from the corner with the smallest
+ *  node index to the faces not containing the corner, and the quadrilateral
+ *  faces are split on the diagonal from the vertex with the smallest node
+ *  index. Since the diagonal of the face shared with the neighboring cell is
+ *  given by the node indices only, the tetrahedra are conforming. The number
+ *  of the tetrahedra is fixed for the cell type: 6 for the hexahedron, 3 for
+ *  the prism, 2 for the pyramid and 1 for the tetrahedron.
+ */
+/*===========================================================================*/
+inline void TetrahedralizeCell(
+    const kvs::UInt32* id,
+    const int (*faces)[4],
+    const size_t nfaces,
+    const size_t ncorners,
+    kvs::UInt32* tetrahedra )
+{
+    int apex = 0;
+    for ( size_t i = 1; i < ncorners; i++ ) { if ( id[i] < id[ apex ] ) { apex = int( i ); } }
+
+    for ( size_t i = 0; i < nfaces; i++ )
+    {
+        const int* face = faces[i];
+        const size_t nvertices = face[3] < 0 ? 3 : 4;
+        if ( std::find( face, face + nvertices, apex ) != face + nvertices ) { continue; }
+
+        if ( nvertices == 3 )
+        {
+            *tetrahedra++ = id[ apex ];
+            *tetrahedra++ = id[ face[0] ];
+            *tetrahedra++ = id[ face[1] ];
+            *tetrahedra++ = id[ face[2] ];
+            continue;
+        }
+
+        size_t k = 0;
+        for ( size_t j = 1; j < 4; j++ ) { if ( id[ face[j] ] < id[ face[k] ] ) { k = j; } }
+        const kvs::UInt32 a = id[ face[ k ] ];
+        const kvs::UInt32 b = id[ face[ ( k + 1 ) % 4 ] ];
+        const kvs::UInt32 c = id[ face[ ( k + 2 ) % 4 ] ];
+        const kvs::UInt32 d = id[ face[ ( k + 3 ) % 4 ] ];
+        *tetrahedra++ = id[ apex ]; *tetrahedra++ = a; *tetrahedra++ = b; *tetrahedra++ = c;
+        *tetrahedra++ = id[ apex ]; *tetrahedra++ = a; *tetrahedra++ = c; *tetrahedra++ = d;
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Decomposes the cells of the volume into the tetrahedra.
+ *  @param  volume [in] pointer to the unstructured volume object
+ *  @param  connections [out] connections of the tetrahedra
+ *  @return false if the cell type is not supported
+ *
+ *  The tetrahedra share the nodes with the volume, and the quadratic cells
+ *  are decomposed with their corner vertices (linear approximation). The
+ *  cells are divided into the hardware threads, and each cell writes its
+ *  tetrahedra into the preallocated connections at the fixed offset.
+ */
+/*===========================================================================*/
+inline bool Tetrahedralize(
+    const kvs::UnstructuredVolumeObject* volume,
+    kvs::ValueArray<kvs::UInt32>& connections )
+{
+    const int (*faces)[4] = nullptr;
+    size_t nfaces = 0;
+    size_t ncorners = 0;
+    size_t ntetrahedra = 0;
+    switch ( volume->cellType() )
+    {
+    case kvs::UnstructuredVolumeObject::Tetrahedra:
+    case kvs::UnstructuredVolumeObject::QuadraticTetrahedra:
+        faces = TetrahedronFaces; nfaces = 4; ncorners = 4; ntetrahedra = 1; break;
+    case kvs::UnstructuredVolumeObject::Hexahedra:
+    case kvs::UnstructuredVolumeObject::QuadraticHexahedra:
+        faces = HexahedronFaces; nfaces = 6; ncorners = 8; ntetrahedra = 6; break;
+    case kvs::UnstructuredVolumeObject::Prism:
+        faces = PrismFaces; nfaces = 5; ncorners = 6; ntetrahedra = 3; break;
+    case kvs::UnstructuredVolumeObject::Pyramid:
+        faces = PyramidFaces; nfaces = 5; ncorners = 5; ntetrahedra = 2; break;
+    default: return false;
+    }
+
+    const size_t ncells = volume->numberOfCells();
+    const size_t stride = volume->numberOfCellNodes();
+    const kvs::UInt32* src = volume->connections().data();
+    connections.allocate( ncells * ntetrahedra * 4 );
+    kvs::UInt32* dst = connections.data();
+    ParallelRanges( ncells, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            TetrahedralizeCell( src + stride * i, faces, nfaces, ncorners, dst + ntetrahedra * 4 * i );
+        }
+    } );
+
+    return true;
+}
+
+/*  Varyings of the tetrahedra geometry shader captured by the transform
+ *  feedback, which are interleaved in the decomposition cache.
+ */
+const char* const CapturedVaryings[] = {
+    "gl_Position", "position", "normal", "random_index", "position_ndc",
+    "scalar_front", "scalar_back", "depth_front", "depth_back",
+    "wc_inv_front", "wc_inv_back" };
+
+/*  Vertex attributes of the cached pass read from the decomposition cache.
+ *  The pairs of the front and back varyings are read as vec2.
+ */
+struct CachedAttribute
+{
+    const char* name; ///< attribute name in the cached pass
+    GLint size; ///< number of the components
+    size_t offset; ///< offset in the vertex in floats
+};
+const CachedAttribute CachedAttributes[] = {
+    { "clip_position_in", 4, 0 },
+    { "position_in", 3, 4 },
+    { "normal_in", 3, 7 },
+    { "random_index_in", 2, 10 },
+    { "position_ndc_in", 2, 12 },
+    { "scalar_in", 2, 14 },
+    { "depth_in", 2, 16 },
+    { "wc_inv_in", 2, 18 } };
+const size_t CachedVertexSize = 20 * sizeof( kvs::Real32 );
+
+/*  A tetrahedron is decomposed into four triangles at most. */
+const size_t MaxCachedVerticesPerCell = 4 * 3;
+
 } // end of namespace
 
 
@@ -92,6 +551,89 @@ void SSAOStochasticTetrahedraRenderer::setSamplingStep( const float sampling_ste
     static_cast<Engine&>( engine() ).setSamplingStep( sampling_step );
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Sets the files of the time series with the static topology.
+ *  @param  filenames [in] filenames of the time steps
+ *
+ *  The object registered with the renderer is used as the first time step.
+ *  All of the time steps must have the same coordinates and connections, so
+ *  that only the values and the normals are decoded by a background thread
+ *  and streamed into the vertex buffer on the frame boundary.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::setTimeSeries( const std::vector<std::string>& filenames )
+{
+    static_cast<Engine&>( engine() ).setTimeSeries( filenames );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the time step to be displayed.
+ *  @param  step [in] time step
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::setTimeStep( const size_t step )
+{
+    static_cast<Engine&>( engine() ).setTimeStep( step );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the playback of the time series.
+ *  @param  enabled [in] true if the time steps are played back
+ *
+ *  The next time step is displayed as soon as it has been decoded. The
+ *  screen has to be redrawn continuously during the playback.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::setPlaybackEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setPlaybackEnabled( enabled );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the decomposition cache.
+ *  @param  enabled [in] true if the decomposed triangles are cached
+ *
+ *  The visible cells are projected and decomposed into triangles by the
+ *  geometry shader once for the view, and the triangles captured by the
+ *  transform feedback are drawn in the repetitions. The cache is not used
+ *  while the scene is moving or if the triangles exceed the memory budget.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::setDecompositionCacheEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setDecompositionCacheEnabled( enabled );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the memory budget of the decomposition cache.
+ *  @param  bytes [in] memory budget in bytes
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::setDecompositionCacheMemoryBudget( const size_t bytes )
+{
+    static_cast<Engine&>( engine() ).setDecompositionCacheMemoryBudget( bytes );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the spatial ordering of the tetrahedra.
+ *  @param  enabled [in] true if the tetrahedra are reordered
+ *
+ *  The tetrahedra are sorted along the Morton curve of their centers, and
+ *  the nodes are renumbered in the order of the first reference, so that
+ *  the neighboring tetrahedra are drawn close in time.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::setSpatialOrderingEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setSpatialOrderingEnabled( enabled );
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Returns transfer function.
@@ -114,6 +656,36 @@ float SSAOStochasticTetrahedraRenderer::samplingStep() const
     return static_cast<const Engine&>( engine() ).samplingStep();
 }
 
+size_t SSAOStochasticTetrahedraRenderer::numberOfTimeSteps() const
+{
+    return static_cast<const Engine&>( engine() ).numberOfTimeSteps();
+}
+
+size_t SSAOStochasticTetrahedraRenderer::timeStep() const
+{
+    return static_cast<const Engine&>( engine() ).timeStep();
+}
+
+bool SSAOStochasticTetrahedraRenderer::isPlaybackEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isPlaybackEnabled();
+}
+
+bool SSAOStochasticTetrahedraRenderer::isDecompositionCacheEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isDecompositionCacheEnabled();
+}
+
+size_t SSAOStochasticTetrahedraRenderer::decompositionCacheMemoryBudget() const
+{
+    return static_cast<const Engine&>( engine() ).decompositionCacheMemoryBudget();
+}
+
+bool SSAOStochasticTetrahedraRenderer::isSpatialOrderingEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isSpatialOrderingEnabled();
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Constructs a new Engine class.
@@ -134,11 +706,24 @@ SSAOStochasticTetrahedraRenderer::Engine::Engine()
 /*===========================================================================*/
 void SSAOStochasticTetrahedraRenderer::Engine::release()
 {
-    m_buffer_object.release();
+    this->wait_time_step();
+    m_topology_buffer.release();
+    m_value_buffers[0].release();
+    m_value_buffers[1].release();
+    m_visible_cell_buffer.release();
+    m_cell_ranges = kvs::ValueArray<kvs::Real32>();
+    m_nvisible_cells = 0;
+    m_visible_cells_changed = true;
+    m_capture_program.release();
+    m_cached_pass_program.release();
+    m_decomposition_cache.release();
+    m_ncached_vertices = 0;
+    m_decomposition_cache_changed = true;
     m_render_pass.release();
-    m_transfer_function_buffer.release();
+    m_transfer_function_texture.release();
     m_preintegration_buffer.release();
     m_decomposition_buffer.release();
+    m_transfer_function_table = kvs::ValueArray<kvs::Real32>();
     m_transfer_function_changed = true;
 }
 
@@ -212,15 +797,32 @@ void SSAOStochasticTetrahedraRenderer::Engine::setup(
     kvs::Camera* camera,
     kvs::Light* light )
 {
-    kvs::IgnoreUnusedVariable( object );
     kvs::IgnoreUnusedVariable( camera );
     kvs::IgnoreUnusedVariable( light );
 
+    // Upload the tetrahedra again if the spatial ordering has been changed
+    if ( m_spatial_ordering_changed )
+    {
+        this->update_buffer_object( kvs::UnstructuredVolumeObject::DownCast( object ) );
+    }
+
     if ( m_transfer_function_changed )
     {
         this->update_transfer_function_texture();
     }
 
+    // Stream the decoded time step on the frame boundary
+    if ( m_time_series.size() > 0 )
+    {
+        this->update_time_series( kvs::UnstructuredVolumeObject::DownCast( object ) );
+    }
+
+    // Cull the cells for the changed transfer function or values
+    if ( m_visible_cells_changed )
+    {
+        this->update_visible_cells();
+    }
+
     m_render_pass.setup( BaseClass::shader() );
 
     auto& shader_program = m_render_pass.shaderProgram();
@@ -229,6 +831,20 @@ void SSAOStochasticTetrahedraRenderer::Engine::setup(
     shader_program.setUniform( "delta", 0.5f / m_transfer_function.resolution() );
     shader_program.setUniform( "edge_factor", m_edge_factor );
     shader_program.unbind();
+
+    // The fragment shader of the cached pass is the same as the geometry pass.
+    if ( m_cached_pass_program.isCreated() )
+    {
+        const auto M = kvs::OpenGL::ModelViewMatrix();
+        const auto P = kvs::OpenGL::ProjectionMatrix();
+        auto& cached_pass = m_cached_pass_program;
+        kvs::ProgramObject::Binder bind( cached_pass );
+        cached_pass.setUniform( "ModelViewProjectionMatrixInverse", ( P * M ).inverted() );
+        cached_pass.setUniform( "sampling_step_inv", 1.0f / m_render_pass.samplingStep() );
+        cached_pass.setUniform( "maxT", m_preintegration_buffer.Tmax() );
+        cached_pass.setUniform( "delta", 0.5f / m_transfer_function.resolution() );
+        cached_pass.setUniform( "edge_factor", m_edge_factor );
+    }
 }
 
 /*===========================================================================*/
@@ -251,27 +867,128 @@ void SSAOStochasticTetrahedraRenderer::Engine::draw(
 
 /*===========================================================================*/
 /**
- *  @brief  Creates pre-integration texture.
+ *  @brief  Updates the engine for the replaced volume object.
+ *  @param  object [in] pointer to the replaced object
+ *  @return true if the engine has been updated without recreating it
+ *
+ *  The engine can be updated only if the topology (coordinates and
+ *  connections) is unchanged. Then, only the values and the normals are
+ *  uploaded to the back value buffer, and the buffers are swapped.
+ */
+/*===========================================================================*/
+bool SSAOStochasticTetrahedraRenderer::Engine::replaceObject( kvs::ObjectBase* object )
+{
+    auto* volume = kvs::UnstructuredVolumeObject::DownCast( object );
+    if ( !volume ) { return false; }
+    if ( !m_topology_buffer.isCreated() ) { return false; }
+    if ( !::IsSameArray( m_coords, volume->coords() ) ||
+         !::IsSameArray( m_source_connections, volume->connections() ) ) { return false; }
+
+    const auto* tetrahedra = this->tetrahedral_volume( volume );
+    if ( !tetrahedra ) { return false; }
+
+    kvs::ValueArray<kvs::Real32> values;
+    kvs::ValueArray<kvs::Real32> normals;
+    if ( !::VertexAttributes( tetrahedra, values, normals ) ) { return false; }
+
+    BaseClass::attachObject( object );
+    this->upload_values( values, normals );
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the files of the time series.
+ *  @param  filenames [in] filenames of the time steps
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::setTimeSeries(
+    const std::vector<std::string>& filenames )
+{
+    this->wait_time_step();
+    m_time_series = filenames;
+    m_time_step = 0;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates transfer function texture and pre-integration texture.
  */
 /*===========================================================================*/
 void SSAOStochasticTetrahedraRenderer::Engine::create_transfer_function_texture()
 {
-    m_preintegration_buffer.create( m_transfer_function );
-    m_transfer_function_buffer.create( m_transfer_function );
+    m_transfer_function_table = m_transfer_function.table();
+    const size_t width = m_transfer_function.resolution();
+    m_transfer_function_texture.setWrapS( GL_CLAMP_TO_EDGE );
+    m_transfer_function_texture.setMagFilter( GL_LINEAR );
+    m_transfer_function_texture.setMinFilter( GL_LINEAR );
+    m_transfer_function_texture.setPixelFormat( GL_RGBA32F_ARB, GL_RGBA, GL_FLOAT );
+    m_transfer_function_texture.create( width, m_transfer_function_table.data() );
+
+    this->create_preintegration_texture();
     m_transfer_function_changed = false;
+    m_visible_cells_changed = true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Updates transfer function texture and pre-integration texture.
+ *
+ *  Nothing is updated if the table is unchanged. Otherwise, the table is
+ *  uploaded into the allocated transfer function texture unless the
+ *  resolution has been changed, and then the pre-integration table is rebuilt.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::update_transfer_function_texture()
+{
+    const auto table = m_transfer_function.table();
+    if ( ::IsSameTable( table, m_transfer_function_table ) )
+    {
+        m_transfer_function_changed = false;
+        return;
+    }
+
+    const size_t width = m_transfer_function.resolution();
+    if ( m_transfer_function_texture.width() != width )
+    {
+        m_transfer_function_texture.release();
+        m_preintegration_buffer.release();
+        this->create_transfer_function_texture();
+        return;
+    }
+
+    m_transfer_function_table = table;
+    {
+        kvs::Texture::Binder binder( m_transfer_function_texture );
+        m_transfer_function_texture.load( width, m_transfer_function_table.data() );
+    }
+
+    m_preintegration_buffer.release();
+    this->create_preintegration_texture();
+    m_transfer_function_changed = false;
+    m_visible_cells_changed = true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates pre-integration texture.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::create_preintegration_texture()
+{
+    m_preintegration_buffer.create( m_transfer_function );
 
     const auto inv_size = m_preintegration_buffer.inverseTextureSize();
     auto& geom_pass = m_render_pass.shaderProgram();
     geom_pass.bind();
     geom_pass.setUniform( "delta2", 0.5f / inv_size );
     geom_pass.unbind();
-}
 
-void SSAOStochasticTetrahedraRenderer::Engine::update_transfer_function_texture()
-{
-    m_transfer_function_buffer.release();
-    m_preintegration_buffer.release();
-    this->create_transfer_function_texture();
+    if ( m_cached_pass_program.isCreated() )
+    {
+        kvs::ProgramObject::Binder bind( m_cached_pass_program );
+        m_cached_pass_program.setUniform( "delta2", 0.5f / inv_size );
+    }
 }
 
 /*===========================================================================*/
@@ -284,6 +1001,43 @@ void SSAOStochasticTetrahedraRenderer::Engine::create_decomposition_texture()
     m_decomposition_buffer.create();
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Returns the volume decomposed into the tetrahedra.
+ *  @param  volume [in] pointer to the unstructured volume object
+ *  @return pointer to the tetrahedral volume (null if not supported)
+ *
+ *  The tetrahedral volume is returned as it is. Otherwise, the cells are
+ *  decomposed only if the connections differ from the previous ones, and
+ *  the decomposed volume refers to the nodes and the values of the volume.
+ */
+/*===========================================================================*/
+const kvs::UnstructuredVolumeObject* SSAOStochasticTetrahedraRenderer::Engine::tetrahedral_volume(
+    const kvs::UnstructuredVolumeObject* volume )
+{
+    if ( volume->cellType() == kvs::UnstructuredVolumeObject::Tetrahedra ) { return volume; }
+
+    const bool decomposed = m_tetrahedral_volume.connections().size() > 0 &&
+        ::IsSameArray( m_source_connections, volume->connections() );
+    if ( !decomposed )
+    {
+        kvs::ValueArray<kvs::UInt32> connections;
+        if ( !::Tetrahedralize( volume, connections ) ) { return nullptr; }
+        m_source_connections = volume->connections();
+        m_tetrahedral_volume.setCellType( kvs::UnstructuredVolumeObject::Tetrahedra );
+        m_tetrahedral_volume.setConnections( connections );
+        m_tetrahedral_volume.setNumberOfCells( connections.size() / 4 );
+    }
+
+    m_tetrahedral_volume.setVeclen( volume->veclen() );
+    m_tetrahedral_volume.setNumberOfNodes( volume->numberOfNodes() );
+    m_tetrahedral_volume.setCoords( volume->coords() );
+    m_tetrahedral_volume.setValues( volume->values() );
+    const kvs::Vec2 range = ::ValueRange( volume );
+    m_tetrahedral_volume.setMinMaxValues( range[0], range[1] );
+    return &m_tetrahedral_volume;
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Creates buffer object.
@@ -293,7 +1047,42 @@ void SSAOStochasticTetrahedraRenderer::Engine::create_decomposition_texture()
 void SSAOStochasticTetrahedraRenderer::Engine::create_buffer_object(
     const kvs::UnstructuredVolumeObject* volume )
 {
-    m_buffer_object.create( volume, m_render_pass.shaderProgram() );
+    const auto* tetrahedra = this->tetrahedral_volume( volume );
+    kvs::ValueArray<kvs::Real32> values;
+    kvs::ValueArray<kvs::Real32> normals;
+    if ( !tetrahedra || !::VertexAttributes( tetrahedra, values, normals ) )
+    {
+        kvsMessageError( "Not supported volume object (tetrahedral, hexahedral, prismatic or pyramidal cells with scalar values are required)." );
+        return;
+    }
+
+    // Keep the topology for detecting the static topology on replacement
+    m_coords = volume->coords();
+    m_source_connections = volume->connections();
+    m_connections = tetrahedra->connections();
+
+    // Reorder the tetrahedra and the nodes along the Morton curve
+    kvs::ValueArray<kvs::Real32> coords = m_coords;
+    m_spatial_order.release();
+    m_spatial_ordering_changed = false;
+    if ( m_enable_spatial_ordering )
+    {
+        m_spatial_order.create( m_coords, m_connections, 4 );
+        m_connections = m_spatial_order.connections();
+        coords = m_spatial_order.reorderVertices( m_coords, 3 );
+    }
+
+    const auto nnodes = volume->numberOfNodes();
+    const auto indices = BaseClass::randomIndices( nnodes );
+    const auto location = m_render_pass.shaderProgram().attributeLocation( "random_index" );
+    m_topology_buffer.setVertexArray( coords, 3 );
+    m_topology_buffer.setVertexAttribArray( indices, location, 2 );
+    m_topology_buffer.create();
+
+    const size_t size = ( values.size() + normals.size() ) * sizeof( kvs::Real32 );
+    m_value_buffers[0].create( size );
+    m_value_buffers[1].create( size );
+    this->upload_values( values, normals );
 }
 
 /*===========================================================================*/
@@ -305,10 +1094,54 @@ void SSAOStochasticTetrahedraRenderer::Engine::create_buffer_object(
 void SSAOStochasticTetrahedraRenderer::Engine::update_buffer_object(
     const kvs::UnstructuredVolumeObject* volume )
 {
-    m_buffer_object.release();
+    this->wait_time_step();
+    m_topology_buffer.release();
+    m_value_buffers[0].release();
+    m_value_buffers[1].release();
+    m_visible_cell_buffer.release();
     this->create_buffer_object( volume );
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Uploads the values and the normals to the back value buffer.
+ *  @param  source_values [in] normalized values in the node order of the volume
+ *  @param  source_normals [in] normal vectors in the node order of the volume
+ *
+ *  The back buffer is not used by the previous frame, so that the upload
+ *  does not wait for the draw commands of the front buffer. The buffers are
+ *  swapped after the upload, and the ensemble is invalidated. The values and
+ *  the normals are reordered for the uploaded nodes if the spatial ordering
+ *  is enabled.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::upload_values(
+    const kvs::ValueArray<kvs::Real32>& source_values,
+    const kvs::ValueArray<kvs::Real32>& source_normals )
+{
+    const bool ordered = m_spatial_order.isCreated();
+    const auto values = ordered ? m_spatial_order.reorderVertices( source_values, 1 ) : source_values;
+    const auto normals = ordered ? m_spatial_order.reorderVertices( source_normals, 3 ) : source_normals;
+
+    const size_t back = 1 - m_front_buffer;
+    auto& buffer = m_value_buffers[ back ];
+    const size_t values_size = values.size() * sizeof( kvs::Real32 );
+    const size_t normals_size = normals.size() * sizeof( kvs::Real32 );
+    buffer.bind();
+    buffer.load( values_size, values.data(), 0 );
+    buffer.load( normals_size, normals.data(), values_size );
+    buffer.unbind();
+    m_front_buffer = back;
+
+    // The repetitions accumulated for the previous values are discarded.
+    BaseClass::invalidateEnsemble();
+
+    // The cell ranges are changed with the values.
+    m_cell_ranges = ::CellRanges( values, m_connections );
+    m_visible_cells_changed = true;
+    m_decomposition_cache_changed = true;
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Draws buffer object.
@@ -330,15 +1163,381 @@ void SSAOStochasticTetrahedraRenderer::Engine::draw_buffer_object(
     auto& geom_pass = m_render_pass.shaderProgram();
     kvs::ProgramObject::Binder bind( geom_pass );
     geom_pass.setUniform( "random_offset", random_offset );
+    geom_pass.setUniform( "render_mode", static_cast<int>( BaseClass::renderMode() ) );
 
     // Draw buffer object
     kvs::Texture::Binder unit0( randomTexture(), 0 );
     kvs::Texture::Binder unit1( m_preintegration_buffer.texture(), 1 );
     kvs::Texture::Binder unit2( m_decomposition_buffer.texture(), 2 );
-    kvs::Texture::Binder unit3( m_transfer_function_buffer.texture(), 3 );
+    kvs::Texture::Binder unit3( m_transfer_function_texture, 3 );
     kvs::Texture::Binder unit4( m_preintegration_buffer.T(), 4 );
     kvs::Texture::Binder unit5( m_preintegration_buffer.Tinverse(), 5 );
-    m_buffer_object.draw( volume );
+    kvs::IgnoreUnusedVariable( volume );
+    if ( !m_topology_buffer.isCreated() ) { return; }
+    if ( m_nvisible_cells == 0 ) { return; }
+
+    // The programs of the decomposition cache are created when the cache is
+    // used for the first time, and the cache is disabled if they cannot be.
+    if ( m_enable_decomposition_cache && !m_capture_program.isCreated() )
+    {
+        m_enable_decomposition_cache = this->create_decomposition_cache();
+    }
+
+    // Draw the captured triangles for the static view
+    if ( this->is_decomposition_cache_available() )
+    {
+        const auto M = kvs::OpenGL::ModelViewMatrix();
+        const auto P = kvs::OpenGL::ProjectionMatrix();
+        if ( m_decomposition_cache_changed || !( M == m_cached_modelview ) || !( P == m_cached_projection ) )
+        {
+            this->capture_decomposition_cache();
+        }
+        this->draw_decomposition_cache( random_offset );
+        return;
+    }
+
+    this->draw_visible_cells();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Draws the visible cells with the geometry shader.
+ *
+ *  The cells are drawn with the program bound by the caller, which is the
+ *  geometry pass or the capture program of the decomposition cache.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::draw_visible_cells()
+{
+    // The values and the normals are given by the front value buffer.
+    const size_t nnodes = m_coords.size() / 3;
+    const auto* normals_offset = reinterpret_cast<const GLvoid*>( nnodes * sizeof( kvs::Real32 ) );
+    const auto value_location = m_render_pass.shaderProgram().attributeLocation( "value" );
+    kvs::VertexBufferObjectManager::Binder bind_manager( m_topology_buffer );
+    auto& buffer = m_value_buffers[ m_front_buffer ];
+    buffer.bind();
+    KVS_GL_CALL( glEnableVertexAttribArray( value_location ) );
+    KVS_GL_CALL( glVertexAttribPointer( value_location, 1, GL_FLOAT, GL_FALSE, 0, nullptr ) );
+    KVS_GL_CALL( glEnableClientState( GL_NORMAL_ARRAY ) );
+    KVS_GL_CALL( glNormalPointer( GL_FLOAT, 0, normals_offset ) );
+    buffer.unbind();
+
+    // Only the visible cells are decomposed by the geometry shader.
+    m_visible_cell_buffer.bind();
+    KVS_GL_CALL( glDrawElements( GL_LINES_ADJACENCY_EXT, GLsizei( 4 * m_nvisible_cells ), GL_UNSIGNED_INT, nullptr ) );
+    m_visible_cell_buffer.unbind();
+
+    KVS_GL_CALL( glDisableClientState( GL_NORMAL_ARRAY ) );
+    KVS_GL_CALL( glDisableVertexAttribArray( value_location ) );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates the shader programs of the decomposition cache.
+ *  @return true if the programs have been created
+ *
+ *  The capture program consists of the vertex and geometry shaders of the
+ *  geometry pass, whose outputs are captured by the transform feedback. The
+ *  attribute locations are bound to the ones of the geometry pass, so that
+ *  the vertex buffers are shared. The cached pass passes the captured
+ *  vertices to the fragment shader of the geometry pass.
+ */
+/*===========================================================================*/
+bool SSAOStochasticTetrahedraRenderer::Engine::create_decomposition_cache()
+{
+    auto& geom_pass = m_render_pass.shaderProgram();
+    const auto random_location = geom_pass.attributeLocation( "random_index" );
+    const auto value_location = geom_pass.attributeLocation( "value" );
+
+    // Capture program
+    {
+        kvs::VertexShader vert;
+        kvs::GeometryShader geom;
+        vert.create( kvs::ShaderSource( "SSAO_SR_tetrahedra_geom_pass.vert" ) );
+        geom.create( kvs::ShaderSource( "SSAO_SR_tetrahedra_geom_pass.geom" ) );
+        m_capture_program.create();
+        m_capture_program.attach( vert );
+        m_capture_program.attach( geom );
+
+        const GLuint id = m_capture_program.id();
+        const GLsizei nvaryings = GLsizei( sizeof( ::CapturedVaryings ) / sizeof( ::CapturedVaryings[0] ) );
+        KVS_GL_CALL( glProgramParameteriEXT( id, GL_GEOMETRY_INPUT_TYPE_EXT, GL_LINES_ADJACENCY_EXT ) );
+        KVS_GL_CALL( glProgramParameteriEXT( id, GL_GEOMETRY_OUTPUT_TYPE_EXT, GL_TRIANGLE_STRIP ) );
+        KVS_GL_CALL( glProgramParameteriEXT( id, GL_GEOMETRY_VERTICES_OUT_EXT, GLint( ::MaxCachedVerticesPerCell ) ) );
+        KVS_GL_CALL( glBindAttribLocation( id, random_location, "random_index" ) );
+        KVS_GL_CALL( glBindAttribLocation( id, value_location, "value" ) );
+        KVS_GL_CALL( glTransformFeedbackVaryings( id, nvaryings, ::CapturedVaryings, GL_INTERLEAVED_ATTRIBS ) );
+        if ( !m_capture_program.link() )
+        {
+            kvsMessageWarning( "Cannot link the capture program of the decomposition cache." );
+            m_capture_program.release();
+            return false;
+        }
+
+        kvs::ProgramObject::Binder bind( m_capture_program );
+        m_capture_program.setUniform( "decomposition_texture", 2 );
+    }
+
+    // Cached pass
+    {
+        kvs::ShaderSource vert( "SSAO_SR_tetrahedra_cached_pass.vert" );
+        kvs::ShaderSource frag( "SSAO_SR_tetrahedra_geom_pass.frag" );
+        m_cached_pass_program.build( vert, frag );
+
+        const auto inv_size = m_preintegration_buffer.inverseTextureSize();
+        auto& cached_pass = m_cached_pass_program;
+        kvs::ProgramObject::Binder bind( cached_pass );
+        cached_pass.setUniform( "random_texture_size_inv", 1.0f / randomTextureSize() );
+        cached_pass.setUniform( "random_texture", 0 );
+        cached_pass.setUniform( "preintegration_texture", 1 );
+        cached_pass.setUniform( "transfer_function_texture", 3 );
+        cached_pass.setUniform( "T_texture", 4 );
+        cached_pass.setUniform( "invT_texture", 5 );
+        cached_pass.setUniform( "delta2", 0.5f / inv_size );
+    }
+
+    m_decomposition_cache_changed = true;
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if the decomposition cache can be used for the frame.
+ *  @return true if the decomposition cache is available
+ *
+ *  The cache is not used while the scene is moving, since the view changes
+ *  in every frame drawn with a single repetition.
+ */
+/*===========================================================================*/
+bool SSAOStochasticTetrahedraRenderer::Engine::is_decomposition_cache_available() const
+{
+    if ( !m_enable_decomposition_cache ) { return false; }
+    if ( BaseClass::isInteractive() ) { return false; }
+    if ( !m_capture_program.isCreated() || !m_cached_pass_program.isCreated() ) { return false; }
+
+    const size_t size = m_nvisible_cells * ::MaxCachedVerticesPerCell * ::CachedVertexSize;
+    return size <= m_decomposition_cache_budget;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Captures the triangles decomposed for the current view.
+ *
+ *  The rasterization is discarded during the capture. The number of the
+ *  captured triangles is read back once for the view.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::capture_decomposition_cache()
+{
+    const size_t size = m_nvisible_cells * ::MaxCachedVerticesPerCell * ::CachedVertexSize;
+    if ( m_decomposition_cache.isCreated() && m_decomposition_cache.size() < size )
+    {
+        m_decomposition_cache.release();
+    }
+
+    if ( !m_decomposition_cache.isCreated() )
+    {
+        m_decomposition_cache.create( size );
+    }
+
+    const auto M = kvs::OpenGL::ModelViewMatrix();
+    const auto P = kvs::OpenGL::ProjectionMatrix();
+    const auto N = kvs::Mat3( M[0].xyz(), M[1].xyz(), M[2].xyz() );
+
+    auto& capture = m_capture_program;
+    kvs::ProgramObject::Binder bind( capture );
+    capture.setUniform( "ModelViewMatrix", M );
+    capture.setUniform( "ModelViewProjectionMatrix", P * M );
+    capture.setUniform( "NormalMatrix", N );
+
+    GLuint query = 0;
+    KVS_GL_CALL( glGenQueries( 1, &query ) );
+    KVS_GL_CALL( glBindBufferBase( GL_TRANSFORM_FEEDBACK_BUFFER, 0, m_decomposition_cache.id() ) );
+    KVS_GL_CALL( glEnable( GL_RASTERIZER_DISCARD ) );
+    KVS_GL_CALL( glBeginQuery( GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, query ) );
+    KVS_GL_CALL( glBeginTransformFeedback( GL_TRIANGLES ) );
+    this->draw_visible_cells();
+    KVS_GL_CALL( glEndTransformFeedback() );
+    KVS_GL_CALL( glEndQuery( GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN ) );
+    KVS_GL_CALL( glDisable( GL_RASTERIZER_DISCARD ) );
+    KVS_GL_CALL( glBindBufferBase( GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0 ) );
+
+    GLuint ntriangles = 0;
+    KVS_GL_CALL( glGetQueryObjectuiv( query, GL_QUERY_RESULT, &ntriangles ) );
+    KVS_GL_CALL( glDeleteQueries( 1, &query ) );
+
+    m_ncached_vertices = 3 * size_t( ntriangles );
+    m_cached_modelview = M;
+    m_cached_projection = P;
+    m_decomposition_cache_changed = false;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Draws the captured triangles with the cached pass.
+ *  @param  random_offset [in] offset for accessing to the random texture
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::draw_decomposition_cache( const kvs::Vec2& random_offset )
+{
+    if ( m_ncached_vertices == 0 ) { return; }
+
+    auto& cached_pass = m_cached_pass_program;
+    kvs::ProgramObject::Binder bind( cached_pass );
+    cached_pass.setUniform( "random_offset", random_offset );
+    cached_pass.setUniform( "render_mode", static_cast<int>( BaseClass::renderMode() ) );
+
+    m_decomposition_cache.bind();
+    for ( const auto& attribute : ::CachedAttributes )
+    {
+        const auto location = cached_pass.attributeLocation( attribute.name );
+        if ( location < 0 ) { continue; }
+        const auto* offset = reinterpret_cast<const GLvoid*>( attribute.offset * sizeof( kvs::Real32 ) );
+        KVS_GL_CALL( glEnableVertexAttribArray( location ) );
+        KVS_GL_CALL( glVertexAttribPointer( location, attribute.size, GL_FLOAT, GL_FALSE, GLsizei( ::CachedVertexSize ), offset ) );
+    }
+    m_decomposition_cache.unbind();
+
+    KVS_GL_CALL( glDrawArrays( GL_TRIANGLES, 0, GLsizei( m_ncached_vertices ) ) );
+
+    for ( const auto& attribute : ::CachedAttributes )
+    {
+        const auto location = cached_pass.attributeLocation( attribute.name );
+        if ( location < 0 ) { continue; }
+        KVS_GL_CALL( glDisableVertexAttribArray( location ) );
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Updates the connections of the visible cells.
+ *
+ *  The cells are culled with the cell ranges and the transfer function table
+ *  on the CPU, and the compacted connections are uploaded to the index buffer.
+ *  The buffer is reallocated only if the compacted connections exceed it.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::update_visible_cells()
+{
+    if ( m_cell_ranges.size() == 0 || m_transfer_function_table.size() == 0 ) { return; }
+
+    const auto connections = ::VisibleCells( m_cell_ranges, m_connections, m_transfer_function_table );
+    const size_t size = connections.size() * sizeof( kvs::UInt32 );
+    if ( m_visible_cell_buffer.isCreated() && m_visible_cell_buffer.size() < size )
+    {
+        m_visible_cell_buffer.release();
+    }
+
+    if ( !m_visible_cell_buffer.isCreated() )
+    {
+        m_visible_cell_buffer.create( kvs::Math::Max( size, sizeof( kvs::UInt32 ) ) );
+    }
+
+    if ( size > 0 )
+    {
+        m_visible_cell_buffer.bind();
+        m_visible_cell_buffer.load( size, connections.data(), 0 );
+        m_visible_cell_buffer.unbind();
+    }
+
+    m_nvisible_cells = connections.size() / 4;
+    m_visible_cells_changed = false;
+    m_decomposition_cache_changed = true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Streams the decoded time step and prefetches the next time step.
+ *  @param  volume [in] pointer to the unstructured volume object (first time step)
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::update_time_series(
+    const kvs::UnstructuredVolumeObject* volume )
+{
+    const size_t nsteps = m_time_series.size();
+
+    if ( m_prefetch.valid() && m_prefetch.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready )
+    {
+        const TimeStep step = m_prefetch.get();
+
+        // The time step which is no longer requested is discarded.
+        if ( m_time_step_requested && step.index == m_next_time_step )
+        {
+            m_time_step_requested = false;
+            m_time_step = step.index;
+            if ( step.values.size() == volume->numberOfNodes() ) { this->upload_values( step.values, step.normals ); }
+            else { kvsMessageWarning( "Cannot load the time step '%s'.", m_time_series[ step.index ].c_str() ); }
+        }
+    }
+
+    // The next time step is decoded while the current time step is rendered.
+    if ( m_enable_playback && !m_time_step_requested )
+    {
+        m_next_time_step = ( m_time_step + 1 ) % nsteps;
+        m_time_step_requested = true;
+    }
+
+    if ( m_time_step_requested && !m_prefetch.valid() )
+    {
+        this->prefetch_time_step( volume, m_next_time_step );
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Starts decoding the time step in the background.
+ *  @param  volume [in] pointer to the unstructured volume object (first time step)
+ *  @param  step [in] time step
+ *
+ *  The values are normalized by the min/max values of the first time step.
+ *  The time step whose topology differs from the uploaded one is not loaded.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::prefetch_time_step(
+    const kvs::UnstructuredVolumeObject* volume,
+    const size_t step )
+{
+    const std::string filename = m_time_series[ step ];
+    const kvs::ValueArray<kvs::Real32> coords = m_coords;
+    const kvs::ValueArray<kvs::UInt32> source_connections = m_source_connections;
+    const kvs::ValueArray<kvs::UInt32> connections =
+        volume->cellType() == kvs::UnstructuredVolumeObject::Tetrahedra ?
+        m_source_connections : m_tetrahedral_volume.connections();
+    const kvs::Vec2 range = ::ValueRange( volume );
+    const double min_value = range[0];
+    const double max_value = range[1];
+    m_prefetch = std::async( std::launch::async, [=] ()
+    {
+        TimeStep time_step;
+        time_step.index = step;
+
+        // The decomposed connections of the first time step are reused. The
+        // attributes are computed in the node order of the volume.
+        auto* data = new kvs::UnstructuredVolumeImporter( filename );
+        if ( ::IsSameArray( coords, data->coords() ) &&
+             ::IsSameArray( source_connections, data->connections() ) )
+        {
+            data->setCellType( kvs::UnstructuredVolumeObject::Tetrahedra );
+            data->setConnections( connections );
+            data->setNumberOfCells( connections.size() / 4 );
+            data->setMinMaxValues( min_value, max_value );
+            ::VertexAttributes( data, time_step.values, time_step.normals );
+        }
+        delete data;
+
+        return time_step;
+    } );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Waits for the time step decoded in the background, and discards it.
+ */
+/*===========================================================================*/
+void SSAOStochasticTetrahedraRenderer::Engine::wait_time_step()
+{
+    if ( m_prefetch.valid() ) { m_prefetch.get(); }
+    m_time_step_requested = false;
 }
 
 } // end of namespace AmbientOcclusionRendering
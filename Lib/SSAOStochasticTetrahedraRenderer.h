@@ -12,17 +12,25 @@
  */
 /*****************************************************************************/
 #pragma once
+#include <string>
+#include <vector>
+#include <future>
 #include <kvs/Module>
 #include <kvs/TransferFunction>
 #include <kvs/Texture1D>
 #include <kvs/Texture2D>
 #include <kvs/ProgramObject>
+#include <kvs/Matrix44>
 #include <kvs/UnstructuredVolumeObject>
 #include <kvs/VertexBufferObjectManager>
+#include <kvs/VertexBufferObject>
+#include <kvs/IndexBufferObject>
 #include <kvs/StochasticRenderingEngine>
 #include <kvs/StochasticRendererBase>
 #include <kvs/StochasticTetrahedraRenderer>
 #include "SSAOStochasticRendererBase.h"
+#include "SSAOStochasticRenderingEngine.h"
+#include "SpatialOrder.h"
 
 
 namespace AmbientOcclusionRendering
@@ -48,8 +56,20 @@ public:
     void setEdgeFactor( const float factor );
     void setSamplingStep( const float sampling_step );
     void setTransferFunction( const kvs::TransferFunction& transfer_function );
+    void setTimeSeries( const std::vector<std::string>& filenames );
+    void setTimeStep( const size_t step );
+    void setPlaybackEnabled( const bool enabled = true );
+    void setDecompositionCacheEnabled( const bool enabled = true );
+    void setDecompositionCacheMemoryBudget( const size_t bytes );
+    void setSpatialOrderingEnabled( const bool enabled = true );
     const kvs::TransferFunction& transferFunction() const;
     float samplingStep() const;
+    size_t numberOfTimeSteps() const;
+    size_t timeStep() const;
+    bool isPlaybackEnabled() const;
+    bool isDecompositionCacheEnabled() const;
+    size_t decompositionCacheMemoryBudget() const;
+    bool isSpatialOrderingEnabled() const;
 };
 
 /*===========================================================================*/
@@ -57,11 +77,11 @@ public:
  *  @brief  Engine class for stochastic polygon renderer.
  */
 /*===========================================================================*/
-class SSAOStochasticTetrahedraRenderer::Engine : public kvs::StochasticRenderingEngine
+class SSAOStochasticTetrahedraRenderer::Engine : public SSAOStochasticRenderingEngine
 {
     using TetEngine = kvs::StochasticTetrahedraRenderer::Engine;
 public:
-    using BaseClass = kvs::StochasticRenderingEngine;
+    using BaseClass = SSAOStochasticRenderingEngine;
     using TransferFunctionBuffer = TetEngine::TransferFunctionBuffer;
     using PreIntegrationBuffer = TetEngine::PreIntegrationBuffer;
     using DecompositionBuffer = TetEngine::DecompositionBuffer;
@@ -71,13 +91,69 @@ public:
 private:
     bool m_transfer_function_changed = true; ///< flag for changin transfer function
     kvs::TransferFunction m_transfer_function{}; ///< transfer function
-    TransferFunctionBuffer m_transfer_function_buffer{}; ///< transfer function buffer
+    kvs::ValueArray<kvs::Real32> m_transfer_function_table{}; ///< table uploaded to the textures
+    kvs::Texture1D m_transfer_function_texture{}; ///< transfer function texture
     PreIntegrationBuffer m_preintegration_buffer{}; ///< pre-integration buffer
     DecompositionBuffer m_decomposition_buffer{}; ///< decomposition buffer
-    BufferObject m_buffer_object{ this }; ///< buffer object
+    BufferObject m_buffer_object{ this }; ///< buffer object given to the render pass (not created)
     RenderPass m_render_pass{ m_buffer_object }; ///< render pass (geometry pass for SSAO)
     kvs::Real32 m_edge_factor = 0.0f; ///< edge enhancement factor
 
+    // Vertex buffers. The topology (coordinates and random indices) is
+    // uploaded once, and the values and the normals, which change in time,
+    // are streamed into the double-buffered value buffers.
+    kvs::ValueArray<kvs::Real32> m_coords{}; ///< coordinates of the uploaded volume
+    kvs::ValueArray<kvs::UInt32> m_connections{}; ///< connections of the uploaded tetrahedra
+    kvs::VertexBufferObjectManager m_topology_buffer{}; ///< coordinates and random indices
+    kvs::VertexBufferObject m_value_buffers[2]; ///< normalized values followed by normals
+    size_t m_front_buffer = 0; ///< index of the value buffer of the displayed values
+
+    // Tetrahedral decomposition. The hexahedra, prisms and pyramids (and the
+    // quadratic cells) are decomposed into the tetrahedra, and the result is
+    // kept for the connections of the source volume.
+    kvs::ValueArray<kvs::UInt32> m_source_connections{}; ///< connections of the source volume
+    kvs::UnstructuredVolumeObject m_tetrahedral_volume{}; ///< decomposed volume sharing the nodes with the source
+
+    // Spatial ordering. The tetrahedra and the nodes are uploaded in the order
+    // along the Morton curve, and the values are reordered on the upload.
+    bool m_enable_spatial_ordering = false; ///< flag for the spatial ordering
+    bool m_spatial_ordering_changed = false; ///< flag for changing the spatial ordering
+    SpatialOrder m_spatial_order{}; ///< order of the uploaded tetrahedra and nodes
+
+    // Cell culling. Only the cells whose value ranges have non-zero opacity
+    // in the transfer function are drawn.
+    kvs::ValueArray<kvs::Real32> m_cell_ranges{}; ///< min/max normalized values of each cell
+    kvs::IndexBufferObject m_visible_cell_buffer{}; ///< connections of the visible cells
+    size_t m_nvisible_cells = 0; ///< number of the visible cells
+    bool m_visible_cells_changed = true; ///< flag for updating the visible cells
+
+    // Decomposition cache. The visible cells are projected and decomposed
+    // into triangles once for the view, and the triangles captured by the
+    // transform feedback are drawn in each repetition.
+    bool m_enable_decomposition_cache = true; ///< flag for the decomposition cache
+    size_t m_decomposition_cache_budget = 512 * 1024 * 1024; ///< memory budget of the cache in bytes
+    bool m_decomposition_cache_changed = true; ///< flag for capturing the triangles again
+    kvs::Mat4 m_cached_modelview{}; ///< model-view matrix of the captured triangles
+    kvs::Mat4 m_cached_projection{}; ///< projection matrix of the captured triangles
+    kvs::ProgramObject m_capture_program{}; ///< vertex and geometry shaders with the transform feedback
+    kvs::ProgramObject m_cached_pass_program{}; ///< geometry pass for the captured triangles
+    kvs::VertexBufferObject m_decomposition_cache{}; ///< vertices of the captured triangles
+    size_t m_ncached_vertices = 0; ///< number of the captured vertices
+
+    // Time series
+    struct TimeStep
+    {
+        size_t index = 0; ///< time step
+        kvs::ValueArray<kvs::Real32> values{}; ///< normalized values (empty if not loaded)
+        kvs::ValueArray<kvs::Real32> normals{}; ///< normal vectors
+    };
+    std::vector<std::string> m_time_series{}; ///< filenames of the time steps
+    size_t m_time_step = 0; ///< displayed time step
+    size_t m_next_time_step = 0; ///< time step to be displayed next
+    bool m_time_step_requested = false; ///< flag for requesting the next time step
+    bool m_enable_playback = false; ///< flag for the playback of the time series
+    std::future<TimeStep> m_prefetch{}; ///< time step decoded in the background
+
 public:
     Engine();
     virtual ~Engine() { this->release(); }
@@ -86,6 +162,7 @@ public:
     void update( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
     void setup( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
     void draw( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
+    bool replaceObject( kvs::ObjectBase* object );
 
     void setEdgeFactor( const float factor ) { m_edge_factor = factor; }
     void setSamplingStep( const float step ) { m_render_pass.setSamplingStep( step ); }
@@ -94,19 +171,54 @@ public:
         m_transfer_function = transfer_function;
         m_transfer_function_changed = true;
     }
+    void setTimeSeries( const std::vector<std::string>& filenames );
+    void setTimeStep( const size_t step )
+    {
+        if ( step >= m_time_series.size() ) { return; }
+        m_next_time_step = step;
+        m_time_step_requested = true;
+    }
+    void setPlaybackEnabled( const bool enabled = true ) { m_enable_playback = enabled; }
+    void setDecompositionCacheEnabled( const bool enabled = true ) { m_enable_decomposition_cache = enabled; }
+    void setDecompositionCacheMemoryBudget( const size_t bytes ) { m_decomposition_cache_budget = bytes; }
+    void setSpatialOrderingEnabled( const bool enabled = true )
+    {
+        m_spatial_ordering_changed = m_spatial_ordering_changed || ( enabled != m_enable_spatial_ordering );
+        m_enable_spatial_ordering = enabled;
+    }
 
     float samplingStep() const { return m_render_pass.samplingStep(); }
     const kvs::TransferFunction& transferFunction() const { return m_transfer_function; }
+    size_t numberOfTimeSteps() const { return m_time_series.size(); }
+    size_t timeStep() const { return m_time_step; }
+    bool isPlaybackEnabled() const { return m_enable_playback; }
+    bool isDecompositionCacheEnabled() const { return m_enable_decomposition_cache; }
+    size_t decompositionCacheMemoryBudget() const { return m_decomposition_cache_budget; }
+    bool isSpatialOrderingEnabled() const { return m_enable_spatial_ordering; }
 
 private:
     void create_transfer_function_texture();
     void update_transfer_function_texture();
+    void create_preintegration_texture();
 
     void create_decomposition_texture();
 
+    const kvs::UnstructuredVolumeObject* tetrahedral_volume( const kvs::UnstructuredVolumeObject* volume );
     void create_buffer_object( const kvs::UnstructuredVolumeObject* volume );
     void update_buffer_object( const kvs::UnstructuredVolumeObject* volume );
+    void upload_values( const kvs::ValueArray<kvs::Real32>& values, const kvs::ValueArray<kvs::Real32>& normals );
     void draw_buffer_object( const kvs::UnstructuredVolumeObject* volume );
+    void draw_visible_cells();
+    void update_visible_cells();
+
+    bool create_decomposition_cache();
+    bool is_decomposition_cache_available() const;
+    void capture_decomposition_cache();
+    void draw_decomposition_cache( const kvs::Vec2& random_offset );
+
+    void update_time_series( const kvs::UnstructuredVolumeObject* volume );
+    void prefetch_time_step( const kvs::UnstructuredVolumeObject* volume, const size_t step );
+    void wait_time_step();
 };
 
 } // end of namespace AmbientOcclusionRendering
@@ -7,6 +7,7 @@
 #include <kvs/Xorshift128>
 #include <kvs/String>
 #include <kvs/IgnoreUnusedVariable>
+#include <algorithm>
 
 
 namespace
@@ -82,6 +83,46 @@ kvs::Real32 SSAOStochasticTubeRenderer::haloSize() const
     return static_cast<const Engine&>( engine() ).haloSize();
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Sets number of partitions for the stochastic primitive subsampling.
+ *  @param  npartitions [in] number of partitions (1: disabled)
+ *
+ *  The polylines are shuffled and divided into the partitions, and only one
+ *  partition is drawn in each repetition with the opacity multiplied by the
+ *  number of partitions. The scaled opacity is clamped by min( 1, alpha * K )
+ *  for K partitions, so that the ensemble average is biased toward lower
+ *  opacity for the lines whose opacity exceeds 1/K. The subsampling is applied
+ *  only to the polylines, and the other line types are drawn as they are.
+ */
+/*===========================================================================*/
+void SSAOStochasticTubeRenderer::setNumberOfPartitions( const size_t npartitions )
+{
+    static_cast<Engine&>( engine() ).setNumberOfPartitions( npartitions );
+}
+
+size_t SSAOStochasticTubeRenderer::numberOfPartitions() const
+{
+    return static_cast<const Engine&>( engine() ).numberOfPartitions();
+}
+
+bool SSAOStochasticTubeRenderer::isOpaque( const kvs::ObjectBase* object ) const
+{
+    // Only a partition is drawn in each repetition for the polylines.
+    const auto* line = kvs::LineObject::DownCast( object );
+    if ( this->numberOfPartitions() > 1 && line && LinePartitionBuffer::IsDivisible( line ) ) { return false; }
+
+    // Opaque only if the opacity map gives 1.0 over the whole value range.
+    const auto& table = this->transferFunction().opacityMap().table();
+    if ( table.size() == 0 ) { return false; }
+    for ( const auto opacity : table )
+    {
+        if ( opacity < 1.0f ) { return false; }
+    }
+
+    return true;
+}
+
 SSAOStochasticTubeRenderer::Engine::Engine()
 {
     m_render_pass.setShaderFiles(
@@ -92,9 +133,12 @@ SSAOStochasticTubeRenderer::Engine::Engine()
 void SSAOStochasticTubeRenderer::Engine::release()
 {
     m_buffer_object.release();
+    m_partition_buffer.release();
     m_render_pass.release();
+    m_tfunc_texture.release();
 
     m_tfunc_changed = true;
+    m_size_range_object = nullptr;
 }
 
 void SSAOStochasticTubeRenderer::Engine::create(
@@ -132,10 +176,12 @@ void SSAOStochasticTubeRenderer::Engine::setup(
     kvs::Camera* camera,
     kvs::Light* light )
 {
-    kvs::IgnoreUnusedVariable( object );
     kvs::IgnoreUnusedVariable( camera );
     kvs::IgnoreUnusedVariable( light );
 
+    // Reassign the partitions if the number of partitions has been changed
+    if ( m_partitions_changed ) { this->update_buffer_object( kvs::LineObject::DownCast( object ) ); }
+
     // Setup transfer function texture
     if ( m_tfunc_changed ) { this->update_transfer_function_texture(); }
 
@@ -172,6 +218,39 @@ void SSAOStochasticTubeRenderer::Engine::create_transfer_function_texture()
     m_tfunc_texture.create( width, table.data() );
     m_tfunc_changed = false;
 
+    this->update_value_range();
+}
+
+void SSAOStochasticTubeRenderer::Engine::update_transfer_function_texture()
+{
+    // The texture is reallocated only if the resolution has been changed.
+    // Otherwise, the table is uploaded into the allocated texture.
+    const size_t width = m_tfunc.resolution();
+    if ( m_tfunc_texture.width() != width )
+    {
+        m_tfunc_texture.release();
+        this->create_transfer_function_texture();
+        return;
+    }
+
+    const auto table = m_tfunc.table();
+    kvs::Texture::Binder binder( m_tfunc_texture );
+    m_tfunc_texture.load( width, table.data() );
+    m_tfunc_changed = false;
+
+    this->update_value_range();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Updates the value range mapped to the transfer function.
+ *
+ *  If the transfer function has no range, the range of the line sizes is
+ *  used. It is computed only once for the attached object.
+ */
+/*===========================================================================*/
+void SSAOStochasticTubeRenderer::Engine::update_value_range()
+{
     kvs::Real32 min_value = 0.0f;
     kvs::Real32 max_value = 0.0f;
     if ( m_tfunc.hasRange() )
@@ -181,15 +260,16 @@ void SSAOStochasticTubeRenderer::Engine::create_transfer_function_texture()
     }
     else
     {
-        const auto* line = kvs::LineObject::DownCast( BaseClass::object() );
-        const auto& values = line->sizes();
-        min_value = values[0];
-        max_value = values[1];
-        for ( size_t i = 0; i < values.size(); i++ )
+        if ( m_size_range_object != BaseClass::object() )
         {
-            min_value = kvs::Math::Min( min_value, values[i] );
-            max_value = kvs::Math::Max( max_value, values[i] );
+            const auto* line = kvs::LineObject::DownCast( BaseClass::object() );
+            const auto& values = line->sizes();
+            const auto range = std::minmax_element( values.begin(), values.end() );
+            m_size_range = kvs::Vec2( *range.first, *range.second );
+            m_size_range_object = BaseClass::object();
         }
+        min_value = m_size_range[0];
+        max_value = m_size_range[1];
     }
 
     // Set min/max value to the geometry pass shader
@@ -199,33 +279,46 @@ void SSAOStochasticTubeRenderer::Engine::create_transfer_function_texture()
     geom_pass.setUniform( "max_value", max_value );
 }
 
-void SSAOStochasticTubeRenderer::Engine::update_transfer_function_texture()
+void SSAOStochasticTubeRenderer::Engine::create_buffer_object( const kvs::LineObject* line )
 {
-    m_tfunc_texture.release();
-    this->create_transfer_function_texture();
+    // The polylines are stored in the buffer object of each partition if they
+    // are divided for the primitive subsampling.
+    if ( m_partition_buffer.create( line, m_npartitions ) )
+    {
+        for ( size_t i = 0; i < m_partition_buffer.numberOfPartitions(); i++ )
+        {
+            this->create_line_buffer( m_partition_buffer.line( i ), m_partition_buffer.bufferObject( i ) );
+        }
+    }
+    else
+    {
+        this->create_line_buffer( line, m_buffer_object );
+    }
+    m_partitions_changed = false;
 }
 
-void SSAOStochasticTubeRenderer::Engine::create_buffer_object( const kvs::LineObject* line )
+void SSAOStochasticTubeRenderer::Engine::create_line_buffer( const kvs::LineObject* line, BufferObject& buffer_object )
 {
     auto& geom_pass = m_render_pass.shaderProgram();
 
     const auto nvertices = line->numberOfVertices() * 2;
     const auto indices= BaseClass::randomIndices( nvertices );
     const auto indices_location = geom_pass.attributeLocation( "random_index" );
-    m_buffer_object.manager().setVertexAttribArray( indices, indices_location, 2 );
+    buffer_object.manager().setVertexAttribArray( indices, indices_location, 2 );
 
     const auto values = ::QuadVertexValues( line );
     const auto values_location = geom_pass.attributeLocation( "value" );
-    m_buffer_object.manager().setVertexAttribArray( values, values_location, 1 );
+    buffer_object.manager().setVertexAttribArray( values, values_location, 1 );
 
     const auto halo_size = m_render_pass.haloSize();
     const auto radius_size = m_render_pass.radiusSize();
-    m_buffer_object.create( line, halo_size, radius_size );
+    buffer_object.create( line, halo_size, radius_size );
 }
 
 void SSAOStochasticTubeRenderer::Engine::update_buffer_object( const kvs::LineObject* line )
 {
     m_buffer_object.release();
+    m_partition_buffer.release();
     this->create_buffer_object( line );
 }
 
@@ -247,9 +340,30 @@ void SSAOStochasticTubeRenderer::Engine::draw_buffer_object( const kvs::LineObje
     geom_pass.setUniform( "random_offset", random_offset );
     geom_pass.setUniform( "random_texture_size_inv", 1.0f / size );
 
+    geom_pass.setUniform( "render_mode", static_cast<int>( BaseClass::renderMode() ) );
+
+    // Only one partition is drawn in each repetition. The primitive subsampling
+    // is applied only to the stochastic mode, and all of the partitions are
+    // drawn in the other modes.
+    const size_t npartitions = m_partition_buffer.numberOfPartitions();
+    const bool subsampling = npartitions > 1 && BaseClass::isStochasticMode();
+    const float opacity_scale = subsampling ? static_cast<float>( npartitions ) : 1.0f;
+    geom_pass.setUniform( "opacity_scale", opacity_scale );
+
     kvs::Texture::Binder unit2( BaseClass::randomTexture(), 2 );
     kvs::Texture::Binder unit3( m_tfunc_texture, 3 );
-    m_buffer_object.draw( line );
+    if ( subsampling )
+    {
+        m_partition_buffer.draw( BaseClass::repetitionCount() % npartitions );
+    }
+    else if ( m_partition_buffer.isCreated() )
+    {
+        for ( size_t i = 0; i < npartitions; i++ ) { m_partition_buffer.draw( i ); }
+    }
+    else
+    {
+        m_buffer_object.draw( line );
+    }
 }
 
 } // end of namespace AmbientOcclusionRendering
@@ -12,6 +12,8 @@
 #include <kvs/TransferFunction>
 #include <kvs/StylizedLineRenderer>
 #include "SSAOStochasticRendererBase.h"
+#include "SSAOStochasticRenderingEngine.h"
+#include "LinePartitionBuffer.h"
 
 
 namespace AmbientOcclusionRendering
@@ -41,6 +43,10 @@ public:
     const kvs::TransferFunction& transferFunction() const;
     kvs::Real32 radiusSize() const;
     kvs::Real32 haloSize() const;
+    void setNumberOfPartitions( const size_t npartitions );
+    size_t numberOfPartitions() const;
+
+    bool isOpaque( const kvs::ObjectBase* object ) const;
 };
 
 /*===========================================================================*/
@@ -48,21 +54,26 @@ public:
  *  @brief  Engine class for SSAO stochastic tube renderer.
  */
 /*===========================================================================*/
-class SSAOStochasticTubeRenderer::Engine : public kvs::StochasticRenderingEngine
+class SSAOStochasticTubeRenderer::Engine : public SSAOStochasticRenderingEngine
 {
-    using BaseClass = kvs::StochasticRenderingEngine;
+    using BaseClass = SSAOStochasticRenderingEngine;
     using BufferObject = kvs::StylizedLineRenderer::BufferObject;
     using RenderPass = kvs::StylizedLineRenderer::RenderPass;
 
 private:
     float m_edge_factor = 0.0f; ///< edge enhancement factor
+    size_t m_npartitions = 1; ///< number of partitions for primitive subsampling (1: disabled)
+    bool m_partitions_changed = false; ///< flag for changing number of partitions
 
     bool m_tfunc_changed = true; ///< flag for changing transfer function
     kvs::TransferFunction m_tfunc{}; ///< transfer function
     kvs::Texture1D m_tfunc_texture{}; ///< transfer function texture
+    kvs::Vec2 m_size_range{}; ///< min/max values of the line sizes
+    const kvs::ObjectBase* m_size_range_object = nullptr; ///< object of the cached size range
 
     BufferObject m_buffer_object{};
     RenderPass m_render_pass{ m_buffer_object };
+    LinePartitionBuffer m_partition_buffer{}; ///< buffer objects of the partitions for primitive subsampling
 
 public:
     Engine();
@@ -81,12 +92,21 @@ public:
     const kvs::TransferFunction& transferFunction() const { return m_tfunc; }
     kvs::Real32 radiusSize() const { return m_render_pass.radiusSize(); }
     kvs::Real32 haloSize() const { return m_render_pass.haloSize(); }
+    void setNumberOfPartitions( const size_t npartitions )
+    {
+        const size_t n = kvs::Math::Max( npartitions, size_t( 1 ) );
+        m_partitions_changed = m_partitions_changed || ( n != m_npartitions );
+        m_npartitions = n;
+    }
+    size_t numberOfPartitions() const { return m_npartitions; }
 
 private:
     void create_transfer_function_texture();
     void update_transfer_function_texture();
+    void update_value_range();
 
     void create_buffer_object( const kvs::LineObject* line );
+    void create_line_buffer( const kvs::LineObject* line, BufferObject& buffer_object );
     void update_buffer_object( const kvs::LineObject* line );
     void draw_buffer_object( const kvs::LineObject* line );
 };
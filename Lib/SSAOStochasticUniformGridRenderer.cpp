@@ -7,23 +7,35 @@
 #include "SSAOStochasticUniformGridRenderer.h"
 #include <cmath>
 #include <cfloat>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <chrono>
 #include <kvs/OpenGL>
 #include <kvs/StructuredVolumeObject>
+#include <kvs/StructuredVolumeImporter>
 #include <kvs/TransferFunction>
 #include <kvs/ColorMap>
 #include <kvs/OpacityMap>
 #include <kvs/ValueArray>
+#include <kvs/AnyValueArray>
+#include <kvs/Value>
 #include <kvs/Camera>
 #include <kvs/Light>
 #include <kvs/Coordinate>
 #include <kvs/Assert>
 #include <kvs/Message>
 #include <kvs/Xorshift128>
+#include <kvs/Math>
+#include "Parallel.h"
 
 
 namespace
 {
 
+using AmbientOcclusionRendering::NumberOfThreads;
+using AmbientOcclusionRendering::ParallelRanges;
+
 /*===========================================================================*/
 /**
  *  @brief  Returns a random number as integer value.
@@ -37,214 +49,1687 @@ inline int RandomNumber()
     return C * R.randInteger();
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Returns the size of the internal render targets.
+ *  @param  camera [in] pointer to the camera
+ *  @param  scale [in] render scale
+ *  @return framebuffer size (width and height)
+ */
+/*===========================================================================*/
+inline kvs::Vec2ui FramebufferSize( const kvs::Camera* camera, const float scale )
+{
+    const float dpr = camera->devicePixelRatio();
+    const size_t width = static_cast<size_t>( camera->windowWidth() * dpr );
+    const size_t height = static_cast<size_t>( camera->windowHeight() * dpr );
+    const size_t scaled_width = static_cast<size_t>( static_cast<float>( width ) * scale + 0.5f );
+    const size_t scaled_height = static_cast<size_t>( static_cast<float>( height ) * scale + 0.5f );
+    return kvs::Vec2ui(
+        static_cast<unsigned int>( kvs::Math::Max( scaled_width, size_t( 1 ) ) ),
+        static_cast<unsigned int>( kvs::Math::Max( scaled_height, size_t( 1 ) ) ) );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the pre-integrated transfer function table.
+ *  @param  tfunc [in] transfer function
+ *  @param  step [in] length of the ray segment in voxels
+ *  @return RGBA table indexed by the scalar values at the front and the back
+ *          of the ray segment (resolution x resolution)
+ *
+ *  The opacity of the transfer function is regarded as that of the ray segment
+ *  with the reference step (0.5 voxel, the default sampling step), and the
+ *  table is integrated without the self-attenuation within the segment by
+ *  using the cumulative integrals of the extinction and the color.
+ */
+/*===========================================================================*/
+inline kvs::ValueArray<kvs::Real32> PreIntegrationTable(
+    const kvs::TransferFunction& tfunc,
+    const float step )
+{
+    const float reference_step = 0.5f;
+    const size_t resolution = tfunc.resolution();
+    const auto table = tfunc.table();
+
+    // Extinction coefficients per voxel and their cumulative integrals.
+    std::vector<double> tau( resolution );
+    for ( size_t i = 0; i < resolution; i++ )
+    {
+        const double alpha = kvs::Math::Min( table[ 4 * i + 3 ], 0.9999f );
+        tau[i] = -std::log( 1.0 - alpha ) / reference_step;
+    }
+
+    std::vector<double> T( resolution, 0.0 ); // integral of the extinction
+    std::vector<kvs::Vector3<double>> K( resolution, kvs::Vector3<double>::Zero() ); // integral of the extinction-weighted color
+    for ( size_t i = 1; i < resolution; i++ )
+    {
+        const kvs::Vector3<double> c0( table[ 4 * ( i - 1 ) ], table[ 4 * ( i - 1 ) + 1 ], table[ 4 * ( i - 1 ) + 2 ] );
+        const kvs::Vector3<double> c1( table[ 4 * i ], table[ 4 * i + 1 ], table[ 4 * i + 2 ] );
+        T[i] = T[ i - 1 ] + 0.5 * ( tau[ i - 1 ] + tau[i] );
+        K[i] = K[ i - 1 ] + 0.5 * ( tau[ i - 1 ] * c0 + tau[i] * c1 );
+    }
+
+    kvs::ValueArray<kvs::Real32> preintegration( resolution * resolution * 4 );
+    for ( size_t b = 0; b < resolution; b++ )
+    {
+        for ( size_t f = 0; f < resolution; f++ )
+        {
+            const size_t i0 = kvs::Math::Min( f, b );
+            const size_t i1 = kvs::Math::Max( f, b );
+
+            double extinction = tau[ i0 ];
+            kvs::Vector3<double> color( table[ 4 * i0 ], table[ 4 * i0 + 1 ], table[ 4 * i0 + 2 ] );
+            if ( i0 != i1 )
+            {
+                const double dT = T[ i1 ] - T[ i0 ];
+                extinction = dT / static_cast<double>( i1 - i0 );
+                if ( dT > 0.0 ) { color = ( K[ i1 ] - K[ i0 ] ) / dT; }
+            }
+
+            kvs::Real32* texel = preintegration.data() + 4 * ( b * resolution + f );
+            texel[0] = static_cast<kvs::Real32>( color.x() );
+            texel[1] = static_cast<kvs::Real32>( color.y() );
+            texel[2] = static_cast<kvs::Real32>( color.z() );
+            texel[3] = static_cast<kvs::Real32>( 1.0 - std::exp( -extinction * step ) );
+        }
+    }
+
+    return preintegration;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the min/max scalar values of the macro cells.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @param  cell_size [in] size of the macro cell in voxels
+ *  @param  grid [in] number of the macro cells
+ *  @param  scale [in] scale from the data value to the scalar value in the shader
+ *  @param  offset [in] offset from the data value to the scalar value in the shader
+ *  @return min/max values (two values for each macro cell)
+ *
+ *  The adjacent macro cells share the voxels on their boundary, so that the
+ *  trilinearly interpolated values in a macro cell are within its range.
+ */
+/*===========================================================================*/
+template <typename T>
+inline kvs::ValueArray<kvs::Real32> MacroCellRanges(
+    const kvs::StructuredVolumeObject* volume,
+    const size_t cell_size,
+    const kvs::Vec3ui& grid,
+    const float scale,
+    const float offset )
+{
+    const T* values = static_cast<const T*>( volume->values().data() );
+    const kvs::Vec3ui r = volume->resolution();
+    const size_t ncells = size_t( grid.x() ) * grid.y() * grid.z();
+    kvs::ValueArray<kvs::Real32> ranges( ncells * 2 );
+
+    size_t index = 0;
+    for ( size_t k = 0; k < grid.z(); k++ )
+    {
+        const size_t z0 = k * cell_size;
+        const size_t z1 = kvs::Math::Min( z0 + cell_size, size_t( r.z() - 1 ) );
+        for ( size_t j = 0; j < grid.y(); j++ )
+        {
+            const size_t y0 = j * cell_size;
+            const size_t y1 = kvs::Math::Min( y0 + cell_size, size_t( r.y() - 1 ) );
+            for ( size_t i = 0; i < grid.x(); i++, index++ )
+            {
+                const size_t x0 = i * cell_size;
+                const size_t x1 = kvs::Math::Min( x0 + cell_size, size_t( r.x() - 1 ) );
+
+                float min_value = FLT_MAX;
+                float max_value = -FLT_MAX;
+                for ( size_t z = z0; z <= z1; z++ )
+                {
+                    for ( size_t y = y0; y <= y1; y++ )
+                    {
+                        const T* v = values + r.x() * ( y + r.y() * z );
+                        for ( size_t x = x0; x <= x1; x++ )
+                        {
+                            const float value = static_cast<float>( v[x] ) * scale + offset;
+                            min_value = kvs::Math::Min( min_value, value );
+                            max_value = kvs::Math::Max( max_value, value );
+                        }
+                    }
+                }
+
+                ranges[ 2 * index + 0 ] = min_value;
+                ranges[ 2 * index + 1 ] = max_value;
+            }
+        }
+    }
+
+    return ranges;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the min/max scalar values of the cells for any data type.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @param  size [in] size of the cell in voxels
+ *  @param  grid [out] number of the cells
+ *  @return min/max values (two values for each cell)
+ */
+/*===========================================================================*/
+inline kvs::ValueArray<kvs::Real32> CellRanges(
+    const kvs::StructuredVolumeObject* volume,
+    const size_t size,
+    kvs::Vec3ui& grid )
+{
+    const kvs::Vec3ui r = volume->resolution();
+    grid = kvs::Vec3ui(
+        static_cast<unsigned int>( ( r.x() - 1 ) / size + 1 ),
+        static_cast<unsigned int>( ( r.y() - 1 ) / size + 1 ),
+        static_cast<unsigned int>( ( r.z() - 1 ) / size + 1 ) );
+
+    // The scalar values are computed in the same way as the shader. The
+    // values of the floating point types are normalized to [0,1].
+    const float min_value = static_cast<float>( volume->minValue() );
+    const float max_value = static_cast<float>( volume->maxValue() );
+    const float scale = max_value > min_value ? 1.0f / ( max_value - min_value ) : 1.0f;
+    const float offset = -min_value * scale;
+
+    kvs::ValueArray<kvs::Real32> ranges;
+    const std::type_info& type = volume->values().typeInfo()->type();
+    if ( volume->veclen() != 1 )
+    {
+        ranges.release();
+    }
+    else if ( type == typeid( kvs::UInt8 ) )
+    {
+        ranges = ::MacroCellRanges<kvs::UInt8>( volume, size, grid, 1.0f, 0.0f );
+    }
+    else if ( type == typeid( kvs::UInt16 ) )
+    {
+        ranges = ::MacroCellRanges<kvs::UInt16>( volume, size, grid, 1.0f, 0.0f );
+    }
+    else if ( type == typeid( kvs::Int16 ) )
+    {
+        ranges = ::MacroCellRanges<kvs::Int16>( volume, size, grid, 1.0f, 0.0f );
+    }
+    else if ( type == typeid( kvs::UInt32 ) )
+    {
+        ranges = ::MacroCellRanges<kvs::UInt32>( volume, size, grid, scale, offset );
+    }
+    else if ( type == typeid( kvs::Int32 ) )
+    {
+        ranges = ::MacroCellRanges<kvs::Int32>( volume, size, grid, scale, offset );
+    }
+    else if ( type == typeid( kvs::Real32 ) )
+    {
+        ranges = ::MacroCellRanges<kvs::Real32>( volume, size, grid, scale, offset );
+    }
+    else if ( type == typeid( kvs::Real64 ) )
+    {
+        ranges = ::MacroCellRanges<kvs::Real64>( volume, size, grid, scale, offset );
+    }
+    else
+    {
+        ranges.release();
+    }
+
+    // All of the cells are regarded as occupied for the unsupported data.
+    if ( ranges.size() == 0 )
+    {
+        const size_t ncells = size_t( grid.x() ) * grid.y() * grid.z();
+        ranges.allocate( ncells * 2 );
+        for ( size_t i = 0; i < ncells; i++ )
+        {
+            ranges[ 2 * i + 0 ] = -FLT_MAX;
+            ranges[ 2 * i + 1 ] = FLT_MAX;
+        }
+    }
+
+    return ranges;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the occupancy of the cells for the transfer function.
+ *  @param  ranges [in] min/max scalar values of the cells
+ *  @param  transfer_function [in] transfer function
+ *  @param  value_range [in] scalar range mapped to the transfer function
+ *  @return occupancy (255 if the cell is occupied, 0 otherwise)
+ */
+/*===========================================================================*/
+inline kvs::ValueArray<kvs::UInt8> CellOccupancy(
+    const kvs::ValueArray<kvs::Real32>& ranges,
+    const kvs::TransferFunction& transfer_function,
+    const kvs::Vec2& value_range )
+{
+    // Number of the table entries with non-zero opacity in [0,i).
+    const size_t resolution = transfer_function.resolution();
+    const auto table = transfer_function.table();
+    std::vector<size_t> counts( resolution + 1, 0 );
+    for ( size_t i = 0; i < resolution; i++ )
+    {
+        counts[ i + 1 ] = counts[i] + ( table[ 4 * i + 3 ] > 0.0f ? 1 : 0 );
+    }
+
+    // A cell is occupied if any table entry used for the interpolation
+    // of its range has non-zero opacity.
+    const double min_value = value_range[0];
+    const double range = value_range[1] - value_range[0];
+    const double scale = range > 0.0 ? 1.0 / range : 1.0;
+    const double last = static_cast<double>( resolution - 1 );
+    const size_t ncells = ranges.size() / 2;
+    kvs::ValueArray<kvs::UInt8> occupancy( ncells );
+    for ( size_t i = 0; i < ncells; i++ )
+    {
+        const double index0 = ( ranges[ 2 * i + 0 ] - min_value ) * scale * resolution - 0.5;
+        const double index1 = ( ranges[ 2 * i + 1 ] - min_value ) * scale * resolution - 0.5;
+        const auto i0 = static_cast<size_t>( kvs::Math::Clamp( std::floor( index0 ), 0.0, last ) );
+        const auto i1 = static_cast<size_t>( kvs::Math::Clamp( std::ceil( index1 ), 0.0, last ) );
+        occupancy[i] = counts[ i1 + 1 ] > counts[ i0 ] ? 255 : 0;
+    }
+
+    return occupancy;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Draws the back faces of the bounding box of the volume.
+ *  @param  min_coord [in] min. coordinate of the bounding box
+ *  @param  max_coord [in] max. coordinate of the bounding box
+ *
+ *  This is used instead of the volume buffer object for the bricked volume,
+ *  since the volume buffer object holds the dense volume texture.
+ */
+/*===========================================================================*/
+inline void DrawBoundingBox( const kvs::Vec3& min_coord, const kvs::Vec3& max_coord )
+{
+    const float x0 = min_coord.x();
+    const float y0 = min_coord.y();
+    const float z0 = min_coord.z();
+    const float x = max_coord.x();
+    const float y = max_coord.y();
+    const float z = max_coord.z();
+
+    kvs::OpenGL::WithPushedAttrib attrib( GL_ENABLE_BIT | GL_POLYGON_BIT );
+    kvs::OpenGL::Enable( GL_CULL_FACE );
+    kvs::OpenGL::SetCullFace( GL_FRONT );
+    kvs::OpenGL::Begin( GL_QUADS );
+    // -X, +X
+    kvs::OpenGL::Vertex( kvs::Vec3( x0, y0, z0 ) ); kvs::OpenGL::Vertex( kvs::Vec3( x0, y0, z ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x0, y, z ) ); kvs::OpenGL::Vertex( kvs::Vec3( x0, y, z0 ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x, y0, z0 ) ); kvs::OpenGL::Vertex( kvs::Vec3( x, y, z0 ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x, y, z ) ); kvs::OpenGL::Vertex( kvs::Vec3( x, y0, z ) );
+    // -Y, +Y
+    kvs::OpenGL::Vertex( kvs::Vec3( x0, y0, z0 ) ); kvs::OpenGL::Vertex( kvs::Vec3( x, y0, z0 ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x, y0, z ) ); kvs::OpenGL::Vertex( kvs::Vec3( x0, y0, z ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x0, y, z0 ) ); kvs::OpenGL::Vertex( kvs::Vec3( x0, y, z ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x, y, z ) ); kvs::OpenGL::Vertex( kvs::Vec3( x, y, z0 ) );
+    // -Z, +Z
+    kvs::OpenGL::Vertex( kvs::Vec3( x0, y0, z0 ) ); kvs::OpenGL::Vertex( kvs::Vec3( x0, y, z0 ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x, y, z0 ) ); kvs::OpenGL::Vertex( kvs::Vec3( x, y0, z0 ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x0, y0, z ) ); kvs::OpenGL::Vertex( kvs::Vec3( x, y0, z ) );
+    kvs::OpenGL::Vertex( kvs::Vec3( x, y, z ) ); kvs::OpenGL::Vertex( kvs::Vec3( x0, y, z ) );
+    kvs::OpenGL::End();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the inverse coordinate table of an axis of the rectilinear grid.
+ *  @param  coords [in] ascending coordinates of the grid points along the axis
+ *  @param  n [in] number of the grid points along the axis
+ *  @param  size [in] number of the table entries
+ *  @return fractional grid index at the evenly spaced coordinates
+ *
+ *  The entry j gives the grid index at the coordinate c0 + (cn-1 - c0) j/(size-1),
+ *  so that the linear interpolation of the table approximates the piecewise
+ *  linear inverse of the coordinates.
+ */
+/*===========================================================================*/
+inline kvs::ValueArray<kvs::Real32> CoordInverseTable(
+    const kvs::Real32* coords,
+    const size_t n,
+    const size_t size )
+{
+    kvs::ValueArray<kvs::Real32> table( size );
+    if ( n < 2 ) { table.fill( 0.0f ); return table; }
+
+    const float c0 = coords[0];
+    const float c1 = coords[ n - 1 ];
+    size_t i = 0;
+    for ( size_t j = 0; j < size; j++ )
+    {
+        const float x = c0 + ( c1 - c0 ) * static_cast<float>( j ) / static_cast<float>( size - 1 );
+        while ( i < n - 2 && coords[ i + 1 ] <= x ) { i++; }
+        const float w = coords[ i + 1 ] - coords[i];
+        const float t = w > 0.0f ? kvs::Math::Clamp( ( x - coords[i] ) / w, 0.0f, 1.0f ) : 0.0f;
+        table[j] = static_cast<float>( i ) + t;
+    }
+
+    return table;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Computes the packed gradient vectors for the slices of the volume.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @param  z_begin [in] first slice
+ *  @param  z_end [in] last slice (not included)
+ *  @param  gradients [out] packed gradient vectors (RGBA for each voxel)
+ *
+ *  The gradient is computed by the central differences with the same
+ *  orientation as VolumeGradient() in the shader, and then the normalized
+ *  vector is packed from [-1,1] to [0,255].
+ */
+/*===========================================================================*/
+template <typename T>
+inline void GradientSlices(
+    const kvs::StructuredVolumeObject* volume,
+    const size_t z_begin,
+    const size_t z_end,
+    kvs::UInt8* gradients )
+{
+    const T* values = static_cast<const T*>( volume->values().data() );
+    const kvs::Vec3ui r = volume->resolution();
+    const size_t line_size = r.x();
+    const size_t slice_size = size_t( r.x() ) * r.y();
+
+    for ( size_t z = z_begin; z < z_end; z++ )
+    {
+        const size_t dz0 = z > 0 ? slice_size : 0;
+        const size_t dz1 = z < r.z() - 1 ? slice_size : 0;
+        for ( size_t y = 0; y < r.y(); y++ )
+        {
+            const size_t dy0 = y > 0 ? line_size : 0;
+            const size_t dy1 = y < r.y() - 1 ? line_size : 0;
+            for ( size_t x = 0; x < r.x(); x++ )
+            {
+                const size_t dx0 = x > 0 ? 1 : 0;
+                const size_t dx1 = x < r.x() - 1 ? 1 : 0;
+                const size_t index = x + line_size * y + slice_size * z;
+                kvs::Vec3 g(
+                    static_cast<float>( values[ index - dx0 ] ) - static_cast<float>( values[ index + dx1 ] ),
+                    static_cast<float>( values[ index - dy0 ] ) - static_cast<float>( values[ index + dy1 ] ),
+                    static_cast<float>( values[ index - dz0 ] ) - static_cast<float>( values[ index + dz1 ] ) );
+
+                const float length = g.length();
+                if ( length > 0.0f ) { g /= length; }
+
+                kvs::UInt8* p = gradients + 4 * index;
+                p[0] = static_cast<kvs::UInt8>( ( g.x() * 0.5f + 0.5f ) * 255.0f + 0.5f );
+                p[1] = static_cast<kvs::UInt8>( ( g.y() * 0.5f + 0.5f ) * 255.0f + 0.5f );
+                p[2] = static_cast<kvs::UInt8>( ( g.z() * 0.5f + 0.5f ) * 255.0f + 0.5f );
+                p[3] = 255;
+            }
+        }
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the packed gradient vectors of the volume.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @return packed gradient vectors (RGBA for each voxel)
+ *
+ *  The slices of the volume are divided into the hardware threads.
+ */
+/*===========================================================================*/
+template <typename T>
+inline kvs::ValueArray<kvs::UInt8> GradientVolume( const kvs::StructuredVolumeObject* volume )
+{
+    kvs::ValueArray<kvs::UInt8> gradients( 4 * volume->numberOfNodes() );
+
+    const size_t nslices = volume->resolution().z();
+    ParallelRanges( nslices, [&] ( size_t, size_t begin, size_t end )
+    {
+        GradientSlices<T>( volume, begin, end, gradients.data() );
+    } );
+
+    return gradients;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the quantized values of the floating point volume.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @param  equalized [in] true if the values are histogram-equalized
+ *  @param  table [out] dequantization table (only for the equalized values)
+ *  @return quantized values
+ *
+ *  The values are normalized with the min/max values of the volume in the
+ *  same way as the float texture. The linear codes are dequantized by the
+ *  texture normalization itself. The equalized codes are distributed with
+ *  the cumulative histogram, and the table maps the code, sampled at the
+ *  table size, back to the normalized value.
+ */
+/*===========================================================================*/
+template <typename T, typename Q>
+inline kvs::ValueArray<Q> QuantizedValues(
+    const kvs::StructuredVolumeObject* volume,
+    const bool equalized,
+    kvs::ValueArray<kvs::Real32>& table )
+{
+    const T* values = static_cast<const T*>( volume->values().data() );
+    const size_t nvalues = volume->numberOfNodes();
+    const float levels = static_cast<float>( kvs::Value<Q>::Max() );
+    const float min_value = static_cast<float>( volume->minValue() );
+    const float max_value = static_cast<float>( volume->maxValue() );
+    const float scale = max_value > min_value ? 1.0f / ( max_value - min_value ) : 1.0f;
+
+    kvs::ValueArray<Q> quantized( nvalues );
+    table.release();
+    if ( !equalized )
+    {
+        ParallelRanges( nvalues, [&] ( size_t, size_t begin, size_t end )
+        {
+            for ( size_t i = begin; i < end; i++ )
+            {
+                const float v = kvs::Math::Clamp( ( static_cast<float>( values[i] ) - min_value ) * scale, 0.0f, 1.0f );
+                quantized[i] = static_cast<Q>( v * levels + 0.5f );
+            }
+        } );
+        return quantized;
+    }
+
+    // Histogram of the normalized values with the partial histogram for each
+    // thread.
+    const size_t nbins = kvs::Math::Min( size_t( levels + 1.0f ) * 16, size_t( 65536 ) );
+    const size_t nthreads = NumberOfThreads();
+    std::vector<std::vector<size_t>> partials( nthreads, std::vector<size_t>( nbins, 0 ) );
+    auto bin_of = [&] ( const T value )
+    {
+        const float v = kvs::Math::Clamp( ( static_cast<float>( value ) - min_value ) * scale, 0.0f, 1.0f );
+        return kvs::Math::Min( static_cast<size_t>( v * nbins ), nbins - 1 );
+    };
+    ParallelRanges( nvalues, [&] ( size_t thread, size_t begin, size_t end )
+    {
+        auto& histogram = partials[ thread ];
+        for ( size_t i = begin; i < end; i++ ) { histogram[ bin_of( values[i] ) ]++; }
+    } );
+
+    // Cumulative distribution at the bin centers, which gives the code of
+    // the values in each bin.
+    std::vector<float> cdf( nbins, 0.0f );
+    std::vector<Q> codes( nbins, 0 );
+    size_t sum = 0;
+    for ( size_t b = 0; b < nbins; b++ )
+    {
+        size_t count = 0;
+        for ( const auto& histogram : partials ) { count += histogram[b]; }
+        cdf[b] = ( static_cast<float>( sum ) + 0.5f * static_cast<float>( count ) ) / static_cast<float>( nvalues );
+        codes[b] = static_cast<Q>( cdf[b] * levels + 0.5f );
+        sum += count;
+    }
+
+    ParallelRanges( nvalues, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ ) { quantized[i] = codes[ bin_of( values[i] ) ]; }
+    } );
+
+    // Dequantization table given by the inverse of the piecewise linear
+    // cumulative distribution through (0,0), the bin centers and (1,1).
+    const size_t table_size = kvs::Math::Min( size_t( levels + 1.0f ), size_t( 4096 ) );
+    table.allocate( table_size );
+    size_t b = 0;
+    for ( size_t j = 0; j < table_size; j++ )
+    {
+        const float t = static_cast<float>( j ) / static_cast<float>( table_size - 1 );
+        while ( b < nbins && cdf[b] < t ) { b++; }
+
+        const float x0 = b > 0 ? ( b - 0.5f ) / nbins : 0.0f;
+        const float y0 = b > 0 ? cdf[ b - 1 ] : 0.0f;
+        const float x1 = b < nbins ? ( b + 0.5f ) / nbins : 1.0f;
+        const float y1 = b < nbins ? cdf[b] : 1.0f;
+        table[j] = y1 > y0 ? x0 + ( x1 - x0 ) * ( t - y0 ) / ( y1 - y0 ) : x1;
+    }
+
+    return quantized;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the packed vectors of the vector volume.
+ *  @param  volume [in] pointer to the structured volume object (veclen = 3)
+ *  @param  scale [out] maximum absolute component
+ *  @param  ranges [out] ranges of the magnitude and the x, y and z components
+ *  @return packed vectors (RGBA for each voxel)
+ *
+ *  The components are normalized by the maximum absolute component and
+ *  packed from [-1,1] to [0,65535]. The ranges of the derived scalar values
+ *  are computed in the same pass.
+ */
+/*===========================================================================*/
+template <typename T>
+inline kvs::ValueArray<kvs::UInt16> VectorTexels(
+    const kvs::StructuredVolumeObject* volume,
+    float& scale,
+    kvs::Vec2 ranges[4] )
+{
+    const T* values = static_cast<const T*>( volume->values().data() );
+    const size_t nnodes = volume->numberOfNodes();
+
+    // Ranges of the magnitude and the components for each thread.
+    const size_t nthreads = NumberOfThreads();
+    std::vector<std::vector<kvs::Vec2>> partials( nthreads, std::vector<kvs::Vec2>( 4, kvs::Vec2( FLT_MAX, -FLT_MAX ) ) );
+    ParallelRanges( nnodes, [&] ( size_t thread, size_t begin, size_t end )
+    {
+        auto& r = partials[ thread ];
+        for ( size_t i = begin; i < end; i++ )
+        {
+            const kvs::Vec3 v(
+                static_cast<float>( values[ 3 * i + 0 ] ),
+                static_cast<float>( values[ 3 * i + 1 ] ),
+                static_cast<float>( values[ 3 * i + 2 ] ) );
+            const float s[4] = { v.length(), v.x(), v.y(), v.z() };
+            for ( size_t j = 0; j < 4; j++ )
+            {
+                r[j].x() = kvs::Math::Min( r[j].x(), s[j] );
+                r[j].y() = kvs::Math::Max( r[j].y(), s[j] );
+            }
+        }
+    } );
+
+    for ( size_t j = 0; j < 4; j++ )
+    {
+        ranges[j] = kvs::Vec2( FLT_MAX, -FLT_MAX );
+        for ( const auto& r : partials )
+        {
+            ranges[j].x() = kvs::Math::Min( ranges[j].x(), r[j].x() );
+            ranges[j].y() = kvs::Math::Max( ranges[j].y(), r[j].y() );
+        }
+    }
+
+    scale = 0.0f;
+    for ( size_t j = 1; j < 4; j++ )
+    {
+        scale = kvs::Math::Max( scale, kvs::Math::Abs( ranges[j].x() ), kvs::Math::Abs( ranges[j].y() ) );
+    }
+    if ( scale == 0.0f ) { scale = 1.0f; }
+
+    kvs::ValueArray<kvs::UInt16> texels( 4 * nnodes );
+    ParallelRanges( nnodes, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            for ( size_t j = 0; j < 3; j++ )
+            {
+                const float v = static_cast<float>( values[ 3 * i + j ] ) / scale;
+                texels[ 4 * i + j ] = static_cast<kvs::UInt16>( ( v * 0.5f + 0.5f ) * 65535.0f + 0.5f );
+            }
+            texels[ 4 * i + 3 ] = 65535;
+        }
+    } );
+
+    return texels;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the normalized values packed to 16 bits.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @param  scale [in] scale from the data value to the normalized value
+ *  @param  offset [in] offset from the data value to the normalized value
+ *  @return normalized values
+ */
+/*===========================================================================*/
+template <typename T>
+inline kvs::ValueArray<kvs::UInt16> NormalizedTexels(
+    const kvs::StructuredVolumeObject* volume,
+    const float scale,
+    const float offset )
+{
+    const T* values = static_cast<const T*>( volume->values().data() );
+    const size_t nnodes = volume->numberOfNodes();
+    kvs::ValueArray<kvs::UInt16> texels( nnodes );
+    ParallelRanges( nnodes, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            const float v = kvs::Math::Clamp( static_cast<float>( values[i] ) * scale + offset, 0.0f, 1.0f );
+            texels[i] = static_cast<kvs::UInt16>( v * 65535.0f + 0.5f );
+        }
+    } );
+
+    return texels;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the normalized values of the scalar volume for any data type.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @return normalized values (empty if the data type is not supported)
+ *
+ *  The values are normalized in the same way as the dense volume texture, so
+ *  that the same volume parameter is used in the shader. The values of the
+ *  32-bit and floating point types are normalized by the min/max values of
+ *  the volume.
+ */
+/*===========================================================================*/
+inline kvs::ValueArray<kvs::UInt16> NormalizedTexels( const kvs::StructuredVolumeObject* volume )
+{
+    const float min_value = static_cast<float>( volume->minValue() );
+    const float max_value = static_cast<float>( volume->maxValue() );
+    const float scale = max_value > min_value ? 1.0f / ( max_value - min_value ) : 1.0f;
+    const float offset = -min_value * scale;
+
+    const std::type_info& type = volume->values().typeInfo()->type();
+    if ( type == typeid( kvs::UInt8 ) ) { return ::NormalizedTexels<kvs::UInt8>( volume, 1.0f / 255.0f, 0.0f ); }
+    if ( type == typeid( kvs::UInt16 ) ) { return ::NormalizedTexels<kvs::UInt16>( volume, 1.0f / 65535.0f, 0.0f ); }
+    if ( type == typeid( kvs::Int16 ) ) { return ::NormalizedTexels<kvs::Int16>( volume, 1.0f / 65535.0f, 32768.0f / 65535.0f ); }
+    if ( type == typeid( kvs::UInt32 ) ) { return ::NormalizedTexels<kvs::UInt32>( volume, scale, offset ); }
+    if ( type == typeid( kvs::Int32 ) ) { return ::NormalizedTexels<kvs::Int32>( volume, scale, offset ); }
+    if ( type == typeid( kvs::Real32 ) ) { return ::NormalizedTexels<kvs::Real32>( volume, scale, offset ); }
+    if ( type == typeid( kvs::Real64 ) ) { return ::NormalizedTexels<kvs::Real64>( volume, scale, offset ); }
+    return kvs::ValueArray<kvs::UInt16>();
+}
+
 } // end of namespace
 
 
-namespace AmbientOcclusionRendering
-{
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Constructs a new StochasticUniformGridRenderer class.
+ */
+/*===========================================================================*/
+SSAOStochasticUniformGridRenderer::SSAOStochasticUniformGridRenderer():
+    SSAOStochasticRendererBase( new Engine() )
+{
+}
+
+void SSAOStochasticUniformGridRenderer::setEdgeFactor( const float factor )
+{
+    static_cast<Engine&>( engine() ).setEdgeFactor( factor );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets a sampling step.
+ *  @param  transfer_function [in] transfer function
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setSamplingStep( const float step )
+{
+    static_cast<Engine&>( engine() ).setSamplingStep( step );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets a transfer function.
+ *  @param  transfer_function [in] transfer function
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setTransferFunction(
+    const kvs::TransferFunction& transfer_function )
+{
+    static_cast<Engine&>( engine() ).setTransferFunction( transfer_function );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the pre-integrated transfer function.
+ *  @param  enabled [in] true if the pre-integrated transfer function is used
+ *
+ *  The color and the opacity of each ray segment between the adjacent samples
+ *  are looked up from the 2D table indexed by the scalar values at the both
+ *  ends, so that thin features are captured with larger sampling steps.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setPreIntegrationEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setPreIntegrationEnabled( enabled );
+}
+
+bool SSAOStochasticUniformGridRenderer::isPreIntegrationEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isPreIntegrationEnabled();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the empty space skipping.
+ *  @param  enabled [in] true if the empty space is skipped
+ *
+ *  The volume is divided into the macro cells with their min/max values, and
+ *  the rays jump over the macro cells mapped to zero opacity by the transfer
+ *  function. Only the occupancy of the macro cells is updated when the
+ *  transfer function is changed.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setEmptySpaceSkippingEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setEmptySpaceSkippingEnabled( enabled );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the size of the macro cell for the empty space skipping.
+ *  @param  size [in] size of the macro cell in voxels
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setMacroCellSize( const size_t size )
+{
+    static_cast<Engine&>( engine() ).setMacroCellSize( size );
+}
+
+bool SSAOStochasticUniformGridRenderer::isEmptySpaceSkippingEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isEmptySpaceSkippingEnabled();
+}
+
+size_t SSAOStochasticUniformGridRenderer::macroCellSize() const
+{
+    return static_cast<const Engine&>( engine() ).macroCellSize();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the analytic entry/exit points.
+ *  @param  enabled [in] true if the entry/exit points are computed analytically
+ *
+ *  The entry/exit points are computed by the ray-box intersection in the
+ *  fragment shader instead of drawing the bounding cube to the entry/exit
+ *  framebuffer, so that the two screen-sized float textures and the bounding
+ *  cube pass are not needed.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setAnalyticEntryExitEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setAnalyticEntryExitEnabled( enabled );
+}
+
+bool SSAOStochasticUniformGridRenderer::isAnalyticEntryExitEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isAnalyticEntryExitEnabled();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the precomputed gradient volume.
+ *  @param  enabled [in] true if the gradient is precomputed
+ *
+ *  The gradient is computed on the CPU when the volume is uploaded and stored
+ *  in an RGBA8 texture, so that the normal vector is looked up by one texture
+ *  fetch instead of six. The memory for the texture is four bytes per voxel.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setGradientVolumeEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setGradientVolumeEnabled( enabled );
+}
+
+bool SSAOStochasticUniformGridRenderer::isGradientVolumeEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isGradientVolumeEnabled();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the bricked volume.
+ *  @param  enabled [in] true if the volume is bricked
+ *
+ *  The volume is uploaded as the bricks in a texture atlas limited by the
+ *  memory budget instead of a dense texture. The empty bricks are never
+ *  uploaded, and the visible bricks are streamed in on demand. This setting
+ *  is applied when the volume is uploaded.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setBrickingEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setBrickingEnabled( enabled );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the brick size.
+ *  @param  size [in] brick size in voxels
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setBrickSize( const size_t size )
+{
+    static_cast<Engine&>( engine() ).setBrickSize( size );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the memory budget of the brick atlas.
+ *  @param  bytes [in] memory budget in bytes
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setBrickMemoryBudget( const size_t bytes )
+{
+    static_cast<Engine&>( engine() ).setBrickMemoryBudget( bytes );
+}
+
+bool SSAOStochasticUniformGridRenderer::isBrickingEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isBrickingEnabled();
+}
+
+size_t SSAOStochasticUniformGridRenderer::brickSize() const
+{
+    return static_cast<const Engine&>( engine() ).brickSize();
+}
+
+size_t SSAOStochasticUniformGridRenderer::brickMemoryBudget() const
+{
+    return static_cast<const Engine&>( engine() ).brickMemoryBudget();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the multiresolution volume.
+ *  @param  enabled [in] true if the coarse level is drawn while moving
+ *
+ *  The coarse levels of the volume are downsampled on the CPU and uploaded as
+ *  additional textures. While the camera, the object or the light is moving
+ *  (detected by the LOD control or the frame-time governor), the coarse level
+ *  is sampled with a longer step instead of the full resolution volume, and
+ *  the full resolution is restored when the scene stops.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setMultiresolutionEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setMultiresolutionEnabled( enabled );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the level drawn while the scene is moving.
+ *  @param  level [in] coarse level (the resolution is divided by 2^level)
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setCoarseLevel( const size_t level )
+{
+    static_cast<Engine&>( engine() ).setCoarseLevel( level );
+}
+
+bool SSAOStochasticUniformGridRenderer::isMultiresolutionEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isMultiresolutionEnabled();
+}
+
+size_t SSAOStochasticUniformGridRenderer::coarseLevel() const
+{
+    return static_cast<const Engine&>( engine() ).coarseLevel();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the bits of the quantized float volume.
+ *  @param  bits [in] 8 or 16 bits (0 if the volume is not quantized)
+ *
+ *  The Real32/Real64 volume is quantized on the CPU in parallel and uploaded
+ *  as an 8-bit or 16-bit texture instead of the float texture, which reduces
+ *  the texture memory and the bandwidth by 2-4x. This setting is applied when
+ *  the volume is uploaded.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setQuantizationBits( const size_t bits )
+{
+    static_cast<Engine&>( engine() ).setQuantizationBits( bits );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the histogram-equalized quantization.
+ *  @param  enabled [in] true if the codes are histogram-equalized
+ *
+ *  The codes are distributed with the cumulative histogram of the values
+ *  instead of linearly, so that more codes are given to the frequent values.
+ *  The codes are mapped back to the values with a table in the shader.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setHistogramEqualizationEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setHistogramEqualizationEnabled( enabled );
+}
+
+size_t SSAOStochasticUniformGridRenderer::quantizationBits() const
+{
+    return static_cast<const Engine&>( engine() ).quantizationBits();
+}
+
+bool SSAOStochasticUniformGridRenderer::isHistogramEqualizationEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isHistogramEqualizationEnabled();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the clipping of the rays at the geometry depth.
+ *  @param  enabled [in] true if the rays are clipped
+ *
+ *  In the SSAO stochastic rendering compositor, the volume is drawn after the
+ *  other objects in each repetition, and the ray is terminated at the depth
+ *  of the geometry already drawn in front of the box exit. This setting is
+ *  ignored if the volume is drawn by the renderer alone.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setGeometryClippingEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setGeometryClippingEnabled( enabled );
+}
+
+bool SSAOStochasticUniformGridRenderer::isGeometryClippingEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isGeometryClippingEnabled();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the scalar value derived from the vector volume.
+ *  @param  mode [in] magnitude or x, y or z component
+ *
+ *  The vector volume (veclen = 3) is uploaded once as a texture of the
+ *  normalized components, and the magnitude or the selected component is
+ *  computed in the shader. The mode can be changed without uploading the
+ *  volume again.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setVectorMode( const VectorMode mode )
+{
+    static_cast<Engine&>( engine() ).setVectorMode( mode );
+}
+
+SSAOStochasticUniformGridRenderer::VectorMode SSAOStochasticUniformGridRenderer::vectorMode() const
+{
+    return static_cast<const Engine&>( engine() ).vectorMode();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the files of the time series.
+ *  @param  filenames [in] filenames of the time steps
+ *
+ *  The object registered with the renderer is used as the first time step,
+ *  and gives the resolution, the data type and the normalization of all of
+ *  the time steps. The requested time step is decoded by a background thread
+ *  while the current time step is rendered, and the texture is swapped on
+ *  the frame boundary without recreating the engine.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setTimeSeries( const std::vector<std::string>& filenames )
+{
+    static_cast<Engine&>( engine() ).setTimeSeries( filenames );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets the time step to be displayed.
+ *  @param  step [in] time step
+ *
+ *  The time step is displayed at the first frame after it has been decoded.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setTimeStep( const size_t step )
+{
+    static_cast<Engine&>( engine() ).setTimeStep( step );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Enables or disables the playback of the time series.
+ *  @param  enabled [in] true if the time steps are played back
+ *
+ *  The next time step is displayed as soon as it has been decoded, so that
+ *  the playback rate is limited by the decoding rate. The screen has to be
+ *  redrawn continuously during the playback.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::setPlaybackEnabled( const bool enabled )
+{
+    static_cast<Engine&>( engine() ).setPlaybackEnabled( enabled );
+}
+
+size_t SSAOStochasticUniformGridRenderer::numberOfTimeSteps() const
+{
+    return static_cast<const Engine&>( engine() ).numberOfTimeSteps();
+}
+
+size_t SSAOStochasticUniformGridRenderer::timeStep() const
+{
+    return static_cast<const Engine&>( engine() ).timeStep();
+}
+
+bool SSAOStochasticUniformGridRenderer::isPlaybackEnabled() const
+{
+    return static_cast<const Engine&>( engine() ).isPlaybackEnabled();
+}
+
+const kvs::TransferFunction& SSAOStochasticUniformGridRenderer::transferFunction() const
+{
+    return static_cast<const Engine&>( engine() ).transferFunction();
+}
+
+float SSAOStochasticUniformGridRenderer::samplingStep() const
+{
+    return static_cast<const Engine&>( engine() ).samplingStep();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Constructs a new Engine class.
+ */
+/*===========================================================================*/
+SSAOStochasticUniformGridRenderer::Engine::Engine()
+{
+    m_render_pass.setShaderFiles(
+        "SSAO_SR_uniform_grid_geom_pass.vert",
+        "SSAO_SR_uniform_grid_geom_pass.frag" );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Releases the GPU resources.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::release()
+{
+    // Release transfer function resources
+    m_transfer_function_texture.release();
+    m_transfer_function_changed = true;
+    m_preintegration_texture.release();
+    m_preintegration_changed = true;
+    m_occupancy_texture.release();
+    m_macro_cell_ranges.release();
+    m_occupancy_changed = true;
+    m_gradient_texture.release();
+    m_bricked_buffer.release();
+    m_brick_ranges.release();
+    m_brick_occupancy_changed = true;
+    m_multiresolution_buffer.release();
+    m_dequantization_texture.release();
+    m_vector_texture.release();
+    for ( auto& texture : m_coord_inverse_textures ) { texture.release(); }
+
+    // Release time series resources
+    this->wait_time_step();
+    for ( auto& texture : m_time_step_textures ) { texture.release(); }
+    m_time_step_uploaded = false;
+
+    // Release buffer object resources
+    m_entry_texture.release();
+    m_exit_texture.release();
+    m_entry_exit_framebuffer.release();
+
+    m_volume_buffer.release();
+    m_render_pass.release();
+
+    m_bounding_cube_buffer.release();
+    m_bounding_render_pass.release();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Create.
+ *  @param  object [in] pointer to the volume object
+ *  @param  camera [in] pointer to the camera
+ *  @param  light [in] pointer to the light
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::create(
+    kvs::ObjectBase* object,
+    kvs::Camera* camera,
+    kvs::Light* light )
+{
+    auto* volume = kvs::StructuredVolumeObject::DownCast( object );
+    BaseClass::attachObject( object );
+    BaseClass::createRandomTexture();
+    this->setup_grid( volume );
+
+    // Create shader program
+    this->create_shader_program( volume );
+
+    // Create framebuffer
+    if ( !this->is_analytic_entry_exit() )
+    {
+        const auto framebuffer_size = ::FramebufferSize( camera, BaseClass::renderScale() );
+        this->create_framebuffer( framebuffer_size[0], framebuffer_size[1] );
+    }
+
+    // Create buffer object
+    this->create_buffer_object( volume );
+
+    // Create transfer function texture
+    this->create_transfer_function_texture();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Update.
+ *  @param  object [in] pointer to the object
+ *  @param  camera [in] pointer to the camera
+ *  @param  light [in] pointer to the light
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::update(
+    kvs::ObjectBase* object,
+    kvs::Camera* camera,
+    kvs::Light* light )
+{
+    auto* volume = kvs::StructuredVolumeObject::DownCast( object );
+    this->setup_grid( volume );
+
+    // Update shader program
+    this->update_shader_program( volume );
+
+    // Update framebuffer
+    const auto framebuffer_size = ::FramebufferSize( camera, BaseClass::renderScale() );
+    this->update_framebuffer( framebuffer_size[0], framebuffer_size[1] );
+    this->update_buffer_object( volume );
+
+    this->update_transfer_function_texture();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Resizes the entry/exit framebuffer without re-uploading the volume.
+ *  @param  camera [in] pointer to the camera
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::resize( kvs::Camera* camera )
+{
+    const auto framebuffer_size = ::FramebufferSize( camera, BaseClass::renderScale() );
+    this->update_framebuffer( framebuffer_size[0], framebuffer_size[1] );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Set up.
+ *  @param  object [in] pointer to the object
+ *  @param  camera [in] pointer to the camera
+ *  @param  light [in] pointer to the light
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::setup(
+    kvs::ObjectBase* object,
+    kvs::Camera* camera,
+    kvs::Light* light )
+{
+    if ( m_transfer_function_changed ) { this->update_transfer_function_texture(); }
+
+    // Swap the decoded time step on the frame boundary
+    if ( m_time_series.size() > 0 )
+    {
+        this->update_time_series( kvs::StructuredVolumeObject::DownCast( object ) );
+    }
+
+    // The pre-integration table depends on the sampling step
+    if ( m_enable_preintegration && ( m_preintegration_changed || m_preintegration_step != m_step ) )
+    {
+        this->update_preintegration_texture();
+    }
+
+    // The macro cells are given in the voxel coordinates, which are not linear
+    // in the object coordinates of the rectilinear grid.
+    if ( m_rectilinear && m_enable_empty_space_skipping )
+    {
+        kvsMessageWarning( "The empty space skipping is not supported for the rectilinear grid." );
+        m_enable_empty_space_skipping = false;
+    }
+
+    // Build the macro cells lazily if the empty space skipping has been enabled
+    if ( m_enable_empty_space_skipping )
+    {
+        if ( m_macro_cell_ranges.size() == 0 ) { this->create_macro_cells( kvs::StructuredVolumeObject::DownCast( object ) ); }
+        if ( m_occupancy_changed ) { this->update_occupancy_texture(); }
+    }
+
+    // Compute the gradient lazily if the precomputed gradient has been enabled
+    const bool bricked = m_bricked_buffer.isCreated();
+    if ( m_enable_gradient_volume && !bricked && !m_gradient_texture.isCreated() )
+    {
+        this->create_gradient_texture( kvs::StructuredVolumeObject::DownCast( object ) );
+    }
+
+    // Build the coarse levels lazily if the multiresolution volume has been
+    // enabled or the coarse level has been changed
+    if ( m_enable_multiresolution && m_multiresolution_buffer.numberOfLevels() != m_coarse_level + 1 )
+    {
+        this->create_multiresolution_buffer( kvs::StructuredVolumeObject::DownCast( object ) );
+    }
+
+    // Stream the visible bricks into the atlas
+    if ( bricked )
+    {
+        if ( m_brick_occupancy_changed )
+        {
+            m_bricked_buffer.setOccupancy( ::CellOccupancy( m_brick_ranges, m_transfer_function, m_value_range ) );
+            m_brick_occupancy_changed = false;
+        }
+        const kvs::Mat4 PM = kvs::OpenGL::ProjectionMatrix() * kvs::OpenGL::ModelViewMatrix();
+
+        // The repetitions accumulated with the missing bricks are discarded.
+        if ( m_bricked_buffer.update( PM ) > 0 ) { BaseClass::invalidateEnsemble(); }
+    }
+
+    // Resize the entry/exit framebuffer if the render scale has been changed,
+    // or create/release it if the analytic entry/exit points have been toggled
+    const bool framebuffer_required = !this->is_analytic_entry_exit();
+    if ( m_entry_texture.isCreated() != framebuffer_required ||
+         ( framebuffer_required && m_framebuffer_scale != BaseClass::renderScale() ) )
+    {
+        const auto framebuffer_size = ::FramebufferSize( camera, BaseClass::renderScale() );
+        this->update_framebuffer( framebuffer_size[0], framebuffer_size[1] );
+    }
+
+    this->setup_shader_program( BaseClass::shader(), object, camera, light );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Draw an ensemble.
+ *  @param  object [in] pointer to the line object
+ *  @param  camera [in] pointer to the camera
+ *  @param  light [in] pointer to the light
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::draw(
+    kvs::ObjectBase* object,
+    kvs::Camera* camera,
+    kvs::Light* light )
+{
+    kvs::OpenGL::Enable( GL_DEPTH_TEST );
+    kvs::OpenGL::Enable( GL_TEXTURE_2D );
+
+//    m_ao_buffer.bind();
+    auto& geom_pass = m_render_pass.shaderProgram();
+    kvs::ProgramObject::Binder bind( geom_pass );
+    this->draw_buffer_object( kvs::StructuredVolumeObject::DownCast( object ) );
+//    m_ao_buffer.unbind();
+//    m_ao_buffer.draw();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Sets up the bounding box for the grid type of the volume.
+ *  @param  volume [in] pointer to the structured volume object
+ *
+ *  The object coordinates of the uniform grid are the voxel coordinates, and
+ *  those of the rectilinear grid are given by the coordinates of each axis.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::setup_grid(
+    const kvs::StructuredVolumeObject* volume )
+{
+    const kvs::Vec3ui r = volume->resolution();
+    m_rectilinear = volume->gridType() == kvs::StructuredVolumeObject::Rectilinear;
+    m_box_min = kvs::Vec3::Constant( 0.0f );
+    m_box_max = kvs::Vec3( r ) - kvs::Vec3::Constant( 1.0f );
+    m_min_spacing = 1.0f;
+    if ( !m_rectilinear ) { return; }
+
+    // The coordinates are stored as x-coords, y-coords and z-coords.
+    const kvs::Real32* coords = volume->coords().data();
+    float min_spacing = 0.0f;
+    for ( size_t axis = 0; axis < 3; axis++ )
+    {
+        const size_t n = r[ axis ];
+        m_box_min[ axis ] = coords[0];
+        m_box_max[ axis ] = coords[ n - 1 ];
+        for ( size_t i = 0; i + 1 < n; i++ )
+        {
+            const float spacing = coords[ i + 1 ] - coords[i];
+            if ( spacing > 0.0f && ( min_spacing == 0.0f || spacing < min_spacing ) ) { min_spacing = spacing; }
+        }
+        coords += n;
+    }
+    if ( min_spacing > 0.0f ) { m_min_spacing = min_spacing; }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates the inverse coordinate textures of the rectilinear grid.
+ *  @param  volume [in] pointer to the structured volume object
+ *
+ *  Each 1D texture maps the normalized coordinate along the axis to the grid
+ *  index, so that the sampling points in the object coordinates are mapped to
+ *  the voxel coordinates in the shader.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::create_coord_inverse_textures(
+    const kvs::StructuredVolumeObject* volume )
+{
+    const kvs::Vec3ui r = volume->resolution();
+    const kvs::Real32* coords = volume->coords().data();
+    for ( size_t axis = 0; axis < 3; axis++ )
+    {
+        const size_t n = r[ axis ];
+        const size_t size = kvs::Math::Clamp( n * 4, size_t( 2 ), size_t( 4096 ) );
+        const auto table = ::CoordInverseTable( coords, n, size );
+        coords += n;
+
+        auto& texture = m_coord_inverse_textures[ axis ];
+        texture.release();
+        texture.setWrapS( GL_CLAMP_TO_EDGE );
+        texture.setMagFilter( GL_LINEAR );
+        texture.setMinFilter( GL_LINEAR );
+        texture.setPixelFormat( GL_ALPHA32F_ARB, GL_ALPHA, GL_FLOAT );
+        texture.create( table.size(), table.data() );
+    }
+}
+
+void SSAOStochasticUniformGridRenderer::Engine::create_transfer_function_texture()
+{
+    const size_t width = m_transfer_function.resolution();
+    const auto table = m_transfer_function.table();
+    m_transfer_function_texture.setWrapS( GL_CLAMP_TO_EDGE );
+    m_transfer_function_texture.setMagFilter( GL_LINEAR );
+    m_transfer_function_texture.setMinFilter( GL_LINEAR );
+    m_transfer_function_texture.setPixelFormat( GL_RGBA32F_ARB, GL_RGBA, GL_FLOAT  );
+    m_transfer_function_texture.create( width, table.data() );
+    m_transfer_function_changed = false;
+}
+
+void SSAOStochasticUniformGridRenderer::Engine::update_transfer_function_texture()
+{
+    // The texture is reallocated only if the resolution has been changed.
+    // Otherwise, the table is uploaded into the allocated texture.
+    const size_t width = m_transfer_function.resolution();
+    if ( m_transfer_function_texture.width() != width )
+    {
+        m_transfer_function_texture.release();
+        this->create_transfer_function_texture();
+        return;
+    }
+
+    const auto table = m_transfer_function.table();
+    kvs::Texture::Binder binder( m_transfer_function_texture );
+    m_transfer_function_texture.load( width, table.data() );
+    m_transfer_function_changed = false;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Updates the pre-integrated transfer function texture for the
+ *          current sampling step.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::update_preintegration_texture()
+{
+    const size_t width = m_transfer_function.resolution();
+    const auto table = ::PreIntegrationTable( m_transfer_function, m_step );
+    if ( m_preintegration_texture.width() != width )
+    {
+        m_preintegration_texture.release();
+        m_preintegration_texture.setWrapS( GL_CLAMP_TO_EDGE );
+        m_preintegration_texture.setWrapT( GL_CLAMP_TO_EDGE );
+        m_preintegration_texture.setMagFilter( GL_LINEAR );
+        m_preintegration_texture.setMinFilter( GL_LINEAR );
+        m_preintegration_texture.setPixelFormat( GL_RGBA32F_ARB, GL_RGBA, GL_FLOAT );
+        m_preintegration_texture.create( width, width, table.data() );
+    }
+    else
+    {
+        kvs::Texture::Binder binder( m_preintegration_texture );
+        m_preintegration_texture.load( width, width, table.data() );
+    }
+
+    m_preintegration_step = m_step;
+    m_preintegration_changed = false;
+}
 
 /*===========================================================================*/
 /**
- *  @brief  Constructs a new StochasticUniformGridRenderer class.
+ *  @brief  Creates the min/max values of the macro cells.
+ *  @param  volume [in] pointer to the structured volume object
  */
 /*===========================================================================*/
-SSAOStochasticUniformGridRenderer::SSAOStochasticUniformGridRenderer():
-    SSAOStochasticRendererBase( new Engine() )
-{
-}
-
-void SSAOStochasticUniformGridRenderer::setEdgeFactor( const float factor )
+void SSAOStochasticUniformGridRenderer::Engine::create_macro_cells(
+    const kvs::StructuredVolumeObject* volume )
 {
-    static_cast<Engine&>( engine() ).setEdgeFactor( factor );
+    m_macro_cell_ranges = ::CellRanges( volume, m_macro_cell_size, m_macro_grid_resolution );
+    m_occupancy_changed = true;
 }
 
 /*===========================================================================*/
 /**
- *  @brief  Sets a sampling step.
- *  @param  transfer_function [in] transfer function
+ *  @brief  Updates the occupancy texture of the macro cells for the current
+ *          transfer function.
  */
 /*===========================================================================*/
-void SSAOStochasticUniformGridRenderer::setSamplingStep( const float step )
+void SSAOStochasticUniformGridRenderer::Engine::update_occupancy_texture()
 {
-    static_cast<Engine&>( engine() ).setSamplingStep( step );
+    const auto occupancy = ::CellOccupancy( m_macro_cell_ranges, m_transfer_function, m_value_range );
+
+    const auto& grid = m_macro_grid_resolution;
+    if ( m_occupancy_texture.width() != grid.x() ||
+         m_occupancy_texture.height() != grid.y() ||
+         m_occupancy_texture.depth() != grid.z() )
+    {
+        m_occupancy_texture.release();
+        m_occupancy_texture.setWrapS( GL_CLAMP_TO_EDGE );
+        m_occupancy_texture.setWrapT( GL_CLAMP_TO_EDGE );
+        m_occupancy_texture.setWrapR( GL_CLAMP_TO_EDGE );
+        m_occupancy_texture.setMagFilter( GL_NEAREST );
+        m_occupancy_texture.setMinFilter( GL_NEAREST );
+        m_occupancy_texture.setPixelFormat( GL_ALPHA8, GL_ALPHA, GL_UNSIGNED_BYTE );
+        m_occupancy_texture.create( grid.x(), grid.y(), grid.z(), occupancy.data() );
+    }
+    else
+    {
+        kvs::Texture::Binder binder( m_occupancy_texture );
+        m_occupancy_texture.load( grid.x(), grid.y(), grid.z(), occupancy.data() );
+    }
+
+    m_occupancy_changed = false;
 }
 
 /*===========================================================================*/
 /**
- *  @brief  Sets a transfer function.
- *  @param  transfer_function [in] transfer function
+ *  @brief  Creates the precomputed gradient texture.
+ *  @param  volume [in] pointer to the structured volume object
  */
 /*===========================================================================*/
-void SSAOStochasticUniformGridRenderer::setTransferFunction(
-    const kvs::TransferFunction& transfer_function )
+void SSAOStochasticUniformGridRenderer::Engine::create_gradient_texture(
+    const kvs::StructuredVolumeObject* volume )
 {
-    static_cast<Engine&>( engine() ).setTransferFunction( transfer_function );
-}
+    if ( volume->veclen() != 1 )
+    {
+        kvsMessageWarning( "The precomputed gradient is not supported for the vector volume." );
+        m_enable_gradient_volume = false;
+        return;
+    }
 
-const kvs::TransferFunction& SSAOStochasticUniformGridRenderer::transferFunction() const
-{
-    return static_cast<const Engine&>( engine() ).transferFunction();
-}
+    kvs::ValueArray<kvs::UInt8> gradients;
+    const std::type_info& type = volume->values().typeInfo()->type();
+    if ( type == typeid( kvs::UInt8 ) ) { gradients = ::GradientVolume<kvs::UInt8>( volume ); }
+    else if ( type == typeid( kvs::Int8 ) ) { gradients = ::GradientVolume<kvs::Int8>( volume ); }
+    else if ( type == typeid( kvs::UInt16 ) ) { gradients = ::GradientVolume<kvs::UInt16>( volume ); }
+    else if ( type == typeid( kvs::Int16 ) ) { gradients = ::GradientVolume<kvs::Int16>( volume ); }
+    else if ( type == typeid( kvs::UInt32 ) ) { gradients = ::GradientVolume<kvs::UInt32>( volume ); }
+    else if ( type == typeid( kvs::Int32 ) ) { gradients = ::GradientVolume<kvs::Int32>( volume ); }
+    else if ( type == typeid( kvs::Real32 ) ) { gradients = ::GradientVolume<kvs::Real32>( volume ); }
+    else if ( type == typeid( kvs::Real64 ) ) { gradients = ::GradientVolume<kvs::Real64>( volume ); }
+    else
+    {
+        kvsMessageWarning( "The precomputed gradient is not supported for '%s'.",
+                           volume->values().typeInfo()->typeName() );
+        m_enable_gradient_volume = false;
+        return;
+    }
 
-float SSAOStochasticUniformGridRenderer::samplingStep() const
-{
-    return static_cast<const Engine&>( engine() ).samplingStep();
+    const kvs::Vec3ui r = volume->resolution();
+    m_gradient_texture.release();
+    m_gradient_texture.setWrapS( GL_CLAMP_TO_EDGE );
+    m_gradient_texture.setWrapT( GL_CLAMP_TO_EDGE );
+    m_gradient_texture.setWrapR( GL_CLAMP_TO_EDGE );
+    m_gradient_texture.setMagFilter( GL_LINEAR );
+    m_gradient_texture.setMinFilter( GL_LINEAR );
+    m_gradient_texture.setPixelFormat( GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE );
+    m_gradient_texture.create( r.x(), r.y(), r.z(), gradients.data() );
 }
 
 /*===========================================================================*/
 /**
- *  @brief  Constructs a new Engine class.
+ *  @brief  Creates the coarse levels of the volume.
+ *  @param  volume [in] pointer to the structured volume object
  */
 /*===========================================================================*/
-SSAOStochasticUniformGridRenderer::Engine::Engine()
+void SSAOStochasticUniformGridRenderer::Engine::create_multiresolution_buffer(
+    const kvs::StructuredVolumeObject* volume )
 {
-    m_render_pass.setShaderFiles(
-        "SSAO_SR_uniform_grid_geom_pass.vert",
-        "SSAO_SR_uniform_grid_geom_pass.frag" );
+    if ( !m_multiresolution_buffer.create( volume, m_coarse_level ) )
+    {
+        m_enable_multiresolution = false;
+    }
 }
 
 /*===========================================================================*/
 /**
- *  @brief  Releases the GPU resources.
+ *  @brief  Sets the files of the time series.
+ *  @param  filenames [in] filenames of the time steps
  */
 /*===========================================================================*/
-void SSAOStochasticUniformGridRenderer::Engine::release()
+void SSAOStochasticUniformGridRenderer::Engine::setTimeSeries(
+    const std::vector<std::string>& filenames )
 {
-    // Release transfer function resources
-    m_transfer_function_texture.release();
-    m_transfer_function_changed = true;
-
-    // Release buffer object resources
-    m_entry_texture.release();
-    m_exit_texture.release();
-    m_entry_exit_framebuffer.release();
-
-    m_volume_buffer.release();
-    m_render_pass.release();
-
-    m_bounding_cube_buffer.release();
-    m_bounding_render_pass.release();
+    this->wait_time_step();
+    m_time_series = filenames;
+    m_time_step = 0;
+    m_time_step_requested = false;
+    m_time_step_uploaded = false;
 }
 
 /*===========================================================================*/
 /**
- *  @brief  Create.
- *  @param  object [in] pointer to the volume object
- *  @param  camera [in] pointer to the camera
- *  @param  light [in] pointer to the light
+ *  @brief  Displays the decoded time step and prefetches the next time step.
+ *  @param  volume [in] pointer to the structured volume object (first time step)
+ *
+ *  The values of the decoded time step are uploaded to the back texture,
+ *  which is not used by the previous frame, and the textures are swapped
+ *  before the current frame is drawn. The shader program and the entry/exit
+ *  resources are kept as they are.
  */
 /*===========================================================================*/
-void SSAOStochasticUniformGridRenderer::Engine::create(
-    kvs::ObjectBase* object,
-    kvs::Camera* camera,
-    kvs::Light* light )
+void SSAOStochasticUniformGridRenderer::Engine::update_time_series(
+    const kvs::StructuredVolumeObject* volume )
 {
-    auto* volume = kvs::StructuredVolumeObject::DownCast( object );
-    BaseClass::attachObject( object );
-    BaseClass::createRandomTexture();
+    const size_t nsteps = m_time_series.size();
 
-    // Create shader program
-    this->create_shader_program( volume );
+    if ( m_prefetch.valid() && m_prefetch.wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready )
+    {
+        const TimeStep step = m_prefetch.get();
 
-    // Create framebuffer
-    const float dpr = camera->devicePixelRatio();
-    const size_t framebuffer_width = static_cast<size_t>( camera->windowWidth() * dpr );
-    const size_t framebuffer_height = static_cast<size_t>( camera->windowHeight() * dpr );
-    this->create_framebuffer( framebuffer_width, framebuffer_height );
+        // The time step which is no longer requested is discarded.
+        if ( m_time_step_requested && step.index == m_next_time_step )
+        {
+            m_time_step_requested = false;
+            m_time_step = step.index;
+            if ( step.values.size() == volume->numberOfNodes() ) { this->upload_time_step( volume, step ); }
+            else { kvsMessageWarning( "Cannot load the time step '%s'.", m_time_series[ step.index ].c_str() ); }
+        }
+    }
 
-    // Create buffer object
-    this->create_buffer_object( volume );
+    // The next time step is decoded while the current time step is rendered.
+    if ( m_enable_playback && !m_time_step_requested )
+    {
+        m_next_time_step = ( m_time_step + 1 ) % nsteps;
+        m_time_step_requested = true;
+    }
 
-    // Create transfer function texture
-    this->create_transfer_function_texture();
+    if ( m_time_step_requested && !m_prefetch.valid() )
+    {
+        this->prefetch_time_step( volume, m_next_time_step );
+    }
 }
 
 /*===========================================================================*/
 /**
- *  @brief  Update.
- *  @param  object [in] pointer to the object
- *  @param  camera [in] pointer to the camera
- *  @param  light [in] pointer to the light
+ *  @brief  Starts decoding the time step in the background.
+ *  @param  volume [in] pointer to the structured volume object (first time step)
+ *  @param  step [in] time step
+ *
+ *  The volume is imported and normalized by the min/max values of the first
+ *  time step, and the ranges of the macro cells are computed in the same
+ *  thread. The time step which does not match the first time step in the
+ *  resolution, the vector length or the data type is not loaded.
  */
 /*===========================================================================*/
-void SSAOStochasticUniformGridRenderer::Engine::update(
-    kvs::ObjectBase* object,
-    kvs::Camera* camera,
-    kvs::Light* light )
+void SSAOStochasticUniformGridRenderer::Engine::prefetch_time_step(
+    const kvs::StructuredVolumeObject* volume,
+    const size_t step )
 {
-    auto* volume = kvs::StructuredVolumeObject::DownCast( object );
-
-    // Update shader program
-    this->update_shader_program( volume );
+    const std::string filename = m_time_series[ step ];
+    const kvs::Vec3ui resolution = volume->resolution();
+    const size_t veclen = volume->veclen();
+    const std::type_info* type = &volume->values().typeInfo()->type();
+    const double min_value = volume->minValue();
+    const double max_value = volume->maxValue();
+    const size_t cell_size = m_macro_cell_size;
+    m_prefetch = std::async( std::launch::async, [=] ()
+    {
+        TimeStep time_step;
+        time_step.index = step;
 
-    // Update framebuffer
-    const float dpr = camera->devicePixelRatio();
-    const size_t framebuffer_width = static_cast<size_t>( camera->windowWidth() * dpr );
-    const size_t framebuffer_height = static_cast<size_t>( camera->windowHeight() * dpr );
-    this->update_framebuffer( framebuffer_width, framebuffer_height );
-    this->update_buffer_object( volume );
+        auto* data = new kvs::StructuredVolumeImporter( filename );
+        if ( data->resolution() == resolution &&
+             data->veclen() == veclen && veclen == 1 &&
+             data->values().typeInfo()->type() == *type )
+        {
+            data->setMinMaxValues( min_value, max_value );
+            time_step.values = ::NormalizedTexels( data );
+            time_step.macro_cell_size = cell_size;
+            time_step.macro_cell_ranges = ::CellRanges( data, cell_size, time_step.macro_grid_resolution );
+        }
+        delete data;
 
-    this->update_transfer_function_texture();
+        return time_step;
+    } );
 }
 
 /*===========================================================================*/
 /**
- *  @brief  Set up.
- *  @param  object [in] pointer to the object
- *  @param  camera [in] pointer to the camera
- *  @param  light [in] pointer to the light
+ *  @brief  Uploads the time step to the back texture and swaps the textures.
+ *  @param  volume [in] pointer to the structured volume object (first time step)
+ *  @param  step [in] decoded time step
  */
 /*===========================================================================*/
-void SSAOStochasticUniformGridRenderer::Engine::setup(
-    kvs::ObjectBase* object,
-    kvs::Camera* camera,
-    kvs::Light* light )
+void SSAOStochasticUniformGridRenderer::Engine::upload_time_step(
+    const kvs::StructuredVolumeObject* volume,
+    const TimeStep& step )
 {
-    if ( m_transfer_function_changed ) { this->update_transfer_function_texture(); }
+    const kvs::Vec3ui r = volume->resolution();
+    const size_t back = 1 - m_front_texture;
+    auto& texture = m_time_step_textures[ back ];
+    if ( !texture.isCreated() )
+    {
+        texture.setWrapS( GL_CLAMP_TO_EDGE );
+        texture.setWrapT( GL_CLAMP_TO_EDGE );
+        texture.setWrapR( GL_CLAMP_TO_EDGE );
+        texture.setMagFilter( GL_LINEAR );
+        texture.setMinFilter( GL_LINEAR );
+        texture.setPixelFormat( GL_ALPHA16, GL_ALPHA, GL_UNSIGNED_SHORT );
+        texture.create( r.x(), r.y(), r.z(), step.values.data() );
+    }
+    else
+    {
+        kvs::Texture::Binder binder( texture );
+        texture.load( r.x(), r.y(), r.z(), step.values.data() );
+    }
+    m_front_texture = back;
+    m_time_step_uploaded = true;
 
-    this->setup_shader_program( BaseClass::shader(), object, camera, light );
+    // The repetitions accumulated for the previous time step are discarded.
+    BaseClass::invalidateEnsemble();
+
+    // The macro cells are replaced unless the macro cell size has been changed
+    // during the decoding.
+    if ( step.macro_cell_size == m_macro_cell_size )
+    {
+        m_macro_cell_ranges = step.macro_cell_ranges;
+        m_macro_grid_resolution = step.macro_grid_resolution;
+        m_occupancy_changed = true;
+    }
 }
 
 /*===========================================================================*/
 /**
- *  @brief  Draw an ensemble.
- *  @param  object [in] pointer to the line object
- *  @param  camera [in] pointer to the camera
- *  @param  light [in] pointer to the light
+ *  @brief  Waits for the time step decoded in the background, and discards it.
  */
 /*===========================================================================*/
-void SSAOStochasticUniformGridRenderer::Engine::draw(
-    kvs::ObjectBase* object,
-    kvs::Camera* camera,
-    kvs::Light* light )
-{
-    kvs::OpenGL::Enable( GL_DEPTH_TEST );
-    kvs::OpenGL::Enable( GL_TEXTURE_2D );
-
-//    m_ao_buffer.bind();
-    auto& geom_pass = m_render_pass.shaderProgram();
-    kvs::ProgramObject::Binder bind( geom_pass );
-    this->draw_buffer_object( kvs::StructuredVolumeObject::DownCast( object ) );
-//    m_ao_buffer.unbind();
-//    m_ao_buffer.draw();
-}
-
-void SSAOStochasticUniformGridRenderer::Engine::create_transfer_function_texture()
-{
-    const size_t width = m_transfer_function.resolution();
-    const auto table = m_transfer_function.table();
-    m_transfer_function_texture.setWrapS( GL_CLAMP_TO_EDGE );
-    m_transfer_function_texture.setMagFilter( GL_LINEAR );
-    m_transfer_function_texture.setMinFilter( GL_LINEAR );
-    m_transfer_function_texture.setPixelFormat( GL_RGBA32F_ARB, GL_RGBA, GL_FLOAT  );
-    m_transfer_function_texture.create( width, table.data() );
-    m_transfer_function_changed = false;
-}
-
-void SSAOStochasticUniformGridRenderer::Engine::update_transfer_function_texture()
+void SSAOStochasticUniformGridRenderer::Engine::wait_time_step()
 {
-    m_transfer_function_texture.release();
-    this->create_transfer_function_texture();
+    if ( m_prefetch.valid() ) { m_prefetch.get(); }
+    m_time_step_requested = false;
 }
 
 /*===========================================================================*/
@@ -261,12 +1746,21 @@ void SSAOStochasticUniformGridRenderer::Engine::create_shader_program(
 
     auto& geom_pass = m_render_pass.shaderProgram();
     kvs::ProgramObject::Binder bind( geom_pass );
-    geom_pass.setUniform( "sampling_step", m_step );
     geom_pass.setUniform( "volume_data", 0 );
     geom_pass.setUniform( "exit_points", 1 );
     geom_pass.setUniform( "entry_points", 2 );
     geom_pass.setUniform( "transfer_function_data", 3 );
     geom_pass.setUniform( "random_texture", 4 );
+    geom_pass.setUniform( "preintegration_texture", 5 );
+    geom_pass.setUniform( "occupancy_texture", 6 );
+    geom_pass.setUniform( "gradient_texture", 7 );
+    geom_pass.setUniform( "brick_atlas", 8 );
+    geom_pass.setUniform( "page_table", 9 );
+    geom_pass.setUniform( "dequantization_table", 10 );
+    geom_pass.setUniform( "geometry_depth_texture", 11 );
+    geom_pass.setUniform( "coord_inverse_x", 12 );
+    geom_pass.setUniform( "coord_inverse_y", 13 );
+    geom_pass.setUniform( "coord_inverse_z", 14 );
 }
 
 void SSAOStochasticUniformGridRenderer::Engine::update_shader_program(
@@ -284,9 +1778,12 @@ void SSAOStochasticUniformGridRenderer::Engine::setup_shader_program(
     const kvs::Light* light )
 {
     // Setup entry/exit textures by drawing bounding cube to FBO
+    if ( !this->is_analytic_entry_exit() )
     {
         // Change renderig target to the entry/exit FBO.
         kvs::FrameBufferObject::GuardedBinder binder( m_entry_exit_framebuffer );
+        kvs::OpenGL::WithPushedAttrib attrib( GL_VIEWPORT_BIT );
+        kvs::OpenGL::SetViewport( 0, 0, m_entry_texture.width(), m_entry_texture.height() );
         m_bounding_render_pass.setup();
         m_bounding_render_pass.draw();
     }
@@ -300,11 +1797,29 @@ void SSAOStochasticUniformGridRenderer::Engine::setup_shader_program(
         const kvs::Mat4 PM_inverse = PM.inverted();
         const kvs::Mat3 N = kvs::Mat3( M[0].xyz(), M[1].xyz(), M[2].xyz() );
         kvs::ProgramObject::Binder bind( m_render_pass.shaderProgram() );
+        m_render_pass.shaderProgram().setUniform( "ModelViewProjectionMatrix", PM );
         m_render_pass.shaderProgram().setUniform( "ModelViewProjectionMatrixInverse", PM_inverse );
         m_render_pass.shaderProgram().setUniform( "ModelViewMatrix", M );
         m_render_pass.shaderProgram().setUniform( "NormalMatrix", N );
         m_render_pass.shaderProgram().setUniform( "random_texture_size_inv", 1.0f / randomTextureSize() );
         m_render_pass.shaderProgram().setUniform( "edge_factor", m_edge_factor );
+        m_render_pass.shaderProgram().setUniform( "sampling_step", m_rectilinear ? m_step * m_min_spacing : m_step );
+        m_render_pass.shaderProgram().setUniform( "preintegration", m_enable_preintegration ? 1 : 0 );
+        m_render_pass.shaderProgram().setUniform( "macro_cell_size", static_cast<float>( m_macro_cell_size ) );
+        m_render_pass.shaderProgram().setUniform( "macro_grid_resolution", kvs::Vec3( m_macro_grid_resolution ) );
+        m_render_pass.shaderProgram().setUniform( "analytic_entry_exit", this->is_analytic_entry_exit() ? 1 : 0 );
+        m_render_pass.shaderProgram().setUniform( "vector_mode", m_vector_texture.isCreated() ? int( m_vector_mode ) : -1 );
+        if ( m_vector_texture.isCreated() )
+        {
+            m_render_pass.shaderProgram().setUniform( "vector_scale", m_vector_scale );
+            m_render_pass.shaderProgram().setUniform( "vector_range", m_vector_ranges[ m_vector_mode ] );
+        }
+        if ( m_bricked_buffer.isCreated() )
+        {
+            m_render_pass.shaderProgram().setUniform( "brick_size", static_cast<float>( m_bricked_buffer.brickSize() ) );
+            m_render_pass.shaderProgram().setUniform( "brick_grid_resolution", kvs::Vec3( m_bricked_buffer.gridResolution() ) );
+            m_render_pass.shaderProgram().setUniform( "brick_atlas_size", m_bricked_buffer.atlasSize() );
+        }
     }
 
     // Setup OpenGL statement.
@@ -318,8 +1833,8 @@ void SSAOStochasticUniformGridRenderer::Engine::setup_shader_program(
 /*===========================================================================*/
 /**
  *  @brief  Creates framebuffer.
- *  @param  width [in] window width
- *  @param  height [in] window height
+ *  @param  width [in] framebuffer width (scaled by the render scale)
+ *  @param  height [in] framebuffer height (scaled by the render scale)
  */
 /*===========================================================================*/
 void SSAOStochasticUniformGridRenderer::Engine::create_framebuffer(
@@ -343,6 +1858,7 @@ void SSAOStochasticUniformGridRenderer::Engine::create_framebuffer(
     m_entry_exit_framebuffer.create();
     m_entry_exit_framebuffer.attachColorTexture( m_exit_texture, 0 );
     m_entry_exit_framebuffer.attachColorTexture( m_entry_texture, 1 );
+    m_framebuffer_scale = BaseClass::renderScale();
 
     auto& geom_pass = m_render_pass.shaderProgram();
     kvs::ProgramObject::Binder bind( geom_pass );
@@ -364,14 +1880,39 @@ void SSAOStochasticUniformGridRenderer::Engine::update_framebuffer(
     m_entry_texture.release();
     m_exit_texture.release();
     m_entry_exit_framebuffer.release();
-    this->create_framebuffer( width, height );
+    if ( !this->is_analytic_entry_exit() ) { this->create_framebuffer( width, height ); }
 }
 
 void SSAOStochasticUniformGridRenderer::Engine::create_buffer_object(
     const kvs::StructuredVolumeObject* volume )
 {
-    m_volume_buffer.create( volume, this->transferFunction() );
-    m_bounding_cube_buffer.create( volume );
+    // The dense volume texture is not created for the bricked volume.
+    m_bricked_buffer.release();
+    if ( m_rectilinear && m_enable_bricking )
+    {
+        kvsMessageWarning( "The bricked volume is not supported for the rectilinear grid." );
+        m_enable_bricking = false;
+    }
+    if ( m_enable_bricking && m_bricked_buffer.create( volume ) )
+    {
+        kvs::Vec3ui grid;
+        m_brick_ranges = ::CellRanges( volume, m_bricked_buffer.brickSize(), grid );
+        m_brick_occupancy_changed = true;
+    }
+    else
+    {
+        m_bricked_buffer.release();
+        if ( volume->veclen() == 3 )
+        {
+            this->create_vector_texture( volume );
+        }
+        else if ( !this->create_quantized_volume( volume ) )
+        {
+            m_volume_buffer.create( volume, this->transferFunction() );
+        }
+    }
+    if ( m_rectilinear ) { this->create_coord_inverse_textures( volume ); }
+    else { m_bounding_cube_buffer.create( volume ); }
 
     // Set uniform variables.
     const kvs::Vec3 r( volume->resolution() );
@@ -439,6 +1980,16 @@ void SSAOStochasticUniformGridRenderer::Engine::create_buffer_object(
                          volume->values().typeInfo()->typeName() );
     }
 
+    // The scalar value derived from the vector volume is normalized to [0,1]
+    // in the shader.
+    if ( m_vector_texture.isCreated() )
+    {
+        min_range = 0.0f;
+        max_range = 1.0f;
+        min_value = 0.0f;
+        max_value = 1.0f;
+    }
+
     auto& geom_pass = m_render_pass.shaderProgram();
     kvs::ProgramObject::Binder bind( geom_pass );
     geom_pass.setUniform( "volume.resolution", r );
@@ -448,6 +1999,129 @@ void SSAOStochasticUniformGridRenderer::Engine::create_buffer_object(
     geom_pass.setUniform( "volume.max_range", max_range );
     geom_pass.setUniform( "transfer_function.min_value", min_value );
     geom_pass.setUniform( "transfer_function.max_value", max_value );
+    geom_pass.setUniform( "dequantization_table_size", static_cast<float>( m_dequantization_texture.width() ) );
+    geom_pass.setUniform( "rectilinear", m_rectilinear ? 1 : 0 );
+    geom_pass.setUniform( "box_min", m_box_min );
+    geom_pass.setUniform( "box_max", m_box_max );
+    if ( m_rectilinear )
+    {
+        const kvs::Vec3 table_size(
+            m_coord_inverse_textures[0].width(),
+            m_coord_inverse_textures[1].width(),
+            m_coord_inverse_textures[2].width() );
+        geom_pass.setUniform( "coord_table_size", table_size );
+    }
+    m_value_range = kvs::Vec2( min_value, max_value );
+
+    // Build the macro cells for the uploaded volume
+    m_macro_cell_ranges.release();
+    if ( m_enable_empty_space_skipping ) { this->create_macro_cells( volume ); }
+
+    // Compute the gradient for the uploaded volume
+    m_gradient_texture.release();
+    if ( m_enable_gradient_volume && !m_bricked_buffer.isCreated() ) { this->create_gradient_texture( volume ); }
+
+    // Build the coarse levels for the uploaded volume
+    m_multiresolution_buffer.release();
+    if ( m_enable_multiresolution ) { this->create_multiresolution_buffer( volume ); }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates the volume texture of the quantized float volume.
+ *  @param  volume [in] pointer to the structured volume object
+ *  @return true if the quantized volume is created
+ *
+ *  The codes are uploaded as the normalized 8-bit or 16-bit texture, so that
+ *  the linear codes are dequantized by the min/max range of the float volume
+ *  in the volume parameter. The dequantization table is created only for the
+ *  histogram-equalized codes.
+ */
+/*===========================================================================*/
+bool SSAOStochasticUniformGridRenderer::Engine::create_quantized_volume(
+    const kvs::StructuredVolumeObject* volume )
+{
+    m_dequantization_texture.release();
+    if ( m_quantization_bits == 0 || volume->veclen() != 1 ) { return false; }
+
+    const bool equalized = m_enable_histogram_equalization;
+    const bool bits8 = m_quantization_bits == 8;
+    kvs::ValueArray<kvs::Real32> table;
+    kvs::AnyValueArray values;
+    const std::type_info& type = volume->values().typeInfo()->type();
+    if ( type == typeid( kvs::Real32 ) )
+    {
+        if ( bits8 ) { values = kvs::AnyValueArray( ::QuantizedValues<kvs::Real32,kvs::UInt8>( volume, equalized, table ) ); }
+        else { values = kvs::AnyValueArray( ::QuantizedValues<kvs::Real32,kvs::UInt16>( volume, equalized, table ) ); }
+    }
+    else if ( type == typeid( kvs::Real64 ) )
+    {
+        if ( bits8 ) { values = kvs::AnyValueArray( ::QuantizedValues<kvs::Real64,kvs::UInt8>( volume, equalized, table ) ); }
+        else { values = kvs::AnyValueArray( ::QuantizedValues<kvs::Real64,kvs::UInt16>( volume, equalized, table ) ); }
+    }
+    else
+    {
+        // The integer volumes are uploaded as they are.
+        return false;
+    }
+
+    kvs::StructuredVolumeObject quantized;
+    quantized.setGridTypeToUniform();
+    quantized.setVeclen( 1 );
+    quantized.setResolution( volume->resolution() );
+    quantized.setValues( values );
+    quantized.setMinMaxValues( 0.0, bits8 ? 255.0 : 65535.0 );
+    m_volume_buffer.create( &quantized, this->transferFunction() );
+
+    if ( table.size() > 0 )
+    {
+        m_dequantization_texture.setWrapS( GL_CLAMP_TO_EDGE );
+        m_dequantization_texture.setMagFilter( GL_LINEAR );
+        m_dequantization_texture.setMinFilter( GL_LINEAR );
+        m_dequantization_texture.setPixelFormat( GL_ALPHA32F_ARB, GL_ALPHA, GL_FLOAT );
+        m_dequantization_texture.create( table.size(), table.data() );
+    }
+
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates the vector volume texture.
+ *  @param  volume [in] pointer to the structured volume object (veclen = 3)
+ *
+ *  The texture has four 16-bit channels instead of three, so that each row
+ *  of the texels is aligned to four bytes.
+ */
+/*===========================================================================*/
+void SSAOStochasticUniformGridRenderer::Engine::create_vector_texture(
+    const kvs::StructuredVolumeObject* volume )
+{
+    kvs::ValueArray<kvs::UInt16> texels;
+    const std::type_info& type = volume->values().typeInfo()->type();
+    if ( type == typeid( kvs::UInt8 ) ) { texels = ::VectorTexels<kvs::UInt8>( volume, m_vector_scale, m_vector_ranges ); }
+    else if ( type == typeid( kvs::Int8 ) ) { texels = ::VectorTexels<kvs::Int8>( volume, m_vector_scale, m_vector_ranges ); }
+    else if ( type == typeid( kvs::UInt16 ) ) { texels = ::VectorTexels<kvs::UInt16>( volume, m_vector_scale, m_vector_ranges ); }
+    else if ( type == typeid( kvs::Int16 ) ) { texels = ::VectorTexels<kvs::Int16>( volume, m_vector_scale, m_vector_ranges ); }
+    else if ( type == typeid( kvs::UInt32 ) ) { texels = ::VectorTexels<kvs::UInt32>( volume, m_vector_scale, m_vector_ranges ); }
+    else if ( type == typeid( kvs::Int32 ) ) { texels = ::VectorTexels<kvs::Int32>( volume, m_vector_scale, m_vector_ranges ); }
+    else if ( type == typeid( kvs::Real32 ) ) { texels = ::VectorTexels<kvs::Real32>( volume, m_vector_scale, m_vector_ranges ); }
+    else if ( type == typeid( kvs::Real64 ) ) { texels = ::VectorTexels<kvs::Real64>( volume, m_vector_scale, m_vector_ranges ); }
+    else
+    {
+        kvsMessageError( "Not supported data type '%s'.",
+                         volume->values().typeInfo()->typeName() );
+        return;
+    }
+
+    const kvs::Vec3ui r = volume->resolution();
+    m_vector_texture.setWrapS( GL_CLAMP_TO_EDGE );
+    m_vector_texture.setWrapT( GL_CLAMP_TO_EDGE );
+    m_vector_texture.setWrapR( GL_CLAMP_TO_EDGE );
+    m_vector_texture.setMagFilter( GL_LINEAR );
+    m_vector_texture.setMinFilter( GL_LINEAR );
+    m_vector_texture.setPixelFormat( GL_RGBA16, GL_RGBA, GL_UNSIGNED_SHORT );
+    m_vector_texture.create( r.x(), r.y(), r.z(), texels.data() );
 }
 
 void SSAOStochasticUniformGridRenderer::Engine::update_buffer_object(
@@ -455,6 +2129,10 @@ void SSAOStochasticUniformGridRenderer::Engine::update_buffer_object(
 {
     m_volume_buffer.release();
     m_bounding_cube_buffer.release();
+    m_bricked_buffer.release();
+    m_vector_texture.release();
+    for ( auto& texture : m_coord_inverse_textures ) { texture.release(); }
+    m_time_step_uploaded = false;
     this->create_buffer_object( volume );
 }
 
@@ -466,14 +2144,85 @@ void SSAOStochasticUniformGridRenderer::Engine::draw_buffer_object(
     const float offset_x = static_cast<float>( ( count ) % size );
     const float offset_y = static_cast<float>( ( count / size ) % size );
     const kvs::Vec2 random_offset( offset_x, offset_y );
-    m_render_pass.shaderProgram().setUniform( "random_offset", random_offset );
-
-    kvs::Texture::Binder unit0( m_volume_buffer.manager(), 0 );
-    kvs::Texture::Binder unit1( m_exit_texture, 1 );
-    kvs::Texture::Binder unit2( m_entry_texture, 2 );
-    kvs::Texture::Binder unit3( m_transfer_function_texture, 3 );
-    kvs::Texture::Binder unit4( BaseClass::randomTexture(), 4 );
-    m_volume_buffer.draw();
+    auto& geom_pass = m_render_pass.shaderProgram();
+    geom_pass.setUniform( "random_offset", random_offset );
+    geom_pass.setUniform( "render_mode", static_cast<int>( BaseClass::renderMode() ) );
+
+    // The coarse level is drawn instead of the full resolution volume while
+    // the scene is moving. The bricks, the macro cells and the precomputed
+    // gradient are given at the full resolution, so that they are not used
+    // for the coarse level.
+    // The time step texture has only the normalized values of the current time
+    // step, so that the data derived from the first time step are not used.
+    const bool time_series = m_time_step_uploaded;
+    size_t level = 0;
+    if ( m_enable_multiresolution && m_multiresolution_buffer.isCreated() && BaseClass::isInteractive() && !time_series )
+    {
+        level = kvs::Math::Min( m_coarse_level, m_multiresolution_buffer.numberOfLevels() - 1 );
+    }
+    const bool coarse = level > 0;
+    const bool bricked = m_bricked_buffer.isCreated() && !coarse && !time_series;
+    const bool skipping = m_enable_empty_space_skipping && !coarse;
+    const bool gradient = m_gradient_texture.isCreated() && !coarse && !time_series;
+    const bool dequantized = m_dequantization_texture.isCreated() && !coarse && !time_series;
+    const kvs::Vec3ui lod_resolution = coarse ? m_multiresolution_buffer.resolution( level ) : volume->resolution();
+    geom_pass.setUniform( "lod_scale", 1.0f / static_cast<float>( size_t( 1 ) << level ) );
+    geom_pass.setUniform( "lod_resolution", kvs::Vec3( lod_resolution ) );
+    geom_pass.setUniform( "bricking", bricked ? 1 : 0 );
+    geom_pass.setUniform( "empty_space_skipping", skipping ? 1 : 0 );
+    geom_pass.setUniform( "gradient_volume", gradient ? 1 : 0 );
+    geom_pass.setUniform( "dequantization", dequantized ? 1 : 0 );
+
+    // The depth of the geometry is given by the compositor.
+    const kvs::Texture2D* geometry_depth = m_enable_geometry_clipping ? BaseClass::geometryDepthTexture() : nullptr;
+    geom_pass.setUniform( "geometry_clipping", geometry_depth ? 1 : 0 );
+    if ( geometry_depth )
+    {
+        const kvs::Vec2 size( geometry_depth->width(), geometry_depth->height() );
+        geom_pass.setUniform( "geometry_depth_size", size );
+    }
+
+    // The textures are bound only if they are used in the current settings.
+    std::vector<std::pair<GLint,const kvs::Texture*>> textures;
+    if ( coarse ) { textures.emplace_back( 0, &m_multiresolution_buffer.texture( level ) ); }
+    else if ( time_series ) { textures.emplace_back( 0, &m_time_step_textures[ m_front_texture ] ); }
+    else if ( m_vector_texture.isCreated() ) { textures.emplace_back( 0, &m_vector_texture ); }
+    else if ( !bricked ) { textures.emplace_back( 0, &m_volume_buffer.manager() ); }
+    if ( !this->is_analytic_entry_exit() )
+    {
+        textures.emplace_back( 1, &m_exit_texture );
+        textures.emplace_back( 2, &m_entry_texture );
+    }
+    textures.emplace_back( 3, &m_transfer_function_texture );
+    textures.emplace_back( 4, &BaseClass::randomTexture() );
+    if ( m_enable_preintegration ) { textures.emplace_back( 5, &m_preintegration_texture ); }
+    if ( skipping ) { textures.emplace_back( 6, &m_occupancy_texture ); }
+    if ( gradient ) { textures.emplace_back( 7, &m_gradient_texture ); }
+    if ( dequantized ) { textures.emplace_back( 10, &m_dequantization_texture ); }
+    if ( geometry_depth ) { textures.emplace_back( 11, geometry_depth ); }
+    if ( m_rectilinear )
+    {
+        textures.emplace_back( 12, &m_coord_inverse_textures[0] );
+        textures.emplace_back( 13, &m_coord_inverse_textures[1] );
+        textures.emplace_back( 14, &m_coord_inverse_textures[2] );
+    }
+    if ( bricked )
+    {
+        textures.emplace_back( 8, &m_bricked_buffer.atlasTexture() );
+        textures.emplace_back( 9, &m_bricked_buffer.pageTableTexture() );
+    }
+
+    // The textures are unbound when the binders go out of scope.
+    std::vector<std::unique_ptr<kvs::Texture::Binder>> binders;
+    binders.reserve( textures.size() );
+    for ( const auto& texture : textures )
+    {
+        binders.emplace_back( new kvs::Texture::Binder( *texture.second, texture.first ) );
+    }
+    kvs::OpenGL::ActivateTextureUnit( 0 );
+
+    if ( m_bricked_buffer.isCreated() || m_vector_texture.isCreated() || m_rectilinear ) { ::DrawBoundingBox( m_box_min, m_box_max ); }
+    else { m_volume_buffer.draw(); }
 }
 
 } // end of namespace AmbientOcclusionRendering
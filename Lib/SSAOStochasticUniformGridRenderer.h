@@ -5,6 +5,9 @@
  */
 /*****************************************************************************/
 #pragma once
+#include <string>
+#include <vector>
+#include <future>
 #include <kvs/Module>
 #include <kvs/ProgramObject>
 #include <kvs/VertexBufferObjectManager>
@@ -12,11 +15,16 @@
 #include <kvs/Texture2D>
 #include <kvs/Texture3D>
 #include <kvs/TransferFunction>
+#include <kvs/ValueArray>
+#include <kvs/Math>
 #include <kvs/StructuredVolumeObject>
 #include <kvs/StochasticRenderingEngine>
 #include <kvs/StochasticRendererBase>
 #include <kvs/RayCastingRenderer>
 #include "SSAOStochasticRendererBase.h"
+#include "SSAOStochasticRenderingEngine.h"
+#include "BrickedVolumeBuffer.h"
+#include "MultiresolutionVolumeBuffer.h"
 
 
 namespace AmbientOcclusionRendering
@@ -35,6 +43,16 @@ class SSAOStochasticUniformGridRenderer : public SSAOStochasticRendererBase
 public:
     class Engine;
 
+    /*  Scalar value derived from the vector volume (veclen = 3) in the shader.
+     */
+    enum VectorMode
+    {
+        Magnitude = 0, ///< magnitude of the vector (default)
+        XComponent = 1, ///< x component
+        YComponent = 2, ///< y component
+        ZComponent = 3 ///< z component
+    };
+
 public:
     SSAOStochasticUniformGridRenderer();
     virtual ~SSAOStochasticUniformGridRenderer() {}
@@ -42,8 +60,42 @@ public:
     void setEdgeFactor( const float factor );
     void setSamplingStep( const float step );
     void setTransferFunction( const kvs::TransferFunction& transfer_function );
+    void setPreIntegrationEnabled( const bool enabled = true );
+    void setEmptySpaceSkippingEnabled( const bool enabled = true );
+    void setMacroCellSize( const size_t size );
+    void setAnalyticEntryExitEnabled( const bool enabled = true );
+    void setGradientVolumeEnabled( const bool enabled = true );
+    void setBrickingEnabled( const bool enabled = true );
+    void setBrickSize( const size_t size );
+    void setBrickMemoryBudget( const size_t bytes );
+    void setMultiresolutionEnabled( const bool enabled = true );
+    void setCoarseLevel( const size_t level );
+    void setQuantizationBits( const size_t bits );
+    void setHistogramEqualizationEnabled( const bool enabled = true );
+    void setGeometryClippingEnabled( const bool enabled = true );
+    void setVectorMode( const VectorMode mode );
+    void setTimeSeries( const std::vector<std::string>& filenames );
+    void setTimeStep( const size_t step );
+    void setPlaybackEnabled( const bool enabled = true );
     const kvs::TransferFunction& transferFunction() const;
     float samplingStep() const;
+    bool isPreIntegrationEnabled() const;
+    bool isEmptySpaceSkippingEnabled() const;
+    size_t macroCellSize() const;
+    bool isAnalyticEntryExitEnabled() const;
+    bool isGradientVolumeEnabled() const;
+    bool isBrickingEnabled() const;
+    size_t brickSize() const;
+    size_t brickMemoryBudget() const;
+    bool isMultiresolutionEnabled() const;
+    size_t coarseLevel() const;
+    size_t quantizationBits() const;
+    bool isHistogramEqualizationEnabled() const;
+    bool isGeometryClippingEnabled() const;
+    VectorMode vectorMode() const;
+    size_t numberOfTimeSteps() const;
+    size_t timeStep() const;
+    bool isPlaybackEnabled() const;
 };
 
 /*===========================================================================*/
@@ -51,10 +103,10 @@ public:
  *  @brief  Engine class for stochastic uniform grid renderer.
  */
 /*===========================================================================*/
-class SSAOStochasticUniformGridRenderer::Engine : public kvs::StochasticRenderingEngine
+class SSAOStochasticUniformGridRenderer::Engine : public SSAOStochasticRenderingEngine
 {
 public:
-    using BaseClass = kvs::StochasticRenderingEngine;
+    using BaseClass = SSAOStochasticRenderingEngine;
     using BufferObject = kvs::glsl::RayCastingRenderer::BufferObject;
     using RenderPass = kvs::glsl::RayCastingRenderer::RenderPass;
     using BoundingBufferObject = kvs::glsl::RayCastingRenderer::BoundingBufferObject;
@@ -70,10 +122,82 @@ private:
     kvs::TransferFunction m_transfer_function{}; ///< transfer function
     kvs::Texture1D m_transfer_function_texture{}; ///< transfer function texture
 
-    // Exit/entry framebuffer
+    // Pre-integrated transfer function
+    bool m_enable_preintegration = false; ///< flag for the pre-integrated transfer function
+    bool m_preintegration_changed = true; ///< flag for changing pre-integration table
+    float m_preintegration_step = 0.0f; ///< sampling step of the pre-integration table
+    kvs::Texture2D m_preintegration_texture{}; ///< pre-integrated transfer function texture
+
+    // Empty space skipping
+    bool m_enable_empty_space_skipping = false; ///< flag for the empty space skipping
+    bool m_occupancy_changed = true; ///< flag for changing occupancy of the macro cells
+    size_t m_macro_cell_size = 8; ///< size of the macro cell in voxels
+    kvs::Vec3ui m_macro_grid_resolution{}; ///< number of the macro cells
+    kvs::ValueArray<kvs::Real32> m_macro_cell_ranges{}; ///< min/max scalar values of the macro cells
+    kvs::Vec2 m_value_range{}; ///< scalar range mapped to the transfer function
+    kvs::Texture3D m_occupancy_texture{}; ///< occupancy of the macro cells
+
+    // Precomputed gradient
+    bool m_enable_gradient_volume = false; ///< flag for the precomputed gradient
+    kvs::Texture3D m_gradient_texture{}; ///< precomputed gradient texture
+
+    // Bricked volume
+    bool m_enable_bricking = false; ///< flag for the bricked volume
+    bool m_brick_occupancy_changed = true; ///< flag for changing occupancy of the bricks
+    kvs::ValueArray<kvs::Real32> m_brick_ranges{}; ///< min/max scalar values of the bricks
+    BrickedVolumeBuffer m_bricked_buffer{}; ///< bricked volume buffer
+
+    // Multiresolution volume
+    bool m_enable_multiresolution = false; ///< flag for the multiresolution volume
+    size_t m_coarse_level = 1; ///< level drawn while the scene is moving
+    MultiresolutionVolumeBuffer m_multiresolution_buffer{}; ///< coarse levels of the volume
+
+    // Quantized volume
+    size_t m_quantization_bits = 0; ///< bits of the quantized float volume (0: not quantized)
+    bool m_enable_histogram_equalization = false; ///< flag for the histogram-equalized quantization
+    kvs::Texture1D m_dequantization_texture{}; ///< dequantization table of the equalized codes
+
+    // Geometry clipping
+    bool m_enable_geometry_clipping = false; ///< flag for clipping the rays at the geometry depth
+
+    // Vector volume
+    VectorMode m_vector_mode = Magnitude; ///< scalar value derived from the vector volume
+    float m_vector_scale = 1.0f; ///< maximum absolute component of the vector volume
+    kvs::Vec2 m_vector_ranges[4]; ///< ranges of the magnitude and the components
+    kvs::Texture3D m_vector_texture{}; ///< vector volume texture (normalized components in RGB)
+
+    // Rectilinear grid
+    bool m_rectilinear = false; ///< flag for the rectilinear grid
+    kvs::Vec3 m_box_min{}; ///< minimum corner of the bounding box in the object coordinates
+    kvs::Vec3 m_box_max{}; ///< maximum corner of the bounding box in the object coordinates
+    float m_min_spacing = 1.0f; ///< minimum grid spacing of the rectilinear grid
+    kvs::Texture1D m_coord_inverse_textures[3]; ///< inverse coordinate tables (object coord. to index) for each axis
+
+    // Time series
+    struct TimeStep
+    {
+        size_t index = 0; ///< time step
+        kvs::ValueArray<kvs::UInt16> values{}; ///< normalized values (empty if not loaded)
+        size_t macro_cell_size = 0; ///< size of the macro cells
+        kvs::Vec3ui macro_grid_resolution{}; ///< number of the macro cells
+        kvs::ValueArray<kvs::Real32> macro_cell_ranges{}; ///< min/max values of the macro cells
+    };
+    std::vector<std::string> m_time_series{}; ///< filenames of the time steps
+    size_t m_time_step = 0; ///< displayed time step
+    size_t m_next_time_step = 0; ///< time step to be displayed next
+    bool m_time_step_requested = false; ///< flag for requesting the next time step
+    bool m_enable_playback = false; ///< flag for the playback of the time series
+    std::future<TimeStep> m_prefetch{}; ///< time step decoded in the background
+    kvs::Texture3D m_time_step_textures[2]; ///< double-buffered textures of the time steps
+    size_t m_front_texture = 0; ///< index of the texture of the displayed time step
+    bool m_time_step_uploaded = false; ///< flag for drawing the time step texture
+
+    // Exit/entry framebuffer (not used for the analytic entry/exit points)
+    bool m_enable_analytic_entry_exit = false; ///< flag for the analytic entry/exit points
     kvs::FrameBufferObject m_entry_exit_framebuffer{}; ///< framebuffer object for entry/exit point texture
     kvs::Texture2D m_entry_texture{}; ///< entry point texture
     kvs::Texture2D m_exit_texture{}; ///< exit point texture
+    float m_framebuffer_scale = 1.0f; ///< render scale of the entry/exit framebuffer
 
     // Buffer objects and render passes
     BufferObject m_volume_buffer{}; ///< volume buffer object
@@ -90,6 +214,7 @@ public:
     void update( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
     void setup( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
     void draw( kvs::ObjectBase* object, kvs::Camera* camera, kvs::Light* light );
+    void resize( kvs::Camera* camera );
 
     void setEdgeFactor( const float factor ) { m_edge_factor = factor; }
     void setSamplingStep( const float step ) { m_step = step; }
@@ -97,14 +222,76 @@ public:
     {
         m_transfer_function = transfer_function;
         m_transfer_function_changed = true;
+        m_preintegration_changed = true;
+        m_occupancy_changed = true;
+        m_brick_occupancy_changed = true;
     }
+    void setPreIntegrationEnabled( const bool enabled = true ) { m_enable_preintegration = enabled; }
+    void setEmptySpaceSkippingEnabled( const bool enabled = true ) { m_enable_empty_space_skipping = enabled; }
+    void setMacroCellSize( const size_t size )
+    {
+        const size_t s = kvs::Math::Max( size, size_t( 2 ) );
+        if ( s != m_macro_cell_size ) { m_macro_cell_ranges.release(); }
+        m_macro_cell_size = s;
+    }
+    void setAnalyticEntryExitEnabled( const bool enabled = true ) { m_enable_analytic_entry_exit = enabled; }
+    void setGradientVolumeEnabled( const bool enabled = true ) { m_enable_gradient_volume = enabled; }
+    void setBrickingEnabled( const bool enabled = true ) { m_enable_bricking = enabled; }
+    void setBrickSize( const size_t size ) { m_bricked_buffer.setBrickSize( kvs::Math::Max( size, size_t( 2 ) ) ); }
+    void setBrickMemoryBudget( const size_t bytes ) { m_bricked_buffer.setMemoryBudget( bytes ); }
+    void setMultiresolutionEnabled( const bool enabled = true ) { m_enable_multiresolution = enabled; }
+    void setCoarseLevel( const size_t level ) { m_coarse_level = kvs::Math::Max( level, size_t( 1 ) ); }
+    void setQuantizationBits( const size_t bits ) { m_quantization_bits = bits == 0 ? 0 : bits <= 8 ? 8 : 16; }
+    void setHistogramEqualizationEnabled( const bool enabled = true ) { m_enable_histogram_equalization = enabled; }
+    void setGeometryClippingEnabled( const bool enabled = true ) { m_enable_geometry_clipping = enabled; }
+    void setVectorMode( const VectorMode mode ) { m_vector_mode = mode; }
+    void setTimeSeries( const std::vector<std::string>& filenames );
+    void setTimeStep( const size_t step )
+    {
+        if ( step >= m_time_series.size() ) { return; }
+        m_next_time_step = step;
+        m_time_step_requested = true;
+    }
+    void setPlaybackEnabled( const bool enabled = true ) { m_enable_playback = enabled; }
 
     float samplingStep() const { return m_step; }
+    bool isPreIntegrationEnabled() const { return m_enable_preintegration; }
+    bool isEmptySpaceSkippingEnabled() const { return m_enable_empty_space_skipping; }
+    bool isAnalyticEntryExitEnabled() const { return m_enable_analytic_entry_exit; }
+    bool isGradientVolumeEnabled() const { return m_enable_gradient_volume; }
+    bool isBrickingEnabled() const { return m_enable_bricking; }
+    size_t brickSize() const { return m_bricked_buffer.brickSize(); }
+    size_t brickMemoryBudget() const { return m_bricked_buffer.memoryBudget(); }
+    bool isMultiresolutionEnabled() const { return m_enable_multiresolution; }
+    size_t coarseLevel() const { return m_coarse_level; }
+    size_t quantizationBits() const { return m_quantization_bits; }
+    bool isHistogramEqualizationEnabled() const { return m_enable_histogram_equalization; }
+    bool isGeometryClippingEnabled() const { return m_enable_geometry_clipping; }
+    bool isGeometryDepthRequired() const { return m_enable_geometry_clipping; }
+    bool isRectilinear() const { return m_rectilinear; }
+    VectorMode vectorMode() const { return m_vector_mode; }
+    size_t numberOfTimeSteps() const { return m_time_series.size(); }
+    size_t timeStep() const { return m_time_step; }
+    bool isPlaybackEnabled() const { return m_enable_playback; }
+    size_t macroCellSize() const { return m_macro_cell_size; }
     const kvs::TransferFunction& transferFunction() const { return m_transfer_function; }
 
 private:
+    bool is_analytic_entry_exit() const { return m_enable_analytic_entry_exit || m_rectilinear; }
+    void setup_grid( const kvs::StructuredVolumeObject* volume );
+    void create_coord_inverse_textures( const kvs::StructuredVolumeObject* volume );
+
     void create_transfer_function_texture();
     void update_transfer_function_texture();
+    void update_preintegration_texture();
+    void create_macro_cells( const kvs::StructuredVolumeObject* volume );
+    void update_occupancy_texture();
+    void create_gradient_texture( const kvs::StructuredVolumeObject* volume );
+    void create_multiresolution_buffer( const kvs::StructuredVolumeObject* volume );
+    void update_time_series( const kvs::StructuredVolumeObject* volume );
+    void prefetch_time_step( const kvs::StructuredVolumeObject* volume, const size_t step );
+    void upload_time_step( const kvs::StructuredVolumeObject* volume, const TimeStep& step );
+    void wait_time_step();
 
     void create_shader_program( const kvs::StructuredVolumeObject* volume );
     void update_shader_program( const kvs::StructuredVolumeObject* volume );
@@ -118,6 +305,8 @@ private:
     void update_framebuffer( const size_t width, const size_t height );
 
     void create_buffer_object( const kvs::StructuredVolumeObject* volume );
+    bool create_quantized_volume( const kvs::StructuredVolumeObject* volume );
+    void create_vector_texture( const kvs::StructuredVolumeObject* volume );
     void update_buffer_object( const kvs::StructuredVolumeObject* volume );
     void draw_buffer_object( const kvs::StructuredVolumeObject* volume );
 };
@@ -39,9 +39,13 @@ public:
 
     void setKernelRadius( const float radius ) { m_ao_buffer.setKernelRadius( radius ); }
     void setKernelSize( const size_t nsamples ) { m_ao_buffer.setKernelSize( nsamples ); }
+    void setKernelBias( const float bias ) { m_ao_buffer.setKernelBias( bias ); }
+    void setIntensity( const float intensity ) { m_ao_buffer.setIntensity( intensity ); }
     void setDrawingOcclusionFactorEnabled( const bool enabled = true ) { m_ao_buffer.setDrawingOcclusionFactorEnabled( enabled ); }
     kvs::Real32 kernelRadius() const { return m_ao_buffer.kernelRadius(); }
     size_t kernelSize() const { return m_ao_buffer.kernelSize(); }
+    float kernelBias() const { return m_ao_buffer.kernelBias(); }
+    float intensity() const { return m_ao_buffer.intensity(); }
 
     KVS_DEPRECATED( void setSamplingSphereRadius( const float radius ) ) { this->setKernelRadius( radius ); }
     KVS_DEPRECATED( void setNumberOfSamplingPoints( const size_t nsamples ) ) { this->setKernelSize( nsamples ); }
@@ -16,6 +16,7 @@
 #include "shading.h"
 #include "qualifire.h"
 #include "texture.h"
+#include "weighted_blended.h"
 
 
 // Input parameters from vertex shader
@@ -29,6 +30,9 @@ uniform float random_texture_size_inv; // reciprocal value of the random texture
 uniform vec2 random_offset; // offset values for accessing to the random texture
 uniform ShadingParameter shading; // shading parameters
 uniform float edge_factor; // edge enhacement factor
+uniform float opacity_scale; // opacity scale for the primitive subsampling
+uniform int render_mode; // 0: stochastic, 1: nearest layer, 2: weighted blended OIT
+uniform float object_opacity; // opacity of the object (negative: per-vertex opacity)
 
 /*===========================================================================*/
 /**
@@ -52,7 +56,7 @@ vec2 RandomIndex( in vec2 p )
 void main()
 {
     vec3 color = gl_Color.rgb;
-    float alpha = gl_Color.a;
+    float alpha = object_opacity < 0.0 ? gl_Color.a : object_opacity;
     if ( alpha == 0.0 ) { discard; return; }
 
     // Edge enhancement
@@ -63,11 +67,26 @@ void main()
         alpha = min( 1.0, alpha / pow( abs( dot( N, E ) ), edge_factor ) );
     }
 
+    // Compensate for the primitives skipped by the subsampling
+    alpha = min( 1.0, alpha * opacity_scale );
+
+    // Weighted color and revealage accumulation
+    if ( render_mode == 2 )
+    {
+        float w = BlendingWeight( position.z, alpha );
+        gl_FragData[0] = vec4( color * alpha * w, alpha );
+        gl_FragData[1] = vec4( alpha * w, 0.0, 0.0, 0.0 );
+        return;
+    }
+
     // Stochastic color assignment
-    float R = LookupTexture2D( random_texture, RandomIndex( gl_FragCoord.xy ) ).a;
-    if ( R > alpha ) { discard; return; }
+    if ( render_mode == 0 )
+    {
+        float R = LookupTexture2D( random_texture, RandomIndex( gl_FragCoord.xy ) ).a;
+        if ( R > alpha ) { discard; return; }
+    }
 
-    gl_FragData[0] = gl_Color;
+    gl_FragData[0] = vec4( color, alpha );
     gl_FragData[1] = vec4( position.xyz, 1.0 );
     gl_FragData[2] = vec4( normal, 1.0 );
 }
@@ -0,0 +1,58 @@
+/*****************************************************************************/
+/**
+ *  @file   SSAO_SR_tetrahedra_cached_pass.vert
+ */
+/*****************************************************************************/
+#version 120
+#extension GL_EXT_gpu_shader4 : enable
+#include <qualifire.h>
+
+
+// Input variables from the decomposition cache (captured by the transform
+// feedback of the geometry shader).
+VertIn vec4 clip_position_in; // vertex position in clip coordinate (w = 1)
+VertIn vec3 position_in; // 3D vertex position in camera coordinate
+VertIn vec3 normal_in; // normal vector in camera coordinate
+VertIn vec2 random_index_in; // index for accessing to the random texture
+VertIn vec2 position_ndc_in; // 2D vertex position in normalized device coordinate
+VertIn vec2 scalar_in; // scalar values on the front and back faces
+VertIn vec2 depth_in; // depth values at the front and back faces
+VertIn vec2 wc_inv_in; // reciprocal values of the w-component at the front and back faces
+
+// Output variables to fragment shader.
+noperspective VertOut vec3 position; // 3D vertex position in camera coordinate
+noperspective VertOut vec3 normal; // normal vector in camera coordinate
+noperspective VertOut vec2 random_index; // index for accessing to the random texture
+noperspective VertOut vec2 position_ndc; // 2D vertex position in normalized device coordinate
+noperspective VertOut float scalar_front; // scalar value on the front face
+noperspective VertOut float scalar_back; // scalar value on the back face
+noperspective VertOut float depth_front; // depth value at the front face
+noperspective VertOut float depth_back; // depth value at the back face
+noperspective VertOut float wc_inv_front; // reciprocal value of the w-component at the front face in clip coordinate
+noperspective VertOut float wc_inv_back; // reciprocal value of the w-component at the back face in clip coordinate
+
+
+/*===========================================================================*/
+/**
+ *  @brief  Main function of vertex shader.
+ *
+ *  The vertices have been projected and decomposed by the geometry shader of
+ *  the tetrahedra geometry pass, so that they are passed through as they are.
+ */
+/*===========================================================================*/
+void main()
+{
+    gl_Position = clip_position_in;
+
+    position = position_in;
+    normal = normal_in;
+    random_index = random_index_in;
+    position_ndc = position_ndc_in;
+
+    scalar_front = scalar_in.x;
+    scalar_back = scalar_in.y;
+    depth_front = depth_in.x;
+    depth_back = depth_in.y;
+    wc_inv_front = wc_inv_in.x;
+    wc_inv_back = wc_inv_in.y;
+}
@@ -16,6 +16,7 @@
 #include <shading.h>
 #include <qualifire.h>
 #include <texture.h>
+#include <weighted_blended.h>
 
 
 // Input variables from geometry shader
@@ -45,6 +46,7 @@ uniform float delta;
 uniform float delta2;
 uniform ShadingParameter shading; // shading parameters
 uniform float edge_factor; // edge enhacement factor
+uniform int render_mode; // 0: stochastic, 1: nearest layer, 2: weighted blended OIT
 
 // Uniform variables (OpenGL variables).
 uniform mat4 ModelViewProjectionMatrixInverse; // inverse matrix of model-view projection matrix
@@ -138,8 +140,19 @@ void main()
     }
     trans = 1.0 - alpha;
 
-    // Stochastic color assignment.
-    float R = RandomNumber();
+    // Weighted color and revealage accumulation with the color at the middle
+    if ( render_mode == 2 )
+    {
+        vec3 c = LookupTexture1D( transfer_function_texture, ADJUST( 0.5 * ( Sf + Sb ) ) ).rgb;
+        float w = BlendingWeight( position.z, alpha );
+        gl_FragData[0] = vec4( c * alpha * w, alpha );
+        gl_FragData[1] = vec4( alpha * w, 0.0, 0.0, 0.0 );
+        return;
+    }
+
+    // Stochastic color assignment. The nearest layer is given by R = 1, which
+    // places the depth on the front face.
+    float R = render_mode == 1 ? 1.0 : RandomNumber();
     if ( R <= trans ) { discard; return; }
 
     // Depth calculation by inverse transformation sampling.
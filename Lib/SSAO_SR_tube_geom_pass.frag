@@ -16,6 +16,7 @@
 #include "shading.h"
 #include "qualifire.h"
 #include "texture.h"
+#include "weighted_blended.h"
 
 // Input parameters from vertex shader.
 FragIn vec3 position;
@@ -39,6 +40,8 @@ uniform sampler2D random_texture; // random texture to generate random number
 uniform float random_texture_size_inv; // reciprocal value of the random texture size
 uniform vec2 random_offset; // offset values for accessing to the random texture
 uniform float edge_factor; // edge enhancement factor
+uniform float opacity_scale; // opacity scale for the primitive subsampling
+uniform int render_mode; // 0: stochastic, 1: nearest layer, 2: weighted blended OIT
 
 /*===========================================================================*/
 /**
@@ -80,9 +83,15 @@ void main()
         alpha = min( 1.0, alpha / pow( abs( dot( N, E ) ), edge_factor ) );
     }
 
+    // Compensate for the lines skipped by the subsampling
+    alpha = min( 1.0, alpha * opacity_scale );
+
     // Stochastic color assignment.
-    float R = LookupTexture2D( random_texture, RandomIndex( gl_FragCoord.xy ) ).a;
-    if ( R > alpha ) { discard; return; }
+    if ( render_mode == 0 )
+    {
+        float R = LookupTexture2D( random_texture, RandomIndex( gl_FragCoord.xy ) ).a;
+        if ( R > alpha ) { discard; return; }
+    }
 
     vec4 color;
     if ( tcd.x < 0.0 || tcd.x > 1.0 )
@@ -94,10 +103,19 @@ void main()
         color = diffuse * LookupTexture2D( diffuse_texture, tcd.xy );
     }
 
+    vec2 rdep = tex.y * depth1 + ( 1.0 - tex.y ) * depth0;
+    gl_FragDepth = ( rdep.x / rdep.y ) * 0.5 + 0.5;
+
+    // Weighted color and revealage accumulation
+    if ( render_mode == 2 )
+    {
+        float w = BlendingWeight( position.z, alpha );
+        gl_FragData[0] = vec4( color.rgb * alpha * w, alpha );
+        gl_FragData[1] = vec4( alpha * w, 0.0, 0.0, 0.0 );
+        return;
+    }
+
     gl_FragData[0] = color;
     gl_FragData[1] = vec4( position.xyz, 1.0 );
     gl_FragData[2] = vec4( normal, 1.0 );
-
-    vec2 rdep = tex.y * depth1 + ( 1.0 - tex.y ) * depth0;
-    gl_FragDepth = ( rdep.x / rdep.y ) * 0.5 + 0.5;
 }
@@ -18,6 +18,7 @@
 #include "transfer_function.h"
 #include "qualifire.h"
 #include "texture.h"
+#include "weighted_blended.h"
 
 
 // Input parameters.
@@ -26,12 +27,45 @@ FragIn vec3 position_ndc;
 // Uniform parameters.
 uniform sampler2D entry_points; // entry points (front face)
 uniform sampler2D exit_points; // exit points (back face)
+uniform int analytic_entry_exit; // 1 if the entry/exit points are computed by ray-box intersection
+uniform sampler2D geometry_depth_texture; // depth of the geometry drawn before the volume
+uniform vec2 geometry_depth_size; // size of the geometry depth texture
+uniform int geometry_clipping; // 1 if the rays are clipped at the geometry depth
 uniform float sampling_step; // sampling step
 uniform VolumeParameter volume; // volume parameter
-uniform sampler3D volume_data; // volume data
+uniform vec3 box_min; // min. coordinate of the bounding box in object coordinate
+uniform vec3 box_max; // max. coordinate of the bounding box in object coordinate
+uniform int rectilinear; // 1 if the volume is given on the rectilinear grid
+uniform sampler1D coord_inverse_x; // grid index for the normalized x coordinate
+uniform sampler1D coord_inverse_y; // grid index for the normalized y coordinate
+uniform sampler1D coord_inverse_z; // grid index for the normalized z coordinate
+uniform vec3 coord_table_size; // sizes of the inverse coordinate tables
+uniform sampler3D volume_data; // volume data (or the coarse level of the volume)
+uniform float lod_scale; // ratio of the resolution of volume_data to the full resolution
+uniform vec3 lod_resolution; // resolution of volume_data
+uniform int dequantization; // 1 if volume_data has the histogram-equalized codes
+uniform sampler1D dequantization_table; // normalized value for each code
+uniform float dequantization_table_size; // size of the dequantization table
+uniform int vector_mode; // -1: scalar volume, 0: magnitude, 1-3: x, y or z component
+uniform float vector_scale; // maximum absolute component of the vector volume
+uniform vec2 vector_range; // range of the scalar derived from the vector volume
+uniform sampler3D gradient_texture; // precomputed gradient (normalized and packed to [0,1])
+uniform int gradient_volume; // 1 if the precomputed gradient is used
+uniform int bricking; // 1 if the bricked volume is used instead of volume_data
+uniform sampler3D brick_atlas; // brick atlas (normalized values)
+uniform sampler3D page_table; // slot (xyz) and residency (w) of each brick
+uniform float brick_size; // brick size in voxels (excluding the shared boundary)
+uniform vec3 brick_grid_resolution; // number of the bricks
+uniform vec3 brick_atlas_size; // atlas size in voxels
 uniform ShadingParameter shading; // shading parameter
 uniform TransferFunctionParameter transfer_function; // transfer function
 uniform sampler1D transfer_function_data; // 1D transfer function data
+uniform sampler2D preintegration_texture; // pre-integrated transfer function (front, back)
+uniform int preintegration; // 1 if the pre-integrated transfer function is used
+uniform sampler3D occupancy_texture; // occupancy of the macro cells
+uniform int empty_space_skipping; // 1 if the empty macro cells are skipped
+uniform float macro_cell_size; // size of the macro cell in voxels
+uniform vec3 macro_grid_resolution; // number of the macro cells
 uniform float width; // screen width
 uniform float height; // screen height
 uniform float to_zw1; // scaling parameter: (f*n)/(f-n)
@@ -42,8 +76,10 @@ uniform sampler2D random_texture; // random texture to generate random number
 uniform float random_texture_size_inv; // reciprocal value of the random texture size
 uniform vec2 random_offset; // offset values for accessing to the random texture
 uniform float edge_factor; // edge enhacement factor
+uniform int render_mode; // 0: stochastic, 1: nearest layer, 2: weighted blended OIT
 
 // Uniform variables (OpenGL variables).
+uniform mat4 ModelViewProjectionMatrix; // model-view projection matrix
 uniform mat4 ModelViewProjectionMatrixInverse; // inverse matrix of model-view projection matrix
 uniform mat4 ModelViewMatrix; // model-view matrix
 uniform mat3 NormalMatrix; // normal matrix
@@ -108,6 +144,244 @@ vec3 NDC2Obj( const in vec3 ndc )
     return temp.xyz / temp.w;
 }
 
+/*===========================================================================*/
+/**
+ *  @brief  Returns a depth value in window coordinate from object coordinate.
+ *  @param  p [in] coordinate in object coordinate
+ *  @return depth value in window coordinate
+ */
+/*===========================================================================*/
+float Obj2WindowDepth( const in vec3 p )
+{
+    vec4 temp = ModelViewProjectionMatrix * vec4( p, 1.0 );
+    return 0.5 * temp.z / temp.w + 0.5;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Computes the entry/exit points by the ray-box intersection.
+ *  @param  entry_point [out] entry point in object coordinate
+ *  @param  exit_point [out] exit point in object coordinate
+ *  @param  entry_depth [out] depth at the entry point in window coordinate
+ *  @param  exit_depth [out] depth at the exit point in window coordinate
+ *  @return false if the ray does not intersect the volume
+ *
+ *  The ray is limited between the near and far planes, so that the entry
+ *  point is on the near plane if the front of the volume is clipped.
+ */
+/*===========================================================================*/
+bool RayBoxIntersection(
+    out vec3 entry_point,
+    out vec3 exit_point,
+    out float entry_depth,
+    out float exit_depth )
+{
+    vec3 near_point = NDC2Obj( vec3( position_ndc.xy, -1.0 ) );
+    vec3 far_point = NDC2Obj( vec3( position_ndc.xy, 1.0 ) );
+    vec3 d = far_point - near_point;
+    if ( abs( d.x ) < 1.0e-8 ) { d.x = 1.0e-8; }
+    if ( abs( d.y ) < 1.0e-8 ) { d.y = 1.0e-8; }
+    if ( abs( d.z ) < 1.0e-8 ) { d.z = 1.0e-8; }
+
+    // Slab method for the bounding box of the volume.
+    vec3 t0 = ( box_min - near_point ) / d;
+    vec3 t1 = ( box_max - near_point ) / d;
+    vec3 tmin = min( t0, t1 );
+    vec3 tmax = max( t0, t1 );
+    float t_entry = max( 0.0, max( tmin.x, max( tmin.y, tmin.z ) ) );
+    float t_exit = min( 1.0, min( tmax.x, min( tmax.y, tmax.z ) ) );
+    if ( t_entry >= t_exit ) { return false; }
+
+    entry_point = near_point + t_entry * ( far_point - near_point );
+    exit_point = near_point + t_exit * ( far_point - near_point );
+    entry_depth = t_entry > 0.0 ? Obj2WindowDepth( entry_point ) : 0.0;
+    exit_depth = Obj2WindowDepth( exit_point );
+    return true;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the voxel coordinate of the point.
+ *  @param  p [in] point in object coordinate
+ *  @return voxel coordinate (fractional grid index)
+ *
+ *  The object coordinate is the voxel coordinate for the uniform grid. For
+ *  the rectilinear grid, each axis is mapped by the inverse coordinate table.
+ */
+/*===========================================================================*/
+vec3 VoxelPosition( in vec3 p )
+{
+    if ( rectilinear == 0 ) { return p; }
+
+    vec3 u = clamp( ( p - box_min ) / max( box_max - box_min, vec3( 1.0e-8 ) ), 0.0, 1.0 );
+    vec3 tc = ( u * ( coord_table_size - vec3( 1.0 ) ) + vec3( 0.5 ) ) / coord_table_size;
+    return vec3(
+        LookupTexture1D( coord_inverse_x, tc.x ).w,
+        LookupTexture1D( coord_inverse_y, tc.y ).w,
+        LookupTexture1D( coord_inverse_z, tc.z ).w );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the normal vector in object coordinate.
+ *  @param  N [in] normal vector in voxel coordinate
+ *  @param  p [in] point in object coordinate
+ *  @return normal vector in object coordinate
+ *
+ *  The gradient in voxel coordinate is scaled by the derivative of the voxel
+ *  coordinate, which is the reciprocal of the local grid spacing.
+ */
+/*===========================================================================*/
+vec3 ObjectNormal( in vec3 N, in vec3 p )
+{
+    if ( rectilinear == 0 || length( N ) == 0.0 ) { return N; }
+
+    vec3 h = ( box_max - box_min ) / coord_table_size;
+    vec3 dx = vec3( h.x, 0.0, 0.0 );
+    vec3 dy = vec3( 0.0, h.y, 0.0 );
+    vec3 dz = vec3( 0.0, 0.0, h.z );
+    vec3 scale = vec3(
+        VoxelPosition( p + dx ).x - VoxelPosition( p - dx ).x,
+        VoxelPosition( p + dy ).y - VoxelPosition( p - dy ).y,
+        VoxelPosition( p + dz ).z - VoxelPosition( p - dz ).z ) / ( 2.0 * h );
+    vec3 n = N * scale;
+    return length( n ) > 0.0 ? normalize( n ) : N;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the normalized value from the bricked volume.
+ *  @param  p [in] sampling point in voxel coordinate
+ *  @return normalized value (-1 if the brick is not resident)
+ */
+/*===========================================================================*/
+float BrickedValue( in vec3 p )
+{
+    vec3 brick = clamp( floor( p / brick_size ), vec3( 0.0 ), brick_grid_resolution - vec3( 1.0 ) );
+    vec4 entry = LookupTexture3D( page_table, ( brick + vec3( 0.5 ) ) / brick_grid_resolution );
+    if ( entry.w == 0.0 ) { return -1.0; }
+
+    vec3 slot = floor( entry.xyz * 255.0 + vec3( 0.5 ) );
+    vec3 local = clamp( p - brick * brick_size, vec3( 0.0 ), vec3( brick_size ) );
+    vec3 texel = slot * ( brick_size + 1.0 ) + local + vec3( 0.5 );
+    return LookupTexture3D( brick_atlas, texel / brick_atlas_size ).w;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the normalized scalar value derived from the vector volume.
+ *  @param  volume_index [in] volume index of the sampling point
+ *  @return normalized value of the magnitude or the selected component
+ */
+/*===========================================================================*/
+float VectorValue( in vec3 volume_index )
+{
+    vec3 v = ( LookupTexture3D( volume_data, volume_index ).xyz * 2.0 - vec3( 1.0 ) ) * vector_scale;
+    float s = length( v );
+    if ( vector_mode == 1 ) { s = v.x; }
+    else if ( vector_mode == 2 ) { s = v.y; }
+    else if ( vector_mode == 3 ) { s = v.z; }
+    return clamp( ( s - vector_range.x ) / max( vector_range.y - vector_range.x, 1.0e-8 ), 0.0, 1.0 );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the normalized value at the sampling point.
+ *  @param  p [in] sampling point in voxel coordinate
+ *  @param  volume_index [in] volume index of the sampling point
+ *  @return normalized value (-1 if the value is not available)
+ */
+/*===========================================================================*/
+float VolumeValue( in vec3 p, in vec3 volume_index )
+{
+    if ( bricking == 1 ) { return BrickedValue( p ); }
+    if ( vector_mode >= 0 ) { return VectorValue( volume_index ); }
+
+    float value = LookupTexture3D( volume_data, volume_index ).w;
+    if ( dequantization == 1 )
+    {
+        float index = ( value * ( dequantization_table_size - 1.0 ) + 0.5 ) / dequantization_table_size;
+        value = LookupTexture1D( dequantization_table, index ).w;
+    }
+    return value;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the normal vector at the sampling point.
+ *  @param  p [in] sampling point in voxel coordinate
+ *  @param  volume_index [in] volume index of the sampling point
+ *  @return normal vector in object coordinate
+ */
+/*===========================================================================*/
+vec3 VolumeNormal( in vec3 p, in vec3 volume_index )
+{
+    if ( bricking == 1 )
+    {
+        // Central differences. The values in the non-resident bricks are
+        // replaced by the value at the sampling point.
+        float s = BrickedValue( p );
+        vec3 s0 = vec3(
+            BrickedValue( p - vec3( 1.0, 0.0, 0.0 ) ),
+            BrickedValue( p - vec3( 0.0, 1.0, 0.0 ) ),
+            BrickedValue( p - vec3( 0.0, 0.0, 1.0 ) ) );
+        vec3 s1 = vec3(
+            BrickedValue( p + vec3( 1.0, 0.0, 0.0 ) ),
+            BrickedValue( p + vec3( 0.0, 1.0, 0.0 ) ),
+            BrickedValue( p + vec3( 0.0, 0.0, 1.0 ) ) );
+        s0 = mix( s0, vec3( s ), step( s0, vec3( -0.5 ) ) );
+        s1 = mix( s1, vec3( s ), step( s1, vec3( -0.5 ) ) );
+        vec3 g = s0 - s1;
+        return length( g ) > 0.0 ? normalize( g ) : vec3( 0.0 );
+    }
+
+    if ( gradient_volume == 1 )
+    {
+        vec3 n = LookupTexture3D( gradient_texture, volume_index ).xyz * 2.0 - vec3( 1.0 );
+        return length( n ) > 0.0 ? normalize( n ) : vec3( 0.0 );
+    }
+
+    vec3 offset_index = vec3( 1.0 ) / lod_resolution;
+    if ( vector_mode >= 0 )
+    {
+        // Central differences of the derived scalar value.
+        vec3 dx = vec3( offset_index.x, 0.0, 0.0 );
+        vec3 dy = vec3( 0.0, offset_index.y, 0.0 );
+        vec3 dz = vec3( 0.0, 0.0, offset_index.z );
+        vec3 g = vec3(
+            VectorValue( volume_index - dx ) - VectorValue( volume_index + dx ),
+            VectorValue( volume_index - dy ) - VectorValue( volume_index + dy ),
+            VectorValue( volume_index - dz ) - VectorValue( volume_index + dz ) );
+        return length( g ) > 0.0 ? normalize( g ) : vec3( 0.0 );
+    }
+
+    return normalize( VolumeGradient( volume_data, volume_index, offset_index ) );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the number of steps to leave the empty macro cell.
+ *  @param  p [in] sampling point in voxel coordinate
+ *  @param  d [in] ray direction for one step
+ *  @return number of steps (0 if the macro cell is occupied)
+ */
+/*===========================================================================*/
+int EmptySteps( in vec3 p, in vec3 d )
+{
+    vec3 cell = clamp( floor( p / macro_cell_size ), vec3( 0.0 ), macro_grid_resolution - vec3( 1.0 ) );
+    vec4 occupancy = LookupTexture3D( occupancy_texture, ( cell + vec3( 0.5 ) ) / macro_grid_resolution );
+    if ( occupancy.a > 0.0 ) { return 0; }
+
+    // Ray parameter (in steps) at the exit of the macro cell.
+    vec3 lower = cell * macro_cell_size;
+    vec3 upper = lower + vec3( macro_cell_size );
+    vec3 t = vec3( 1.0e+10 );
+    if ( d.x != 0.0 ) { t.x = ( ( d.x > 0.0 ? upper.x : lower.x ) - p.x ) / d.x; }
+    if ( d.y != 0.0 ) { t.y = ( ( d.y > 0.0 ? upper.y : lower.y ) - p.y ) / d.y; }
+    if ( d.z != 0.0 ) { t.z = ( ( d.z > 0.0 ? upper.z : lower.z ) - p.z ) / d.z; }
+    return max( 1, int( ceil( min( t.x, min( t.y, t.z ) ) ) ) );
+}
+
 /*===========================================================================*/
 /**
  *  @brief  Main function of fragment shader.
@@ -115,23 +389,46 @@ vec3 NDC2Obj( const in vec3 ndc )
 /*===========================================================================*/
 void main()
 {
-    vec2 index = vec2( gl_FragCoord.x / width, gl_FragCoord.y / height );
-    vec4 entry = LookupTexture2D( entry_points, index );
-    vec4 exit = LookupTexture2D( exit_points, index );
-
     // Entry and exit points and its depth values.
-    vec3 entry_point = ( volume.resolution - vec3(1.0) ) * entry.xyz;
-    vec3 exit_point = ( volume.resolution - vec3(1.0) ) * exit.xyz;
-    if ( entry_point == exit_point ) { discard; return; } // out of volume
+    vec3 entry_point;
+    vec3 exit_point;
+    float entry_depth;
+    float exit_depth;
+    if ( analytic_entry_exit == 1 )
+    {
+        if ( !RayBoxIntersection( entry_point, exit_point, entry_depth, exit_depth ) ) { discard; return; }
+    }
+    else
+    {
+        vec2 index = vec2( gl_FragCoord.x / width, gl_FragCoord.y / height );
+        vec4 entry = LookupTexture2D( entry_points, index );
+        vec4 exit = LookupTexture2D( exit_points, index );
+
+        entry_point = box_min + ( box_max - box_min ) * entry.xyz;
+        exit_point = box_min + ( box_max - box_min ) * exit.xyz;
+        if ( entry_point == exit_point ) { discard; return; } // out of volume
 
-    float entry_depth = entry.w;
-    float exit_depth = exit.w;
+        entry_depth = entry.w;
+        exit_depth = exit.w;
+
+        // Front face clipping.
+        if ( entry_depth == 1.0 )
+        {
+            entry_point = NDC2Obj( vec3( position_ndc.xy, -1.0 ) );
+            entry_depth = 0.0;
+        }
+    }
 
-    // Front face clipping.
-    if ( entry_depth == 1.0 )
+    // Clip the ray at the geometry drawn in front of the exit point.
+    if ( geometry_clipping == 1 )
     {
-        entry_point = NDC2Obj( vec3( position_ndc.xy, -1.0 ) );
-        entry_depth = 0.0;
+        float geometry_depth = LookupTexture2D( geometry_depth_texture, gl_FragCoord.xy / geometry_depth_size ).x;
+        if ( geometry_depth <= entry_depth ) { discard; return; }
+        if ( geometry_depth < exit_depth )
+        {
+            exit_point = NDC2Obj( vec3( position_ndc.xy, 2.0 * geometry_depth - 1.0 ) );
+            exit_depth = geometry_depth;
+        }
     }
 
     // Number of steps (segments) along the viewing ray.
@@ -141,7 +438,8 @@ void main()
     float dt = segment / float( nsteps );
     float dT = dt / sampling_step;
 #else
-    float dt = sampling_step;
+    // The coarse level is sampled with the step scaled by the voxel size.
+    float dt = sampling_step / lod_scale;
     int nsteps = int( floor( segment / dt ) );
 #endif
 
@@ -150,16 +448,34 @@ void main()
 
     float tfunc_scale = 1.0 / ( transfer_function.max_value - transfer_function.min_value );
 
-    // Random number.
+    // Random number. The nearest layer is given by the smallest threshold.
     float R = LookupTexture2D( random_texture, RandomIndex( gl_FragCoord.xy ) ).a;
+    if ( render_mode == 1 ) { R = 1.0e-4; }
 
     // Ray traversal.
     float accum_alpha = 0.0;
+    vec3 accum_color = vec3( 0.0 ); // premultiplied color for the weighted blended OIT
+    float first_depth = 0.0; // depth of the first contribution in camera coordinate
     vec3 position = entry_point;
     float w = 0.0;
     float dd = dt / segment;
+    float front_index = -1.0; // transfer function index at the front of the segment
     for ( int i = 0; i < nsteps; i++, w += dd )
     {
+        // Skip the empty macro cell.
+        if ( empty_space_skipping == 1 )
+        {
+            int n = EmptySteps( position, direction );
+            if ( n > 0 )
+            {
+                i += n - 1;
+                w += dd * float( n - 1 );
+                position += direction * float( n );
+                front_index = -1.0;
+                continue;
+            }
+        }
+
         // Get the scalar value from the 3D texture.
         // NOTE: The volume index which is a index to access the volume data
         // represented as 3D texture can be calculate as follows:
@@ -169,27 +485,56 @@ void main()
         //            = vec3( P + vec3(0.5) ) / R;
         //
         // where, I: volume index, P: sampling point, R: volume resolution.
-        vec3 volume_index = vec3( ( position + vec3(0.5) ) / volume.resolution );
-        vec4 value = LookupTexture3D( volume_data, volume_index );
-        float scalar = mix( volume.min_range, volume.max_range, value.w );
+        // For the coarse level, P is scaled to the voxel coordinate of the level.
+        // For the rectilinear grid, P is the voxel coordinate of the position.
+        vec3 voxel = VoxelPosition( position );
+        vec3 volume_index = vec3( ( voxel * lod_scale + vec3(0.5) ) / lod_resolution );
+        float value = VolumeValue( voxel, volume_index );
+        if ( value < 0.0 ) // not resident
+        {
+            position += direction;
+            front_index = -1.0;
+            continue;
+        }
+        float scalar = mix( volume.min_range, volume.max_range, value );
 
-        // Get the source color from the transfer function.
+        // Get the source color from the transfer function. The pre-integrated
+        // color is looked up for the segment between the previous sample and
+        // the current sample.
         float tfunc_index = ( scalar - transfer_function.min_value ) * tfunc_scale;
-        vec4 c = LookupTexture1D( transfer_function_data, tfunc_index );
-
+        vec4 c;
+        if ( preintegration == 1 )
+        {
+            if ( front_index < 0.0 ) { front_index = tfunc_index; }
+            c = LookupTexture2D( preintegration_texture, vec2( front_index, tfunc_index ) );
+            front_index = tfunc_index;
+        }
+        else
+        {
+            c = LookupTexture1D( transfer_function_data, tfunc_index );
 #if defined( ENABLE_ALPHA_CORRECTION )
-        c.a = 1.0 - pow( 1.0 - c.a, dT );
+            c.a = 1.0 - pow( 1.0 - c.a, dT );
 #endif
-        // Get the normal vector in object coordinate.
-        vec3 offset_index = vec3( volume.resolution_reciprocal );
-        vec3 normal = VolumeGradient( volume_data, volume_index, offset_index );
+        }
+#if !defined( ENABLE_ALPHA_CORRECTION )
+        // Opacity correction for the longer step on the coarse level.
+        if ( lod_scale < 1.0 ) { c.a = 1.0 - pow( 1.0 - c.a, 1.0 / lod_scale ); }
+#endif
+        // The transparent sample does not contribute to the ray.
+        if ( c.a == 0.0 )
+        {
+            position += direction;
+            continue;
+        }
 
-        // Normal vector (N) in object coordinate.
-        vec3 N = normalize( normal );
+        // Normal vector (N) in object coordinate, which is computed only if
+        // the sample contributes to the ray.
+        vec3 N = vec3( 0.0 );
 
         // Edge enhancement
         if ( edge_factor > 0.0 )
         {
+            N = ObjectNormal( VolumeNormal( voxel, volume_index ), position );
             if ( length( N ) > 0.0 )
             {
                 vec3 E = normalize( -direction );
@@ -201,10 +546,22 @@ void main()
             }
         }
 
+        // Front-to-back compositing for the weighted blended OIT
+        if ( render_mode == 2 )
+        {
+            if ( accum_alpha == 0.0 && c.a > 0.0 ) { first_depth = ( ModelViewMatrix * vec4( position, 1.0 ) ).z; }
+            accum_color += ( 1.0 - accum_alpha ) * c.a * c.rgb;
+            accum_alpha += ( 1.0 - accum_alpha ) * c.a;
+            if ( accum_alpha > 0.99 ) { break; }
+            position += direction;
+            continue;
+        }
+
         // Stochastic color assignment
         accum_alpha += ( 1.0 - accum_alpha ) * c.a;
         if ( R <= accum_alpha )
         {
+            if ( edge_factor <= 0.0 ) { N = ObjectNormal( VolumeNormal( voxel, volume_index ), position ); }
             gl_FragData[0] = vec4( c.rgb, 1.0 );
             gl_FragData[1] = ModelViewMatrix * vec4( position, 1.0 ); // position in camera coordinate
             gl_FragData[2] = vec4( NormalMatrix * N, 1.0 ); // normal vector in camera coordinate
@@ -215,5 +572,14 @@ void main()
         position += direction;
     }
 
+    // Weighted color and revealage accumulation
+    if ( render_mode == 2 && accum_alpha > 0.0 )
+    {
+        float weight = BlendingWeight( first_depth, accum_alpha );
+        gl_FragData[0] = vec4( accum_color * weight, accum_alpha );
+        gl_FragData[1] = vec4( accum_alpha * weight, 0.0, 0.0, 0.0 );
+        return;
+    }
+
     discard;
 }
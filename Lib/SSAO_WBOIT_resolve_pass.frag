@@ -0,0 +1,24 @@
+#version 120
+#include "texture.h"
+
+// Uniform parameters.
+uniform sampler2D accum_texture; // weighted colors (rgb) and revealage (a)
+uniform sampler2D weight_texture; // sum of weighted opacities (r)
+uniform sampler2D position_texture; // position of the nearest layer
+
+
+void main()
+{
+    // Skip the pixels without the nearest layer for the ambient occlusion.
+    vec4 position = LookupTexture2D( position_texture, gl_TexCoord[0].st );
+    if ( position.w == 0.0 ) { discard; return; }
+
+    vec4 accum = LookupTexture2D( accum_texture, gl_TexCoord[0].st );
+    float weight = LookupTexture2D( weight_texture, gl_TexCoord[0].st ).r;
+    float coverage = 1.0 - accum.a;
+    if ( coverage == 0.0 ) { discard; return; }
+
+    // Weighted average color with the pixel coverage as alpha.
+    vec3 color = accum.rgb / max( weight, 1.0e-5 );
+    gl_FragColor = vec4( color, coverage );
+}
@@ -10,10 +10,13 @@ uniform sampler2D depth_texture;
 uniform sampler1D kernel_texture;
 uniform sampler2D noise_texture;
 uniform int kernel_size;
+uniform int kernel_stride; // stride of the sampling points (1: all of the points)
 uniform float kernel_radius;
 uniform float kernel_bias;
 uniform float intensity;
 uniform vec2 noise_scale;
+uniform int coverage_alpha; // 1 if the color alpha stores the pixel coverage
+uniform int drawing_occlusion_factor; // 1 if the occlusion factor is drawn as the color
 
 uniform ShadingParameter shading;
 
@@ -25,8 +28,10 @@ float OcclusionFactor( vec4 position, mat3 tbn )
 {
     float occlusion = 0.0;
     float index = 0.0f;
-    float dindex = 1.0f / float( kernel_size );
-    for ( int i = 0; i < kernel_size ; i++, index += dindex )
+    float dindex = float( kernel_stride ) / float( kernel_size );
+    int nsamples = kernel_size / kernel_stride;
+    if ( nsamples < 1 ) { nsamples = 1; } // max() has no integer version in GLSL 1.20
+    for ( int i = 0; i < nsamples ; i++, index += dindex )
     {
         vec3 p = tbn * LookupTexture1D( kernel_texture, index ).xyz;
         p = p * kernel_radius + position.xyz;
@@ -40,7 +45,7 @@ float OcclusionFactor( vec4 position, mat3 tbn )
         occlusion += ( q.z - kernel_bias >= depth ? 1.0 : 0.0 ) * range_check;
     }
 
-    return 1.0 - occlusion / kernel_size;
+    return 1.0 - occlusion / float( nsamples );
 }
 
 void main()
@@ -83,12 +88,16 @@ void main()
     vec3 shaded_color = ShadingNone( shading, color.rgb * occlusion );
 #endif
 
-#if defined( ENABLE_DRAWING_OCCLUSION_FACTOR )
-    // Draw occlusion factor as a fragment color
-    gl_FragColor = vec4( vec3( occlusion ), 1.0 );
-#else
-    gl_FragColor = vec4( shaded_color, 1.0 );
-#endif
+    float alpha = coverage_alpha == 1 ? color.a : 1.0;
+    if ( drawing_occlusion_factor == 1 )
+    {
+        // Draw occlusion factor as a fragment color
+        gl_FragColor = vec4( vec3( occlusion ), 1.0 );
+    }
+    else
+    {
+        gl_FragColor = vec4( shaded_color, alpha );
+    }
 
     gl_FragDepth = LookupTexture2D( depth_texture, gl_TexCoord[0].st ).z;
 }
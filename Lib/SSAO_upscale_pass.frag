@@ -0,0 +1,53 @@
+#version 120
+#include "texture.h"
+
+// Uniform parameters.
+uniform sampler2D color_texture; // shaded color in the scaled resolution
+uniform sampler2D depth_texture; // depth in the scaled resolution
+uniform vec2 texture_size; // scaled resolution
+
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the Catmull-Rom weights for the four neighboring texels.
+ *  @param  t [in] fractional position between the 2nd and the 3rd texels
+ *  @return weights
+ */
+/*===========================================================================*/
+vec4 CatmullRomWeights( in float t )
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return vec4(
+        -0.5 * t3 + t2 - 0.5 * t,
+        1.5 * t3 - 2.5 * t2 + 1.0,
+        -1.5 * t3 + 2.0 * t2 + 0.5 * t,
+        0.5 * t3 - 0.5 * t2 );
+}
+
+void main()
+{
+    vec2 p = gl_TexCoord[0].st * texture_size - 0.5;
+    vec2 f = fract( p );
+    vec2 origin = floor( p ) - 0.5; // center of the upper-left texel of the 4x4 texels
+    vec4 wx = CatmullRomWeights( f.x );
+    vec4 wy = CatmullRomWeights( f.y );
+
+    // Filter the premultiplied color to avoid the fringes around the object.
+    vec4 color = vec4( 0.0 );
+    for ( int j = 0; j < 4; j++ )
+    {
+        for ( int i = 0; i < 4; i++ )
+        {
+            vec2 index = ( origin + vec2( float( i ), float( j ) ) ) / texture_size;
+            vec4 c = LookupTexture2D( color_texture, index );
+            color += wx[i] * wy[j] * vec4( c.rgb * c.a, c.a );
+        }
+    }
+
+    color = clamp( color, 0.0, 1.0 );
+    if ( color.a == 0.0 ) { discard; return; }
+
+    gl_FragColor = vec4( color.rgb / color.a, color.a );
+    gl_FragDepth = LookupTexture2D( depth_texture, gl_TexCoord[0].st ).z;
+}
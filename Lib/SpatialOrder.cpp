@@ -0,0 +1,195 @@
+#include "SpatialOrder.h"
+#include "Parallel.h"
+#include <cfloat>
+#include <kvs/Math>
+#include <kvs/Vector3>
+
+
+namespace
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the 10-bit value with two zero bits inserted after each bit.
+ *  @param  v [in] 10-bit value
+ *  @return expanded value
+ */
+/*===========================================================================*/
+inline kvs::UInt32 ExpandBits( kvs::UInt32 v )
+{
+    v = ( v * 0x00010001u ) & 0xFF0000FFu;
+    v = ( v * 0x00000101u ) & 0x0F00F00Fu;
+    v = ( v * 0x00000011u ) & 0xC30C30C3u;
+    v = ( v * 0x00000005u ) & 0x49249249u;
+    return v;
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns the 30-bit Morton code of the point.
+ *  @param  p [in] point normalized in the bounding box
+ *  @return Morton code
+ */
+/*===========================================================================*/
+inline kvs::UInt32 MortonCode( const kvs::Vec3& p )
+{
+    const kvs::UInt32 x = static_cast<kvs::UInt32>( kvs::Math::Clamp( p.x() * 1024.0f, 0.0f, 1023.0f ) );
+    const kvs::UInt32 y = static_cast<kvs::UInt32>( kvs::Math::Clamp( p.y() * 1024.0f, 0.0f, 1023.0f ) );
+    const kvs::UInt32 z = static_cast<kvs::UInt32>( kvs::Math::Clamp( p.z() * 1024.0f, 0.0f, 1023.0f ) );
+    return ( ExpandBits( x ) << 2 ) | ( ExpandBits( y ) << 1 ) | ExpandBits( z );
+}
+
+} // end of namespace
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Creates the spatial order of the mesh.
+ *  @param  coords [in] coordinates of the vertices
+ *  @param  connections [in] connections of the elements
+ *  @param  stride [in] number of the vertices of each element
+ *
+ *  The Morton codes and the renumbered connections are computed by the
+ *  hardware threads. The keys of the Morton code and the element index are
+ *  sorted in each thread and merged, so that the order is deterministic.
+ *  The vertices not referred by any element are placed at the end.
+ */
+/*===========================================================================*/
+void SpatialOrder::create(
+    const kvs::ValueArray<kvs::Real32>& coords,
+    const kvs::ValueArray<kvs::UInt32>& connections,
+    const size_t stride )
+{
+    this->release();
+
+    const size_t nvertices = coords.size() / 3;
+    const size_t nelements = connections.size() / stride;
+    if ( nelements == 0 ) { return; }
+
+    // Bounding box of the vertices with the partial box for each thread.
+    const size_t nthreads = NumberOfThreads();
+    std::vector<kvs::Vec3> min_coords( nthreads, kvs::Vec3::Constant( FLT_MAX ) );
+    std::vector<kvs::Vec3> max_coords( nthreads, kvs::Vec3::Constant( -FLT_MAX ) );
+    ParallelRanges( nvertices, [&] ( size_t thread, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            for ( size_t j = 0; j < 3; j++ )
+            {
+                min_coords[ thread ][j] = kvs::Math::Min( min_coords[ thread ][j], coords[ 3 * i + j ] );
+                max_coords[ thread ][j] = kvs::Math::Max( max_coords[ thread ][j], coords[ 3 * i + j ] );
+            }
+        }
+    } );
+
+    kvs::Vec3 min_coord = min_coords[0];
+    kvs::Vec3 max_coord = max_coords[0];
+    for ( size_t t = 1; t < nthreads; t++ )
+    {
+        for ( size_t j = 0; j < 3; j++ )
+        {
+            min_coord[j] = kvs::Math::Min( min_coord[j], min_coords[t][j] );
+            max_coord[j] = kvs::Math::Max( max_coord[j], max_coords[t][j] );
+        }
+    }
+
+    kvs::Vec3 scale;
+    for ( size_t j = 0; j < 3; j++ )
+    {
+        const float length = max_coord[j] - min_coord[j];
+        scale[j] = length > 0.0f ? 1.0f / length : 0.0f;
+    }
+
+    // Keys of the Morton code of the element center (high 32 bits) and the
+    // element index (low 32 bits).
+    std::vector<kvs::UInt64> keys( nelements );
+    ParallelRanges( nelements, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            kvs::Vec3 center( 0.0f, 0.0f, 0.0f );
+            for ( size_t j = 0; j < stride; j++ )
+            {
+                center += kvs::Vec3( coords.data() + 3 * connections[ stride * i + j ] );
+            }
+            center /= static_cast<float>( stride );
+
+            const kvs::Vec3 p = ( center - min_coord ) * scale;
+            keys[i] = ( kvs::UInt64( ::MortonCode( p ) ) << 32 ) | kvs::UInt64( i );
+        }
+    } );
+
+    // Sort the keys in each thread, and merge the sorted ranges. The ranges
+    // are the same as the ones divided by ParallelRanges.
+    const size_t range = ParallelRangeSize( nelements );
+    ParallelRanges( nelements, [&] ( size_t, size_t begin, size_t end )
+    {
+        std::sort( keys.begin() + begin, keys.begin() + end );
+    } );
+    for ( size_t width = range; width < nelements; width *= 2 )
+    {
+        for ( size_t begin = 0; begin + width < nelements; begin += 2 * width )
+        {
+            const size_t end = kvs::Math::Min( begin + 2 * width, nelements );
+            std::inplace_merge( keys.begin() + begin, keys.begin() + begin + width, keys.begin() + end );
+        }
+    }
+
+    m_element_order.resize( nelements );
+    for ( size_t i = 0; i < nelements; i++ )
+    {
+        m_element_order[i] = static_cast<kvs::UInt32>( keys[i] & 0xFFFFFFFFu );
+    }
+
+    // Renumber the vertices in the order of the first reference.
+    const kvs::UInt32 unknown = 0xFFFFFFFFu;
+    std::vector<kvs::UInt32> vertex_index( nvertices, unknown );
+    m_vertex_order.reserve( nvertices );
+    for ( size_t i = 0; i < nelements; i++ )
+    {
+        const kvs::UInt32* id = connections.data() + stride * m_element_order[i];
+        for ( size_t j = 0; j < stride; j++ )
+        {
+            if ( vertex_index[ id[j] ] != unknown ) { continue; }
+            vertex_index[ id[j] ] = static_cast<kvs::UInt32>( m_vertex_order.size() );
+            m_vertex_order.push_back( id[j] );
+        }
+    }
+    for ( size_t i = 0; i < nvertices; i++ )
+    {
+        if ( vertex_index[i] != unknown ) { continue; }
+        vertex_index[i] = static_cast<kvs::UInt32>( m_vertex_order.size() );
+        m_vertex_order.push_back( static_cast<kvs::UInt32>( i ) );
+    }
+
+    // Connections of the sorted elements with the new vertex indices.
+    m_connections.allocate( nelements * stride );
+    ParallelRanges( nelements, [&] ( size_t, size_t begin, size_t end )
+    {
+        for ( size_t i = begin; i < end; i++ )
+        {
+            const kvs::UInt32* id = connections.data() + stride * m_element_order[i];
+            for ( size_t j = 0; j < stride; j++ )
+            {
+                m_connections[ stride * i + j ] = vertex_index[ id[j] ];
+            }
+        }
+    } );
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Releases the spatial order.
+ */
+/*===========================================================================*/
+void SpatialOrder::release()
+{
+    m_element_order.clear();
+    m_vertex_order.clear();
+    m_connections = kvs::ValueArray<kvs::UInt32>();
+}
+
+} // end of namespace AmbientOcclusionRendering
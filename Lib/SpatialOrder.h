@@ -0,0 +1,72 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <kvs/Type>
+#include <kvs/ValueArray>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Spatial order of the elements and the vertices of a mesh.
+ *
+ *  The elements (triangles or tetrahedra) are sorted along the Morton curve
+ *  of their centers, and the vertices are renumbered in the order of the
+ *  first reference by the sorted elements. The neighboring elements are
+ *  drawn close in time and refer to the close vertices, which improves the
+ *  locality of the vertex fetch and the texture lookups on the GPU.
+ */
+/*===========================================================================*/
+class SpatialOrder
+{
+private:
+    std::vector<kvs::UInt32> m_element_order{}; ///< old element index for each new element
+    std::vector<kvs::UInt32> m_vertex_order{}; ///< old vertex index for each new vertex
+    kvs::ValueArray<kvs::UInt32> m_connections{}; ///< connections of the sorted elements with the new vertex indices
+
+public:
+    SpatialOrder() = default;
+
+    const std::vector<kvs::UInt32>& elementOrder() const { return m_element_order; }
+    const std::vector<kvs::UInt32>& vertexOrder() const { return m_vertex_order; }
+    const kvs::ValueArray<kvs::UInt32>& connections() const { return m_connections; }
+    bool isCreated() const { return m_element_order.size() > 0; }
+
+    void create(
+        const kvs::ValueArray<kvs::Real32>& coords,
+        const kvs::ValueArray<kvs::UInt32>& connections,
+        const size_t stride );
+    void release();
+
+    template <typename T>
+    kvs::ValueArray<T> reorderVertices( const kvs::ValueArray<T>& values, const size_t stride ) const
+    {
+        return Reorder( values, m_vertex_order, stride );
+    }
+
+    template <typename T>
+    kvs::ValueArray<T> reorderElements( const kvs::ValueArray<T>& values, const size_t stride ) const
+    {
+        return Reorder( values, m_element_order, stride );
+    }
+
+private:
+    template <typename T>
+    static kvs::ValueArray<T> Reorder(
+        const kvs::ValueArray<T>& values,
+        const std::vector<kvs::UInt32>& order,
+        const size_t stride )
+    {
+        kvs::ValueArray<T> reordered( order.size() * stride );
+        for ( size_t i = 0; i < order.size(); i++ )
+        {
+            const T* src = values.data() + size_t( order[i] ) * stride;
+            std::copy( src, src + stride, reordered.data() + i * stride );
+        }
+        return reordered;
+    }
+};
+
+} // end of namespace AmbientOcclusionRendering
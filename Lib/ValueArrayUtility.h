@@ -0,0 +1,27 @@
+#pragma once
+#include <algorithm>
+#include <kvs/ValueArray>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Returns true if the two arrays have the same values.
+ *  @param  a [in] array
+ *  @param  b [in] array
+ *  @return true if the arrays are the same
+ *
+ *  The values are compared only if the arrays do not share the same memory.
+ */
+/*===========================================================================*/
+template <typename T>
+inline bool IsSameArray( const kvs::ValueArray<T>& a, const kvs::ValueArray<T>& b )
+{
+    if ( a.size() != b.size() ) { return false; }
+    if ( a.data() == b.data() ) { return true; }
+    return std::equal( a.begin(), a.end(), b.begin() );
+}
+
+} // end of namespace AmbientOcclusionRendering
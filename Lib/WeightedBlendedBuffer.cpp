@@ -0,0 +1,150 @@
+#include "WeightedBlendedBuffer.h"
+#include <kvs/OpenGL>
+#include <kvs/ShaderSource>
+
+
+namespace
+{
+
+inline void Draw()
+{
+    kvs::OpenGL::WithPushedMatrix p1( GL_MODELVIEW );
+    p1.loadIdentity();
+    {
+        kvs::OpenGL::WithPushedMatrix p2( GL_PROJECTION );
+        p2.loadIdentity();
+        {
+            kvs::OpenGL::SetOrtho( 0, 1, 0, 1, -1, 1 );
+            {
+                kvs::OpenGL::Begin( GL_QUADS );
+                kvs::OpenGL::Color( kvs::Vec4::Constant( 1.0 ) );
+                kvs::OpenGL::TexCoordVertex( kvs::Vec2( 1, 1 ), kvs::Vec2( 1, 1 ) );
+                kvs::OpenGL::TexCoordVertex( kvs::Vec2( 0, 1 ), kvs::Vec2( 0, 1 ) );
+                kvs::OpenGL::TexCoordVertex( kvs::Vec2( 0, 0 ), kvs::Vec2( 0, 0 ) );
+                kvs::OpenGL::TexCoordVertex( kvs::Vec2( 1, 0 ), kvs::Vec2( 1, 0 ) );
+                kvs::OpenGL::End();
+            }
+        }
+    }
+}
+
+} // end of namespace
+
+
+namespace AmbientOcclusionRendering
+{
+
+void WeightedBlendedBuffer::create( const size_t width, const size_t height )
+{
+    m_accum_texture.setWrapS( GL_CLAMP_TO_EDGE );
+    m_accum_texture.setWrapT( GL_CLAMP_TO_EDGE );
+    m_accum_texture.setMagFilter( GL_NEAREST );
+    m_accum_texture.setMinFilter( GL_NEAREST );
+    m_accum_texture.setPixelFormat( GL_RGBA16F_ARB, GL_RGBA, GL_FLOAT );
+    m_accum_texture.create( width, height );
+
+    m_weight_texture.setWrapS( GL_CLAMP_TO_EDGE );
+    m_weight_texture.setWrapT( GL_CLAMP_TO_EDGE );
+    m_weight_texture.setMagFilter( GL_NEAREST );
+    m_weight_texture.setMinFilter( GL_NEAREST );
+    m_weight_texture.setPixelFormat( GL_RGBA16F_ARB, GL_RGBA, GL_FLOAT );
+    m_weight_texture.create( width, height );
+
+    m_framebuffer.create();
+    m_framebuffer.attachColorTexture( m_accum_texture, 0 );
+    m_framebuffer.attachColorTexture( m_weight_texture, 1 );
+    m_width = width;
+    m_height = height;
+
+    kvs::ShaderSource vert( m_resolve_pass_shader_vert_file );
+    kvs::ShaderSource frag( m_resolve_pass_shader_frag_file );
+    m_resolve_pass_shader.build( vert, frag );
+}
+
+void WeightedBlendedBuffer::update( const size_t width, const size_t height )
+{
+    this->release();
+    this->create( width, height );
+}
+
+void WeightedBlendedBuffer::release()
+{
+    m_resolve_pass_shader.release();
+    m_framebuffer.release();
+    m_accum_texture.release();
+    m_weight_texture.release();
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Binds the accumulation buffer. The geometry pass shaders drawn in
+ *          the weighted blended mode output the weighted premultiplied color
+ *          and the opacity to the 1st target, and the weighted opacity to the
+ *          2nd target.
+ */
+/*===========================================================================*/
+void WeightedBlendedBuffer::bind()
+{
+    // Gaurded bind.
+    m_bound_id = kvs::OpenGL::Integer( GL_FRAMEBUFFER_BINDING );
+    if ( m_bound_id != m_framebuffer.id() ) { m_framebuffer.bind(); }
+
+    const GLenum buffers[2] = {
+        GL_COLOR_ATTACHMENT0_EXT,
+        GL_COLOR_ATTACHMENT1_EXT };
+    kvs::OpenGL::SetDrawBuffers( 2, buffers );
+
+    // The revealage (alpha of the 1st target) is initialized by 1.
+    kvs::OpenGL::PushAttrib( GL_COLOR_BUFFER_BIT | GL_ENABLE_BIT | GL_VIEWPORT_BIT );
+    kvs::OpenGL::SetViewport( 0, 0, m_width, m_height );
+    kvs::OpenGL::SetClearColor( kvs::Vec4( 0.0f, 0.0f, 0.0f, 1.0f ) );
+    kvs::OpenGL::Clear( GL_COLOR_BUFFER_BIT );
+
+    // rgb: sum of the weighted colors, a: product of the transparencies
+    kvs::OpenGL::Enable( GL_BLEND );
+    KVS_GL_CALL( glBlendFuncSeparate( GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA ) );
+}
+
+void WeightedBlendedBuffer::unbind()
+{
+    kvs::OpenGL::PopAttrib();
+    if ( m_bound_id != m_framebuffer.id() )
+    {
+        KVS_GL_CALL( glBindFramebufferEXT( GL_FRAMEBUFFER, m_bound_id ) );
+    }
+}
+
+/*===========================================================================*/
+/**
+ *  @brief  Resolves the accumulated colors into the color attachment of the
+ *          target framebuffer (G-buffer of the ambient occlusion buffer).
+ *  @param  target [in] target framebuffer
+ *  @param  position_texture [in] position texture of the target G-buffer
+ *
+ *  The resolved color is the weighted average color and its alpha is the
+ *  pixel coverage. The pixels not covered by the G-buffer layer are skipped.
+ */
+/*===========================================================================*/
+void WeightedBlendedBuffer::resolve(
+    kvs::FrameBufferObject& target,
+    kvs::Texture2D& position_texture )
+{
+    kvs::FrameBufferObject::GuardedBinder binder( target );
+    kvs::OpenGL::WithPushedAttrib attrib( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_ENABLE_BIT | GL_VIEWPORT_BIT );
+    kvs::OpenGL::SetViewport( 0, 0, m_width, m_height );
+    KVS_GL_CALL( glDrawBuffer( GL_COLOR_ATTACHMENT0_EXT ) );
+    KVS_GL_CALL( glDepthMask( GL_FALSE ) );
+    kvs::OpenGL::Disable( GL_DEPTH_TEST );
+    kvs::OpenGL::Disable( GL_BLEND );
+
+    kvs::ProgramObject::Binder bind( m_resolve_pass_shader );
+    kvs::Texture::Binder unit0( m_accum_texture, 0 );
+    kvs::Texture::Binder unit1( m_weight_texture, 1 );
+    kvs::Texture::Binder unit2( position_texture, 2 );
+    m_resolve_pass_shader.setUniform( "accum_texture", 0 );
+    m_resolve_pass_shader.setUniform( "weight_texture", 1 );
+    m_resolve_pass_shader.setUniform( "position_texture", 2 );
+    ::Draw();
+}
+
+} // end of namespace AmbientOcclusionRendering
@@ -0,0 +1,63 @@
+#pragma once
+#include <string>
+#include <kvs/ProgramObject>
+#include <kvs/FrameBufferObject>
+#include <kvs/Texture2D>
+
+
+namespace AmbientOcclusionRendering
+{
+
+/*===========================================================================*/
+/**
+ *  @brief  Accumulation buffer class for weighted blended order-independent
+ *          transparency.
+ *
+ *  Reference:
+ *  [1] Morgan McGuire, Louis Bavoil, "Weighted Blended Order-Independent
+ *      Transparency", Journal of Computer Graphics Techniques, 2(2), 2013.
+ */
+/*===========================================================================*/
+class WeightedBlendedBuffer
+{
+private:
+    // Resolve pass shader
+    std::string m_resolve_pass_shader_vert_file = "SSAO_occl_pass.vert"; ///< vertex shader file for resolve pass
+    std::string m_resolve_pass_shader_frag_file = "SSAO_WBOIT_resolve_pass.frag"; ///< fragment shader file for resolve pass
+    kvs::ProgramObject m_resolve_pass_shader{}; ///< shader program for resolve pass
+
+    // Framebuffer for accumulation
+    GLuint m_bound_id = 0; ///< Bound framebuffer ID
+    kvs::FrameBufferObject m_framebuffer{}; ///< framebuffer object
+    kvs::Texture2D m_accum_texture{}; ///< weighted color (rgb) and revealage (a)
+    kvs::Texture2D m_weight_texture{}; ///< sum of the weighted opacities (r)
+    size_t m_width = 0; ///< framebuffer width
+    size_t m_height = 0; ///< framebuffer height
+
+public:
+    WeightedBlendedBuffer() = default;
+    virtual ~WeightedBlendedBuffer() { this->release(); }
+
+    void setResolvePassShaderFiles(
+        const std::string& vert_file,
+        const std::string& frag_file )
+    {
+        m_resolve_pass_shader_vert_file = vert_file;
+        m_resolve_pass_shader_frag_file = frag_file;
+    }
+
+    kvs::FrameBufferObject& framebuffer() { return m_framebuffer; }
+    kvs::Texture2D& accumTexture() { return m_accum_texture; }
+    kvs::Texture2D& weightTexture() { return m_weight_texture; }
+    bool isCreated() const { return m_accum_texture.isCreated(); }
+
+    void create( const size_t width, const size_t height );
+    void update( const size_t width, const size_t height );
+    void release();
+
+    void bind();
+    void unbind();
+    void resolve( kvs::FrameBufferObject& target, kvs::Texture2D& position_texture );
+};
+
+} // end of namespace AmbientOcclusionRendering
@@ -0,0 +1,13 @@
+/*===========================================================================*/
+/**
+ *  @brief  Returns weight for the weighted blended OIT.
+ *  @param  z [in] depth value in camera coordinate
+ *  @param  a [in] opacity
+ *  @return weight
+ */
+/*===========================================================================*/
+float BlendingWeight( in float z, in float a )
+{
+    float d = abs( z );
+    return a * clamp( 10.0 / ( 1e-5 + pow( d / 5.0, 2.0 ) + pow( d / 200.0, 6.0 ) ), 1e-2, 3e3 );
+}
@@ -48,10 +48,10 @@ struct Model
         {
             auto* renderer = new SSAORenderer();
             renderer->setName( "Renderer" );
-            renderer->aoBuffer().setKernelRadius( radius );
-            renderer->aoBuffer().setKernelSize( points );
-            renderer->aoBuffer().setIntensity( intensity );
-            renderer->aoBuffer().setDrawingOcclusionFactorEnabled( occlusion );
+            renderer->setKernelRadius( radius );
+            renderer->setKernelSize( points );
+            renderer->setIntensity( intensity );
+            renderer->setDrawingOcclusionFactorEnabled( occlusion );
             renderer->enableShading();
             return renderer;
         }
@@ -109,7 +109,11 @@ int main( int argc, char** argv )
     occlusion_check_box.stateChanged( [&] ()
     {
         model.occlusion = occlusion_check_box.state();
-        screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+        if ( model.ssao )
+        {
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setDrawingOcclusionFactorEnabled( model.occlusion );
+        }
     } );
 
     kvs::Slider radius_slider( &screen );
@@ -131,7 +135,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelRadius( model.radius );
         }
     } );
 
@@ -151,7 +156,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelSize( model.points );
         }
     } );
 
@@ -171,7 +177,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setIntensity( model.intensity );
         }
     } );
 
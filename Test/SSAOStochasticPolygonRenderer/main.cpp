@@ -62,10 +62,10 @@ struct Model
             renderer->setRepetitionLevel( repeats );
             renderer->setLODControlEnabled( lod );
             renderer->setEdgeFactor( edge );
-            renderer->aoBuffer().setKernelRadius( radius );
-            renderer->aoBuffer().setKernelSize( points );
-            renderer->aoBuffer().setIntensity( intensity );
-            renderer->aoBuffer().setDrawingOcclusionFactorEnabled( occlusion );
+            renderer->setKernelRadius( radius );
+            renderer->setKernelSize( points );
+            renderer->setIntensity( intensity );
+            renderer->setDrawingOcclusionFactorEnabled( occlusion );
             renderer->enableShading();
             return renderer;
         }
@@ -127,7 +127,11 @@ int main( int argc, char** argv )
     occlusion_check_box.stateChanged( [&] ()
     {
         model.occlusion = occlusion_check_box.state();
-        screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+        if ( model.ssao )
+        {
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setDrawingOcclusionFactorEnabled( model.occlusion );
+        }
     } );
 
     kvs::Slider radius_slider( &screen );
@@ -149,7 +153,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelRadius( model.radius );
         }
     } );
 
@@ -169,7 +174,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelSize( model.points );
         }
     } );
 
@@ -207,7 +213,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setIntensity( model.intensity );
         }
     } );
 
@@ -157,10 +157,10 @@ struct Model
             auto* c = new SSAOCompositor( scene );
             c->enableLODControl();
             c->setRepetitionLevel( repeats );
-            c->aoBuffer().setKernelRadius( radius );
-            c->aoBuffer().setKernelSize( points );
-            c->aoBuffer().setIntensity( intensity );
-            c->aoBuffer().setDrawingOcclusionFactorEnabled( occlusion );
+            c->setKernelRadius( radius );
+            c->setKernelSize( points );
+            c->setIntensity( intensity );
+            c->setDrawingOcclusionFactorEnabled( occlusion );
             return c;
         }
         else
@@ -207,7 +207,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelRadius( model.radius );
         }
     } );
 
@@ -227,7 +228,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelSize( model.points );
         }
     } );
 
@@ -9,6 +9,7 @@
 #include <kvs/ScreenCaptureEvent>
 #include <kvs/TargetChangeEvent>
 #include <kvs/KeyPressEventListener>
+#include <kvs/PaintEventListener>
 #include <kvs/StochasticTetrahedraRenderer>
 #include <AmbientOcclusionRendering/Lib/SSAOStochasticTetrahedraRenderer.h>
 
@@ -30,6 +31,8 @@ struct Model
     int points; ///< number of points used for SSAO
     kvs::TransferFunction tfunc; ///< transfer function
     float edge; ///< edge enhancement factor
+    std::vector<std::string> time_series; ///< filenames of the time steps
+    bool play; ///< playback flag of the time series
 
     kvs::UnstructuredVolumeObject* import( const std::string& filename )
     {
@@ -51,6 +54,8 @@ struct Model
             renderer->setKernelRadius( radius );
             renderer->setKernelSize( points );
             renderer->setEdgeFactor( edge );
+            renderer->setTimeSeries( time_series );
+            renderer->setPlaybackEnabled( play );
             return renderer;
         }
         else
@@ -93,9 +98,12 @@ int main( int argc, char** argv )
     model.points = 256;
     model.tfunc = kvs::TransferFunction( kvs::ColorMap::BrewerSpectral( 256 ) );
     model.edge = 0.0f;
+    model.play = false;
 
-    // Visualization pipeline.
+    // Visualization pipeline. The time series with the static topology is
+    // played back if more than one file is specified.
     const std::string filename = argv[1];
+    if ( argc > 2 ) { model.time_series = std::vector<std::string>( argv + 1, argv + argc ); }
     screen.registerObject( model.import( filename ), model.renderer() );
 
     // Widgets.
@@ -132,12 +140,29 @@ int main( int argc, char** argv )
         }
     } );
 
+    kvs::CheckBox play_check_box( &screen );
+    play_check_box.setCaption( "Play" );
+    play_check_box.setState( model.play );
+    play_check_box.setMargin( 10 );
+    play_check_box.anchorToBottom( &lod_check_box );
+    play_check_box.show();
+    play_check_box.stateChanged( [&] ()
+    {
+        model.play = play_check_box.state();
+        if ( model.ssao )
+        {
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setPlaybackEnabled( model.play );
+        }
+        screen.redraw();
+    } );
+
     kvs::Slider repeat_slider( &screen );
     repeat_slider.setCaption( "Repeats: " + kvs::String::ToString( model.repeats ) );
     repeat_slider.setValue( model.repeats );
     repeat_slider.setRange( 1, 100 );
     repeat_slider.setMargin( 10 );
-    repeat_slider.anchorToBottom( &lod_check_box );
+    repeat_slider.anchorToBottom( &play_check_box );
     repeat_slider.show();
     repeat_slider.sliderMoved( [&] ()
     {
@@ -178,7 +203,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelRadius( model.radius );
         }
     } );
 
@@ -198,7 +224,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelSize( model.points );
         }
     } );
 
@@ -251,6 +278,7 @@ int main( int argc, char** argv )
             const bool visible = ssao_check_box.isVisible();
             ssao_check_box.setVisible( !visible );
             lod_check_box.setVisible( !visible );
+            play_check_box.setVisible( !visible );
             repeat_slider.setVisible( !visible );
             radius_slider.setVisible( !visible );
             points_slider.setVisible( !visible );
@@ -262,6 +290,15 @@ int main( int argc, char** argv )
     } );
     screen.addEvent( &key_event );
 
+    // The screen is redrawn continuously during the playback, and the next
+    // time step is swapped in as soon as it has been decoded.
+    kvs::PaintEventListener play_event;
+    play_event.update( [&] ()
+    {
+        if ( model.ssao && model.play ) { screen.redraw(); }
+    } );
+    screen.addEvent( &play_event );
+
     kvs::ScreenCaptureEvent event;
     screen.addEvent( &event );
 
@@ -3,12 +3,14 @@
 #include <kvs/TransferFunctionEditor>
 #include <kvs/StructuredVolumeObject>
 #include <kvs/StructuredVolumeImporter>
+#include <kvs/HydrogenVolumeData>
 #include <kvs/ShaderSource>
 #include <kvs/CheckBox>
 #include <kvs/Slider>
 #include <kvs/ScreenCaptureEvent>
 #include <kvs/TargetChangeEvent>
 #include <kvs/KeyPressEventListener>
+#include <kvs/PaintEventListener>
 #include <kvs/StochasticUniformGridRenderer>
 #include <AmbientOcclusionRendering/Lib/SSAOStochasticUniformGridRenderer.h>
 
@@ -30,9 +32,17 @@ struct Model
     int points; ///< number of points used for SSAO
     kvs::TransferFunction tfunc; ///< transfer function
     float edge; ///< edge enhancement factor
+    bool bricking; ///< bricked volume flag
+    size_t brick_size; ///< brick size in voxels
+    size_t budget; ///< memory budget of the brick atlas in bytes
+    bool multiresolution; ///< multiresolution volume flag
+    std::vector<std::string> time_series; ///< filenames of the time steps
+    bool play; ///< playback flag of the time series
 
     kvs::StructuredVolumeObject* import( const std::string& filename )
     {
+        // Synthetic volume is used if the filename is not specified.
+        if ( filename.empty() ) { return new kvs::HydrogenVolumeData( kvs::Vec3u( 64, 64, 64 ) ); }
         return new kvs::StructuredVolumeImporter( filename );
     }
 
@@ -51,6 +61,12 @@ struct Model
             renderer->setKernelRadius( radius );
             renderer->setKernelSize( points );
             renderer->setEdgeFactor( edge );
+            renderer->setBrickingEnabled( bricking );
+            renderer->setBrickSize( brick_size );
+            renderer->setBrickMemoryBudget( budget );
+            renderer->setMultiresolutionEnabled( multiresolution );
+            renderer->setTimeSeries( time_series );
+            renderer->setPlaybackEnabled( play );
             return renderer;
         }
         else
@@ -93,9 +109,16 @@ int main( int argc, char** argv )
     model.points = 256;
     model.tfunc = kvs::TransferFunction( kvs::ColorMap::BrewerSpectral( 256 ) );
     model.edge = 0.0f;
+    model.bricking = false;
+    model.brick_size = 16;
+    model.budget = 256 * 1024; // small budget to test the streaming of the bricks
+    model.multiresolution = false;
+    model.play = false;
 
-    // Visualization pipeline.
-    const std::string filename = argv[1];
+    // Visualization pipeline. The time series is played back if more than one
+    // file is specified.
+    const std::string filename = argc > 1 ? argv[1] : "";
+    if ( argc > 2 ) { model.time_series = std::vector<std::string>( argv + 1, argv + argc ); }
     screen.registerObject( model.import( filename ), model.renderer() );
 
     // Widgets.
@@ -132,12 +155,53 @@ int main( int argc, char** argv )
         }
     } );
 
+    kvs::CheckBox bricking_check_box( &screen );
+    bricking_check_box.setCaption( "Bricking" );
+    bricking_check_box.setState( model.bricking );
+    bricking_check_box.setMargin( 10 );
+    bricking_check_box.anchorToBottom( &lod_check_box );
+    bricking_check_box.show();
+    bricking_check_box.stateChanged( [&] ()
+    {
+        model.bricking = bricking_check_box.state();
+        screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+    } );
+
+    kvs::CheckBox multiresolution_check_box( &screen );
+    multiresolution_check_box.setCaption( "Multiresolution" );
+    multiresolution_check_box.setState( model.multiresolution );
+    multiresolution_check_box.setMargin( 10 );
+    multiresolution_check_box.anchorToBottom( &bricking_check_box );
+    multiresolution_check_box.show();
+    multiresolution_check_box.stateChanged( [&] ()
+    {
+        model.multiresolution = multiresolution_check_box.state();
+        screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+    } );
+
+    kvs::CheckBox play_check_box( &screen );
+    play_check_box.setCaption( "Play" );
+    play_check_box.setState( model.play );
+    play_check_box.setMargin( 10 );
+    play_check_box.anchorToBottom( &multiresolution_check_box );
+    play_check_box.show();
+    play_check_box.stateChanged( [&] ()
+    {
+        model.play = play_check_box.state();
+        if ( model.ssao )
+        {
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setPlaybackEnabled( model.play );
+        }
+        screen.redraw();
+    } );
+
     kvs::Slider repeat_slider( &screen );
     repeat_slider.setCaption( "Repeats: " + kvs::String::ToString( model.repeats ) );
     repeat_slider.setValue( model.repeats );
     repeat_slider.setRange( 1, 100 );
     repeat_slider.setMargin( 10 );
-    repeat_slider.anchorToBottom( &lod_check_box );
+    repeat_slider.anchorToBottom( &play_check_box );
     repeat_slider.show();
     repeat_slider.sliderMoved( [&] ()
     {
@@ -178,7 +242,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelRadius( model.radius );
         }
     } );
 
@@ -198,7 +263,8 @@ int main( int argc, char** argv )
     {
         if ( model.ssao )
         {
-            screen.scene()->replaceRenderer( "Renderer", model.renderer() );
+            auto* renderer = Model::SSAORenderer::DownCast( screen.scene()->renderer( "Renderer" ) );
+            renderer->setKernelSize( model.points );
         }
     } );
 
@@ -251,6 +317,9 @@ int main( int argc, char** argv )
             const bool visible = ssao_check_box.isVisible();
             ssao_check_box.setVisible( !visible );
             lod_check_box.setVisible( !visible );
+            bricking_check_box.setVisible( !visible );
+            multiresolution_check_box.setVisible( !visible );
+            play_check_box.setVisible( !visible );
             repeat_slider.setVisible( !visible );
             radius_slider.setVisible( !visible );
             points_slider.setVisible( !visible );
@@ -262,6 +331,15 @@ int main( int argc, char** argv )
     } );
     screen.addEvent( &key_event );
 
+    // The screen is redrawn continuously during the playback, and the next
+    // time step is swapped in as soon as it has been decoded.
+    kvs::PaintEventListener play_event;
+    play_event.update( [&] ()
+    {
+        if ( model.ssao && model.play ) { screen.redraw(); }
+    } );
+    screen.addEvent( &play_event );
+
     kvs::ScreenCaptureEvent event;
     screen.addEvent( &event );
 